@@ -1,14 +1,33 @@
 #version 450
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in vec2 tex_coords;
 layout (location = 1) in vec3 normal;
+layout (location = 2) flat in uint material_index;
 layout (location = 0) out vec4 frag_color;
 
-layout (set = 0, binding = 0) uniform sampler2D diffuse_sampler;
+struct Material
+{
+	uint diffuse_texture;
+};
+
+layout (buffer_reference, std430) readonly buffer MaterialBuffer
+{
+	Material materials[];
+};
+
+layout (push_constant) uniform PushConstants
+{
+	layout (offset = 72) MaterialBuffer material_buffer;
+} constants;
+
+layout (set = 0, binding = 0) uniform sampler2D textures[];
 
 void main()
 {
-	frag_color = texture(diffuse_sampler, tex_coords);
+	Material material = constants.material_buffer.materials[material_index];
+	frag_color = texture(textures[material.diffuse_texture], tex_coords);
 	// frag_color = vec4(tex_coords, 0.0, 1.0);
 	// frag_color = vec4(normal, 1.0);
 }
@@ -1,8 +1,17 @@
 #version 450
 #extension GL_EXT_buffer_reference : require
 
+layout (constant_id = 0) const bool QUANTIZED_VERTICES = true;
+// Set for the depth pre-pass, which only needs the position.
+layout (constant_id = 1) const bool POSITION_ONLY = false;
+
 layout (location = 0) out vec2 tex_coords;
 layout (location = 1) out vec3 normal;
+layout (location = 2) flat out uint material_index;
+
+// The main pass tests for equal depth against the pre-pass, so both have to compute the exact
+// same position.
+invariant gl_Position;
 
 struct Vertex
 {
@@ -17,16 +26,83 @@ layout (buffer_reference, std430) readonly buffer VertexBuffer
 	Vertex vertices[];
 };
 
+struct QuantizedVertex
+{
+	uint position_xy;
+	uint position_z;
+	uint normal;
+	uint tex_coords;
+};
+
+layout (buffer_reference, std430) readonly buffer QuantizedVertexBuffer
+{
+	QuantizedVertex vertices[];
+};
+
+struct Object
+{
+	uint first_index;
+	uint index_count;
+	int vertex_offset;
+	uint material_index;
+	vec4 bounding_sphere;
+	vec3 position_offset;
+	uint wide_indices;
+	vec3 position_scale;
+	uint padding;
+};
+
+layout (buffer_reference, std430) readonly buffer ObjectBuffer
+{
+	Object objects[];
+};
+
 layout (push_constant) uniform PushConstants
 {
 	mat4 camera;
 	VertexBuffer vertex_buffer;
+	layout (offset = 80) ObjectBuffer object_buffer;
 } constants;
 
+vec3 decode_octahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
 void main()
 {
-	Vertex vertex = constants.vertex_buffer.vertices[gl_VertexIndex];
-	gl_Position = constants.camera * vec4(vertex.position, 1.0);
-	tex_coords = vec2(vertex.tex_coord_x, vertex.tex_coord_y);
-	normal = vertex.normal;
+	Object object = constants.object_buffer.objects[gl_InstanceIndex];
+	material_index = object.material_index;
+
+	vec3 position;
+	if (QUANTIZED_VERTICES)
+	{
+		QuantizedVertexBuffer vertex_buffer = QuantizedVertexBuffer(constants.vertex_buffer);
+		QuantizedVertex vertex = vertex_buffer.vertices[gl_VertexIndex];
+		vec3 unit_position = vec3(
+			unpackUnorm2x16(vertex.position_xy),
+			unpackUnorm2x16(vertex.position_z).x
+		);
+		position = object.position_offset + object.position_scale * unit_position;
+		if (!POSITION_ONLY)
+		{
+			tex_coords = unpackHalf2x16(vertex.tex_coords);
+			normal = decode_octahedral(unpackSnorm2x16(vertex.normal));
+		}
+	}
+	else
+	{
+		Vertex vertex = constants.vertex_buffer.vertices[gl_VertexIndex];
+		position = vertex.position;
+		if (!POSITION_ONLY)
+		{
+			tex_coords = vec2(vertex.tex_coord_x, vertex.tex_coord_y);
+			normal = vertex.normal;
+		}
+	}
+
+	gl_Position = constants.camera * vec4(position, 1.0);
 }
@@ -0,0 +1,10 @@
+#version 450
+
+layout (location = 0) out vec4 frag_color;
+
+// Added up for every shaded fragment, so a pixel goes from red to yellow to white the more often
+// it is shaded.
+void main()
+{
+	frag_color = vec4(0.1, 0.05, 0.025, 1.0);
+}
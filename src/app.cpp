@@ -1,5 +1,16 @@
 #include "app.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 #include <SDL3/SDL_events.h>
 #include <SDL3/SDL_timer.h>
 
@@ -11,46 +22,120 @@
 
 #include <glm/gtc/type_ptr.hpp>
 
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
-#include <assimp/scene.h>
-
+#include "benchmark.hpp"
+#include "cpu_profiler.hpp"
+#include "hash.hpp"
+#include "ktx2.hpp"
+#include "scene_cache.hpp"
+#include "scene_import.hpp"
 #include "vkerr.hpp"
 
-[[nodiscard]] bool App::init()
+namespace
 {
-    spdlog::trace("App::init: starting initialization");
 
-    if (!m_engine.init())
+struct TextureLoad
+{
+    std::string path;
+    uint64_t content_hash{0};
+    DecodedImage image{};
+    bool success{false};
+};
+
+// Prefers the cooked KTX2 texture next to `source_path` if it is at least as new as the source,
+// or if it is only available from the asset archive.
+std::string resolve_texture_path(const AssetArchive &archive, const std::string &source_path)
+{
+    std::string cooked_path = get_cooked_texture_path(source_path);
+    if (cooked_path == source_path)
     {
-        spdlog::error("App::init: failed to initialize engine");
-        return false;
+        return source_path;
     }
-    spdlog::trace("App::init: engine initialized");
 
-    if (!m_forward_pass.init())
+    std::error_code ec;
+    auto cooked_time = std::filesystem::last_write_time(cooked_path, ec);
+    if (ec)
     {
-        spdlog::error("App::init: failed to forward render pass");
-        return false;
+        return archive.contains(cooked_path) ? cooked_path : source_path;
     }
-    spdlog::trace("App::init: forward pass initialized");
 
-    if (!m_imgui_pass.init())
+    auto source_time = std::filesystem::last_write_time(source_path, ec);
+    if (!ec && source_time > cooked_time)
+    {
+        spdlog::warn(
+            "resolve_texture_path: {} is older than its source, falling back to {}",
+            cooked_path,
+            source_path
+        );
+        return source_path;
+    }
+
+    return cooked_path;
+}
+
+// Reads and hashes a texture file. The file is only decoded if no texture with the same
+// contents is resident. Safe to call from any thread.
+void load_texture(
+    const AssetArchive &archive, TextureLoad &load,
+    const std::unordered_set<uint64_t> &resident_hashes
+)
+{
+    CPU_ZONE("load_texture");
+
+    AssetData asset;
+    if (!archive.load(load.path, asset))
+    {
+        spdlog::error("load_texture: failed to load file {}", load.path);
+        return;
+    }
+    std::span<const uint8_t> data(
+        reinterpret_cast<const uint8_t *>(asset.data.data()),
+        asset.data.size()
+    );
+
+    load.content_hash = hash_bytes(asset.data);
+    if (resident_hashes.contains(load.content_hash))
     {
-        spdlog::error("App::init: failed to imgui render pass");
+        load.success = true;
+        return;
+    }
+
+    bool is_cooked = std::filesystem::path(load.path).extension() == ".ktx2";
+    if (is_cooked ? !read_ktx2(data, load.image) : !decode_image_memory(data, load.image))
+    {
+        spdlog::error("load_texture: failed to decode {}", load.path);
+        return;
+    }
+    load.success = true;
+}
+
+} // namespace
+
+[[nodiscard]] bool App::init()
+{
+    CPU_ZONE("App::init");
+
+    spdlog::trace("App::init: starting initialization");
+
+    if (!m_engine.init())
+    {
+        spdlog::error("App::init: failed to initialize engine");
         return false;
     }
-    spdlog::trace("App::init: imgui pass initialized");
+    spdlog::trace("App::init: engine initialized");
 
     {
         VkSamplerCreateInfo sampler_info = {};
         sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
         sampler_info.magFilter = VK_FILTER_LINEAR;
         sampler_info.minFilter = VK_FILTER_LINEAR;
-        sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
         sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
         sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        sampler_info.anisotropyEnable = VK_TRUE;
+        sampler_info.maxAnisotropy = std::min(16.0f, m_engine.get_max_sampler_anisotropy());
+        sampler_info.minLod = 0.0f;
+        sampler_info.maxLod = VK_LOD_CLAMP_NONE;
         VKERR(
             vkCreateSampler(m_engine.get_device(), &sampler_info, nullptr, &m_sampler),
             "App::init: failed to create default sampler"
@@ -60,7 +145,52 @@
     }
     spdlog::trace("App::init: created default sampler");
 
-    if (!create_scene_from_file("../assets/sponza/sponza.gltf", m_scene))
+    if (!m_asset_cache.init(m_sampler))
+    {
+        spdlog::error("App::init: failed to initialize asset cache");
+        return false;
+    }
+    m_deletion_queue.add([this] { m_asset_cache.destroy(); });
+    spdlog::trace("App::init: initialized asset cache");
+
+    if (!m_forward_pass.init(m_asset_cache.get_texture_set_layout()))
+    {
+        spdlog::error("App::init: failed to forward render pass");
+        return false;
+    }
+    spdlog::trace("App::init: forward pass initialized");
+
+    if (!m_hiz_pass.init(m_forward_pass.get_depth_image()))
+    {
+        spdlog::error("App::init: failed to depth pyramid pass");
+        return false;
+    }
+    spdlog::trace("App::init: depth pyramid pass initialized");
+
+    if (!m_cull_pass.init(m_hiz_pass))
+    {
+        spdlog::error("App::init: failed to cull pass");
+        return false;
+    }
+    spdlog::trace("App::init: cull pass initialized");
+
+    if (!m_engine.is_headless())
+    {
+        if (!m_imgui_pass.init())
+        {
+            spdlog::error("App::init: failed to imgui render pass");
+            return false;
+        }
+        spdlog::trace("App::init: imgui pass initialized");
+    }
+    else
+    {
+        VkExtent2D extent = m_engine.get_render_extent();
+        m_scene.camera.aspect =
+            static_cast<float>(extent.width) / static_cast<float>(extent.height);
+    }
+
+    if (!create_scene_from_file(m_options.scene_path, m_scene))
     {
         destroy_scene(m_scene);
         spdlog::error("App::init: failed to load scene from file");
@@ -118,6 +248,16 @@ void App::run()
             continue;
         }
 
+        if (m_reload_scene)
+        {
+            m_reload_scene = false;
+            if (!reload_scene())
+            {
+                spdlog::error("App::run: failed to reload scene");
+                return;
+            }
+        }
+
         if (!render_frame())
         {
             spdlog::error("App::run: failed to render frame");
@@ -127,8 +267,208 @@ void App::run()
     spdlog::trace("App::run: exited main loop");
 }
 
+[[nodiscard]] bool App::run_benchmark()
+{
+    spdlog::info(
+        "App::run_benchmark: rendering {} warm-up and {} measured frames at {}x{}",
+        m_options.warmup_frame_count,
+        m_options.frame_count,
+        m_engine.get_render_extent().width,
+        m_engine.get_render_extent().height
+    );
+
+    GPUProfiler &gpu_profiler = m_engine.get_gpu_profiler();
+    if (!gpu_profiler.is_enabled())
+    {
+        spdlog::warn("App::run_benchmark: gpu timestamps unavailable, gpu times will be omitted");
+    }
+
+    uint32_t total_frame_count = m_options.warmup_frame_count + m_options.frame_count;
+    std::vector<FrameTiming> timings(total_frame_count);
+
+    uint64_t first_frame_number = m_engine.get_frame_number();
+    uint32_t frame_pass_id = gpu_profiler.get_pass_id("Frame");
+    double pixel_count = static_cast<double>(m_engine.get_render_extent().width) *
+                         static_cast<double>(m_engine.get_render_extent().height);
+    gpu_profiler.set_resolve_callback(
+        [&](uint64_t frame_number, std::span<const double> pass_times_ms,
+            int64_t fragment_invocations) {
+            uint64_t idx = frame_number - first_frame_number;
+            if (idx >= timings.size())
+            {
+                return;
+            }
+            if (frame_pass_id < pass_times_ms.size())
+            {
+                timings[idx].gpu_time_ms = pass_times_ms[frame_pass_id];
+            }
+            if (fragment_invocations >= 0)
+            {
+                timings[idx].overdraw = static_cast<double>(fragment_invocations) / pixel_count;
+            }
+        }
+    );
+
+    // Measured frames should not depend on how far streaming has progressed.
+    if (!m_engine.get_upload_manager().finish())
+    {
+        spdlog::error("App::run_benchmark: failed to finish scene uploads");
+        return false;
+    }
+
+    bool success = true;
+    for (uint32_t i = 0; i < total_frame_count; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (!render_headless_frame())
+        {
+            spdlog::error("App::run_benchmark: failed to render frame #{}", i);
+            success = false;
+            break;
+        }
+        auto end = std::chrono::steady_clock::now();
+        timings[i].cpu_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+        if (m_options.software_occlusion && !m_options.gpu_culling)
+        {
+            const OcclusionStats &occlusion = m_occlusion_buffer.get_stats();
+            timings[i].occlusion_time_ms = occlusion.time_ms;
+            timings[i].occlusion_rejection = occlusion.get_rejection_rate();
+        }
+    }
+
+    if (!m_engine.wait_idle())
+    {
+        spdlog::error("App::run_benchmark: failed to wait for outstanding frames");
+        success = false;
+    }
+    gpu_profiler.set_resolve_callback(nullptr);
+
+    if (!success)
+    {
+        return false;
+    }
+
+    std::span<const FrameTiming> measured(
+        timings.begin() + m_options.warmup_frame_count,
+        m_options.frame_count
+    );
+
+    double total_cpu_time_ms = 0.0;
+    for (const FrameTiming &timing : measured)
+    {
+        total_cpu_time_ms += timing.cpu_time_ms;
+    }
+    spdlog::info(
+        "App::run_benchmark: average frame time = {:.3f} ms ({:.1f} fps)",
+        total_cpu_time_ms / measured.size(),
+        1000.0 * measured.size() / total_cpu_time_ms
+    );
+
+    if (!write_benchmark_report(
+            m_options.report_path,
+            m_options,
+            m_engine.get_device_name(),
+            measured
+        ))
+    {
+        spdlog::error("App::run_benchmark: failed to write benchmark report");
+        return false;
+    }
+    spdlog::info("App::run_benchmark: wrote report to {}", m_options.report_path);
+
+    return true;
+}
+
+void App::render_scene(VkCommandBuffer cmd_buffer)
+{
+    GPUProfiler &gpu_profiler = m_engine.get_gpu_profiler();
+    ForwardSettings settings{
+        .gpu_culling = m_options.gpu_culling,
+        .depth_prepass = m_options.depth_prepass,
+        .overdraw_view = m_overdraw_view,
+        .parallel_recording = m_options.parallel_recording,
+    };
+    bool occlusion_culling = m_options.gpu_culling && m_options.occlusion_culling;
+
+    if (m_options.gpu_culling)
+    {
+        uint32_t cull_scope = gpu_profiler.begin_scope(cmd_buffer, "Cull");
+        m_cull_pass.render(
+            cmd_buffer,
+            m_scene,
+            m_lod_scale,
+            occlusion_culling ? CullPhase::First : CullPhase::All
+        );
+        gpu_profiler.end_scope(cmd_buffer, cull_scope);
+    }
+
+    uint32_t forward_scope = gpu_profiler.begin_scope(cmd_buffer, "Forward");
+    gpu_profiler.begin_statistics(cmd_buffer);
+    m_forward_pass.render(
+        cmd_buffer,
+        m_scene,
+        m_asset_cache.get_texture_set(),
+        settings,
+        m_draw_list.get_items(),
+        false
+    );
+    gpu_profiler.end_scope(cmd_buffer, forward_scope);
+
+    // What was visible in the last frame is drawn first, its depth then decides which of the
+    // remaining meshlets are hidden.
+    if (occlusion_culling)
+    {
+        uint32_t hiz_scope = gpu_profiler.begin_scope(cmd_buffer, "Hi-Z");
+        m_hiz_pass.render(cmd_buffer);
+        gpu_profiler.end_scope(cmd_buffer, hiz_scope);
+
+        uint32_t cull_scope = gpu_profiler.begin_scope(cmd_buffer, "Cull Occluded");
+        m_cull_pass.render(cmd_buffer, m_scene, m_lod_scale, CullPhase::Second);
+        gpu_profiler.end_scope(cmd_buffer, cull_scope);
+
+        forward_scope = gpu_profiler.begin_scope(cmd_buffer, "Forward Occluded");
+        m_forward_pass.render(
+            cmd_buffer,
+            m_scene,
+            m_asset_cache.get_texture_set(),
+            settings,
+            m_draw_list.get_items(),
+            true
+        );
+        gpu_profiler.end_scope(cmd_buffer, forward_scope);
+    }
+    gpu_profiler.end_statistics(cmd_buffer);
+}
+
+[[nodiscard]] bool App::render_headless_frame()
+{
+    CPU_ZONE("App::render_headless_frame");
+
+    build_draw_list();
+
+    VkCommandBuffer cmd_buffer;
+    uint32_t swapchain_image_idx;
+    if (!m_engine.start_frame(cmd_buffer, swapchain_image_idx))
+    {
+        spdlog::error("App::render_headless_frame: failed to start frame");
+        return false;
+    }
+
+    render_scene(cmd_buffer);
+
+    if (!m_engine.finish_frame(swapchain_image_idx))
+    {
+        spdlog::error("App::render_headless_frame: failed to finish frame");
+        return false;
+    }
+
+    return true;
+}
+
 [[nodiscard]] bool App::render_frame()
 {
+    CPU_ZONE("App::render_frame");
+
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplSDL3_NewFrame();
     ImGui::NewFrame();
@@ -137,6 +477,8 @@ void App::run()
 
     ImGui::Render();
 
+    build_draw_list();
+
     VkCommandBuffer cmd_buffer;
     uint32_t swapchain_image_idx;
     if (!m_engine.start_frame(cmd_buffer, swapchain_image_idx))
@@ -145,8 +487,10 @@ void App::run()
         return false;
     }
 
-    m_forward_pass.render(cmd_buffer, m_scene);
+    render_scene(cmd_buffer);
 
+    GPUProfiler &gpu_profiler = m_engine.get_gpu_profiler();
+    uint32_t blit_scope = gpu_profiler.begin_scope(cmd_buffer, "Blit");
     transition_image(
         cmd_buffer,
         m_forward_pass.get_output_image().image,
@@ -170,8 +514,11 @@ void App::run()
             .depth = 1,
         }
     );
+    gpu_profiler.end_scope(cmd_buffer, blit_scope);
 
+    uint32_t imgui_scope = gpu_profiler.begin_scope(cmd_buffer, "ImGui");
     m_imgui_pass.render(cmd_buffer, swapchain_image_idx);
+    gpu_profiler.end_scope(cmd_buffer, imgui_scope);
 
     transition_image(
         cmd_buffer,
@@ -191,6 +538,8 @@ void App::run()
 
 void App::build_ui()
 {
+    CPU_ZONE("App::build_ui");
+
     ImGui::Begin(
         "Statistics",
         nullptr,
@@ -198,6 +547,108 @@ void App::build_ui()
     );
     {
         ImGui::Text("Frame Time (sec): %f", m_delta_time / 1000.0);
+        ImGui::Text(
+            "Textures: %zu (%.1f MiB)",
+            m_asset_cache.get_resident_texture_count(),
+            static_cast<double>(m_asset_cache.get_resident_texture_bytes()) / (1024.0 * 1024.0)
+        );
+        GeometryBuffer &geometry_buffer = m_engine.get_geometry_buffer();
+        ImGui::Text(
+            "Geometry: %.1f / %.1f MiB",
+            static_cast<double>(geometry_buffer.get_used_bytes()) / (1024.0 * 1024.0),
+            static_cast<double>(geometry_buffer.get_capacity_bytes()) / (1024.0 * 1024.0)
+        );
+
+        if (m_options.gpu_culling)
+        {
+            const CullStatistics &statistics = m_cull_pass.get_statistics();
+            ImGui::Text(
+                "Objects: %zu, %u in frustum, %u visible",
+                m_scene.objects.size(),
+                statistics.frustum_object_count,
+                statistics.visible_object_count
+            );
+            ImGui::Text(
+                "Meshlets: %u, %u + %u drawn, %u occluded",
+                m_scene.gpu_meshlet_count,
+                statistics.first_phase_meshlet_count,
+                statistics.second_phase_meshlet_count,
+                statistics.occluded_meshlet_count
+            );
+        }
+        else
+        {
+            ImGui::Text(
+                "Objects: %zu / %zu visible",
+                m_visible_objects.size(),
+                m_scene.objects.size()
+            );
+            ImGui::Text(
+                "Triangles: %llu",
+                static_cast<unsigned long long>(m_draw_list.get_triangle_count())
+            );
+            if (m_options.software_occlusion)
+            {
+                const OcclusionStats &occlusion = m_occlusion_buffer.get_stats();
+                ImGui::Text(
+                    "Occlusion: %.3f ms, %u / %u occluded (%.0f%%), %u occluders",
+                    occlusion.time_ms,
+                    occlusion.occluded_count,
+                    occlusion.tested_count,
+                    occlusion.get_rejection_rate() * 100.0,
+                    occlusion.occluder_count
+                );
+            }
+        }
+
+        GPUProfiler &gpu_profiler = m_engine.get_gpu_profiler();
+        if (gpu_profiler.is_enabled())
+        {
+            ImGui::SeparatorText("GPU");
+            if (ImGui::BeginTable("gpu_passes", 3))
+            {
+                ImGui::TableSetupColumn("Pass");
+                ImGui::TableSetupColumn("Last (ms)");
+                ImGui::TableSetupColumn("Avg (ms)");
+                ImGui::TableHeadersRow();
+                for (const GPUPassStats &pass : gpu_profiler.get_passes())
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(pass.name.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", pass.last_ms);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", pass.average_ms);
+                }
+                ImGui::EndTable();
+            }
+
+            // Fragments culled by early depth tests are not shaded and not counted.
+            VkExtent2D render_extent = m_engine.get_render_extent();
+            ImGui::Text(
+                "Overdraw: %.2f fragments/pixel",
+                static_cast<double>(gpu_profiler.get_fragment_invocations()) /
+                    (static_cast<double>(render_extent.width) * render_extent.height)
+            );
+
+            if (ImGui::Button("Export CSV"))
+            {
+                if (!gpu_profiler.export_csv("gpu_timings.csv"))
+                {
+                    spdlog::error("App::build_ui: failed to export gpu timings");
+                }
+            }
+        }
+
+        ImGui::SeparatorText("CPU");
+        if (ImGui::Button("Save Trace"))
+        {
+            if (!CPUProfiler::write_chrome_trace("cpu_trace.json"))
+            {
+                spdlog::error("App::build_ui: failed to write cpu trace");
+            }
+        }
     }
     ImGui::End();
 
@@ -209,6 +660,18 @@ void App::build_ui()
     {
         ImGui::SeparatorText("General");
         ImGui::ColorEdit3("Background", m_scene.background_color.data());
+        if (ImGui::Button("Reload Scene"))
+        {
+            m_reload_scene = true;
+        }
+        ImGui::Checkbox("GPU Culling", &m_options.gpu_culling);
+        ImGui::Checkbox("Occlusion Culling", &m_options.occlusion_culling);
+        ImGui::Checkbox("BVH Culling", &m_bvh_culling);
+        ImGui::Checkbox("Software Occlusion", &m_options.software_occlusion);
+        ImGui::Checkbox("Depth Pre-Pass", &m_options.depth_prepass);
+        ImGui::Checkbox("Parallel Recording", &m_options.parallel_recording);
+        ImGui::Checkbox("Overdraw View", &m_overdraw_view);
+        ImGui::SliderFloat("LOD Error (px)", &m_max_lod_error, 0.25f, 16.0f);
         ImGui::SeparatorText("Camera");
         ImGui::DragFloat3("Position", glm::value_ptr(m_scene.camera.eye), 0.1f);
         ImGui::SliderFloat("Pitch", &m_scene.camera.rotation.x, -90.0f, 90.0f);
@@ -217,296 +680,516 @@ void App::build_ui()
     ImGui::End();
 }
 
-[[nodiscard]] bool
-App::create_mesh(std::span<Vertex> vertices, std::span<uint32_t> indices, Mesh &out_mesh)
+void App::build_draw_list()
 {
-    VkDeviceSize vertex_buffer_size = vertices.size() * sizeof(Vertex);
-    VkDeviceSize index_buffer_size = indices.size() * sizeof(uint32_t);
+    CPU_ZONE("App::build_draw_list");
 
-    GPUBuffer transfer_buffer;
-    if (!m_engine.create_buffer(
-            VMA_MEMORY_USAGE_CPU_TO_GPU,
-            vertex_buffer_size + index_buffer_size,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            transfer_buffer
+    m_lod_scale = m_scene.camera.get_lod_scale(
+        static_cast<float>(m_engine.get_render_extent().height),
+        m_max_lod_error
+    );
+
+    m_visible_objects.clear();
+    if (!m_options.gpu_culling)
+    {
+        Frustum frustum = extract_frustum(m_scene.camera.get_matrix());
+        if (m_bvh_culling)
+        {
+            m_scene.bvh.query_frustum(frustum, m_visible_objects);
+        }
+        else
+        {
+            cull_objects(frustum, m_scene.object_bounds, m_visible_objects);
+        }
+
+        if (m_options.software_occlusion)
+        {
+            m_occlusion_buffer.cull(m_engine.get_thread_pool(), m_scene, m_visible_objects);
+        }
+    }
+
+    m_draw_list.build(m_scene, m_visible_objects, m_lod_scale);
+}
+
+[[nodiscard]] bool App::create_mesh(
+    std::span<const Vertex> vertices, std::span<const uint32_t> indices, Mesh &out_mesh
+)
+{
+    CPU_ZONE("App::create_mesh");
+
+    out_mesh.bounding_box = compute_bounding_box(vertices);
+    out_mesh.bounding_sphere = compute_bounding_sphere(out_mesh.bounding_box);
+
+    // Quantized positions are relative to the mesh's bounding box, see `create_object_buffers`.
+    GeometryBuffer &geometry_buffer = m_engine.get_geometry_buffer();
+    std::vector<QuantizedVertex> quantized_vertices;
+    std::span<const std::byte> vertex_data = std::as_bytes(vertices);
+    if (geometry_buffer.get_vertex_format() == VertexFormat::Quantized)
+    {
+        quantize_vertices(
+            vertices,
+            out_mesh.bounding_box.min,
+            out_mesh.bounding_box.max - out_mesh.bounding_box.min,
+            quantized_vertices
+        );
+        vertex_data = std::as_bytes(std::span(quantized_vertices));
+    }
+
+    if (!geometry_buffer.allocate(
+            vertex_data,
+            indices,
+            out_mesh.vertices,
+            out_mesh.indices,
+            out_mesh.index_type
         ))
     {
-        spdlog::error("App::create_mesh: failed to allocate transfer buffer");
+        spdlog::error("App::create_mesh: failed to allocate geometry");
         return false;
     }
+    out_mesh.ready_value = m_engine.get_upload_manager().get_last_upload_value();
+
+    return true;
+}
+
+void App::destroy_mesh(Mesh &mesh)
+{
+    m_engine.get_geometry_buffer().free(mesh.vertices, mesh.indices, mesh.index_type);
+    mesh.vertices = {};
+    mesh.indices = {};
+}
+
+[[nodiscard]] bool App::create_material_buffer(Scene &scene)
+{
+    CPU_ZONE("App::create_material_buffer");
+
+    if (scene.materials.empty())
+    {
+        return true;
+    }
+
+    std::vector<GPUMaterial> gpu_materials;
+    gpu_materials.reserve(scene.materials.size());
+    for (const Material &material : scene.materials)
+    {
+        gpu_materials.emplace_back(GPUMaterial{
+            .diffuse_texture = material.diffuse,
+        });
+    }
 
     if (!m_engine.create_buffer(
             VMA_MEMORY_USAGE_GPU_ONLY,
-            vertex_buffer_size,
+            gpu_materials.size() * sizeof(GPUMaterial),
             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
                 VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-            out_mesh.vertex_buffer
+            scene.material_buffer
         ))
     {
-        m_engine.destroy_buffer(transfer_buffer);
-        spdlog::error("App::create_mesh: failed to allocate vertex buffer");
+        spdlog::error("App::create_material_buffer: failed to allocate material buffer");
         return false;
     }
 
-    if (!m_engine.create_buffer(
-            VMA_MEMORY_USAGE_GPU_ONLY,
-            index_buffer_size,
-            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            out_mesh.index_buffer
-        ))
+    UploadManager &upload_manager = m_engine.get_upload_manager();
+    std::span<const std::byte> data = std::as_bytes(std::span(gpu_materials));
+    if (!upload_manager.upload_buffer(scene.material_buffer, 0, data))
     {
-        m_engine.destroy_buffer(transfer_buffer);
-        m_engine.destroy_buffer(out_mesh.vertex_buffer);
-        spdlog::error("App::create_mesh: failed to allocate index buffer");
+        spdlog::error("App::create_material_buffer: failed to upload materials");
         return false;
     }
 
-    std::memcpy(transfer_buffer.allocation_info.pMappedData, vertices.data(), vertex_buffer_size);
-    std::memcpy(
-        reinterpret_cast<uint8_t *>(transfer_buffer.allocation_info.pMappedData) +
-            vertex_buffer_size,
-        indices.data(),
-        index_buffer_size
-    );
+    scene.material_buffer_address = m_engine.get_buffer_address(scene.material_buffer);
 
-    if (!m_engine.immediate_submit([&](VkCommandBuffer cmd_buffer) {
-            VkBufferCopy copy_vertex_region{
-                .srcOffset = 0,
-                .dstOffset = 0,
-                .size = vertex_buffer_size,
-            };
-            vkCmdCopyBuffer(
-                cmd_buffer,
-                transfer_buffer.buffer,
-                out_mesh.vertex_buffer.buffer,
-                1,
-                &copy_vertex_region
-            );
-
-            VkBufferCopy copy_index_region{
-                .srcOffset = vertex_buffer_size,
-                .dstOffset = 0,
-                .size = index_buffer_size,
-            };
-            vkCmdCopyBuffer(
-                cmd_buffer,
-                transfer_buffer.buffer,
-                out_mesh.index_buffer.buffer,
-                1,
-                &copy_index_region
-            );
-        }))
+    // Materials may only be drawn once their entry has been uploaded as well.
+    uint64_t ready_value = upload_manager.get_last_upload_value();
+    for (Material &material : scene.materials)
     {
-        m_engine.destroy_buffer(transfer_buffer);
-        m_engine.destroy_buffer(out_mesh.vertex_buffer);
-        m_engine.destroy_buffer(out_mesh.index_buffer);
-
-        spdlog::error("App::create_mesh: failed to copy data to vertex buffer");
-        return false;
+        material.ready_value = std::max(material.ready_value, ready_value);
     }
 
-    VkBufferDeviceAddressInfo address_info = {};
-    address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
-    address_info.buffer = out_mesh.vertex_buffer.buffer;
-    out_mesh.vertex_buffer_address = vkGetBufferDeviceAddress(m_engine.get_device(), &address_info);
-
-    out_mesh.index_count = indices.size();
-
-    m_engine.destroy_buffer(transfer_buffer);
-
     return true;
 }
 
-void App::destroy_mesh(Mesh &mesh)
+void App::destroy_material(Material &material)
 {
-    m_engine.destroy_buffer(mesh.vertex_buffer);
-    m_engine.destroy_buffer(mesh.index_buffer);
+    m_asset_cache.release(material.diffuse);
+    material.diffuse = INVALID_TEXTURE;
 }
 
-[[nodiscard]] bool App::create_material_from_file(
-    const std::string &diffuse_path, VkDescriptorSetLayout set_layout, Material &out_material
-)
+[[nodiscard]] bool App::create_object_buffers(Scene &scene)
 {
-    if (!m_engine.create_image_from_file(diffuse_path, out_material.diffuse))
+    CPU_ZONE("App::create_object_buffers");
+
+    // Meshlets are culled per object, so each object gets its own copy of its mesh's meshlets.
+    // Those of every level of detail are included, the cull pass only keeps the selected one.
+    std::vector<GPUMeshlet> gpu_meshlets;
+    for (uint32_t object_idx = 0; object_idx < scene.objects.size(); ++object_idx)
     {
-        spdlog::error("App::create_material_from_file: failed to load diffuse image");
+        const Mesh &mesh = scene.meshes[scene.objects[object_idx].mesh_idx];
+        for (uint32_t lod_idx = 0; lod_idx < mesh.lod_count; ++lod_idx)
+        {
+            const MeshLod &lod = mesh.lods[lod_idx];
+            float coarser_lod_error = lod_idx + 1 < mesh.lod_count
+                                          ? mesh.lods[lod_idx + 1].error
+                                          : std::numeric_limits<float>::max();
+            for (uint32_t i = 0; i < lod.meshlet_count; ++i)
+            {
+                const Meshlet &meshlet =
+                    scene.meshlets[mesh.meshlet_offset + lod.meshlet_offset + i];
+                gpu_meshlets.emplace_back(GPUMeshlet{
+                    .bounding_sphere =
+                        glm::vec4(meshlet.bounding_sphere.center, meshlet.bounding_sphere.radius),
+                    .cone = glm::vec4(meshlet.cone_axis, meshlet.cone_cutoff),
+                    .lod_sphere =
+                        glm::vec4(mesh.bounding_sphere.center, mesh.bounding_sphere.radius),
+                    .first_index = mesh.indices.offset + meshlet.index_offset,
+                    .index_count = meshlet.index_count,
+                    .vertex_offset = static_cast<int32_t>(mesh.vertices.offset),
+                    .object_index = object_idx,
+                    .wide_indices = mesh.index_type == VK_INDEX_TYPE_UINT32 ? 1u : 0u,
+                    .lod_error = lod.error,
+                    .coarser_lod_error = coarser_lod_error,
+                    .padding = 0,
+                });
+            }
+        }
+    }
+    // Without objects or with only empty meshes nothing is ever drawn.
+    if (gpu_meshlets.empty())
+    {
+        return true;
+    }
+
+    std::vector<GPUObject> gpu_objects;
+    gpu_objects.reserve(scene.objects.size());
+    for (const Object &object : scene.objects)
+    {
+        const Mesh &mesh = scene.meshes[object.mesh_idx];
+        gpu_objects.emplace_back(GPUObject{
+            .first_index = mesh.indices.offset,
+            .index_count = mesh.indices.count,
+            .vertex_offset = static_cast<int32_t>(mesh.vertices.offset),
+            .material_index = static_cast<uint32_t>(mesh.material_idx),
+            .bounding_sphere =
+                glm::vec4(mesh.bounding_sphere.center, mesh.bounding_sphere.radius),
+            .position_offset = mesh.bounding_box.min,
+            .wide_indices = mesh.index_type == VK_INDEX_TYPE_UINT32 ? 1u : 0u,
+            .position_scale = mesh.bounding_box.max - mesh.bounding_box.min,
+            .padding = 0,
+        });
+    }
+
+    if (!m_engine.create_buffer(
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            gpu_objects.size() * sizeof(GPUObject),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            scene.object_buffer
+        ))
+    {
+        spdlog::error("App::create_object_buffers: failed to allocate object buffer");
         return false;
     }
+    scene.object_buffer_address = m_engine.get_buffer_address(scene.object_buffer);
 
-    VkDescriptorSetAllocateInfo set_info = {};
-    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    set_info.descriptorPool = m_engine.get_descriptor_pool();
-    set_info.descriptorSetCount = 1;
-    set_info.pSetLayouts = &set_layout;
-    if (VkResult res =
-            vkAllocateDescriptorSets(m_engine.get_device(), &set_info, &out_material.diffuse_set);
-        res != VK_SUCCESS)
+    if (!m_engine.create_buffer(
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            gpu_meshlets.size() * sizeof(GPUMeshlet),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            scene.meshlet_buffer
+        ))
     {
-        m_engine.destroy_image(out_material.diffuse);
-        spdlog::error(
-            "App::create_material_from_file: failed to allocate descriptor set: res = {}",
-            static_cast<int>(res)
-        );
+        spdlog::error("App::create_object_buffers: failed to allocate meshlet buffer");
         return false;
     }
+    scene.meshlet_buffer_address = m_engine.get_buffer_address(scene.meshlet_buffer);
+    scene.gpu_meshlet_count = static_cast<uint32_t>(gpu_meshlets.size());
 
-    VkDescriptorImageInfo image_info{
-        .sampler = m_sampler,
-        .imageView = out_material.diffuse.view,
-        .imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
-    };
+    if (!m_engine.create_buffer(
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            DRAW_COUNTS_SIZE + 2 * gpu_meshlets.size() * sizeof(VkDrawIndexedIndirectCommand),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            scene.draw_buffer
+        ))
+    {
+        spdlog::error("App::create_object_buffers: failed to allocate draw buffer");
+        return false;
+    }
+    scene.draw_buffer_address = m_engine.get_buffer_address(scene.draw_buffer);
 
-    VkWriteDescriptorSet write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.dstSet = out_material.diffuse_set;
-    write.dstBinding = 0;
-    write.dstArrayElement = 0;
-    write.descriptorCount = 1;
-    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    write.pImageInfo = &image_info;
-    vkUpdateDescriptorSets(m_engine.get_device(), 1, &write, 0, nullptr);
+    size_t visibility_count = gpu_meshlets.size() + gpu_objects.size();
+    if (!m_engine.create_buffer(
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            visibility_count * sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            scene.visibility_buffer
+        ))
+    {
+        spdlog::error("App::create_object_buffers: failed to allocate visibility buffer");
+        return false;
+    }
+    scene.visibility_buffer_address = m_engine.get_buffer_address(scene.visibility_buffer);
 
-    return true;
-}
+    UploadManager &upload_manager = m_engine.get_upload_manager();
+    std::span<const std::byte> data = std::as_bytes(std::span(gpu_meshlets));
+    if (!upload_manager.upload_buffer(scene.meshlet_buffer, 0, data))
+    {
+        spdlog::error("App::create_object_buffers: failed to upload meshlets");
+        return false;
+    }
+    // Nothing is visible before the first frame, so the first phase of occlusion culling draws
+    // nothing and the second one everything that passes.
+    std::vector<uint32_t> visibility(visibility_count, 0);
+    data = std::as_bytes(std::span(visibility));
+    if (!upload_manager.upload_buffer(scene.visibility_buffer, 0, data))
+    {
+        spdlog::error("App::create_object_buffers: failed to upload visibility");
+        return false;
+    }
+    data = std::as_bytes(std::span(gpu_objects));
+    if (!upload_manager.upload_buffer(scene.object_buffer, 0, data))
+    {
+        spdlog::error("App::create_object_buffers: failed to upload objects");
+        return false;
+    }
 
-void App::destroy_material(Material &material)
-{
-    m_engine.destroy_image(material.diffuse);
+    // The object buffer is uploaded after all meshes, materials and meshlets, so once it is
+    // resident everything the culled draws reference is as well.
+    scene.ready_value = upload_manager.get_last_upload_value();
+
+    return true;
 }
 
 [[nodiscard]] bool App::create_scene_from_file(const std::string &path, Scene &out_scene)
 {
-    Assimp::Importer importer;
+    CPU_ZONE("App::create_scene_from_file");
 
-    const aiScene *scene = importer.ReadFile(
-        path.c_str(),
-        aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_FlipUVs
-    );
-    if (scene == nullptr)
+    // Imported scenes are baked into a cache so later loads can skip Assimp entirely.
+    SceneData scene;
+    std::string cache_path = get_scene_cache_path(path);
+    if (!read_scene_cache(cache_path, scene))
     {
-        spdlog::error("App::create_scene_from_file: failed to load file");
-        return false;
-    }
+        if (!import_scene(path, scene))
+        {
+            spdlog::error("App::create_scene_from_file: failed to import scene {}", path);
+            return false;
+        }
 
-    if (scene->mRootNode == nullptr)
-    {
-        spdlog::error("App::create_scene_from_file: file has no root node");
-        return false;
+        if (!write_scene_cache(cache_path, scene))
+        {
+            spdlog::warn("App::create_scene_from_file: failed to write scene cache");
+        }
     }
 
-    for (size_t mat_idx = 0; mat_idx < scene->mNumMaterials; ++mat_idx)
+    // Materials without a diffuse texture use the cache's built-in white texture, every other
+    // material refers to one of the unique texture paths of the scene.
+    std::vector<std::string> texture_paths;
+    std::unordered_map<std::string, size_t> texture_indices;
+    std::vector<size_t> material_textures;
+    for (const std::string &diffuse_name : scene.material_textures)
     {
-        Material material;
-
-        const aiMaterial *ai_material = scene->mMaterials[mat_idx];
-        if (ai_material->GetTextureCount(aiTextureType_DIFFUSE) == 0)
+        if (diffuse_name.empty())
         {
-            spdlog::warn(
-                "App::create_scene_from_file: no diffuse texture for material #{} (`{}`)",
-                mat_idx,
-                ai_material->GetName().C_Str()
-            );
+            material_textures.emplace_back(SIZE_MAX);
+            continue;
+        }
 
-            if (!create_material_from_file(
-                    "../assets/white.png",
-                    m_forward_pass.get_descriptor_set_layout(),
-                    material
-                ))
-            {
-                destroy_scene(out_scene);
-                spdlog::error("App::create_scene_from_file: failed to create fallback material");
-                return false;
-            }
+        std::string diffuse_path = resolve_texture_path(
+            m_engine.get_asset_archive(),
+            (std::filesystem::path(path).parent_path() / diffuse_name).string()
+        );
+
+        auto [it, inserted] = texture_indices.emplace(diffuse_path, texture_paths.size());
+        if (inserted)
+        {
+            texture_paths.emplace_back(diffuse_path);
         }
-        else
+        material_textures.emplace_back(it->second);
+    }
+
+    // Textures whose file is unchanged since it was last loaded are resolved by the cache right
+    // away. The rest are read, hashed and, unless a texture with the same contents is already
+    // resident, decoded on the worker pool. They are added to the cache in the order the loads
+    // complete, so uploads overlap with the loads still in progress.
+    std::vector<TextureHandle> textures(texture_paths.size(), INVALID_TEXTURE);
+    std::vector<TextureLoad> texture_loads(texture_paths.size());
+    std::unordered_set<uint64_t> resident_hashes = m_asset_cache.get_content_hashes();
+    std::mutex loaded_mutex;
+    std::condition_variable loaded_cv;
+    std::vector<size_t> loaded_order;
+    loaded_order.reserve(texture_paths.size());
+
+    size_t pending_count = 0;
+    for (size_t tex_idx = 0; tex_idx < texture_paths.size(); ++tex_idx)
+    {
+        if (m_asset_cache.find_texture(texture_paths[tex_idx], textures[tex_idx]))
         {
-            aiString diffuse_name;
-            ai_material->GetTexture(aiTextureType_DIFFUSE, 0, &diffuse_name);
-
-            std::string diffuse_path = std::string("../assets/sponza/") + diffuse_name.C_Str();
-            if (!create_material_from_file(
-                    diffuse_path,
-                    m_forward_pass.get_descriptor_set_layout(),
-                    material
-                ))
-            {
-                destroy_scene(out_scene);
-                spdlog::error(
-                    "App::create_scene_from_file: failed to create material #{} (`{}`)",
-                    mat_idx,
-                    ai_material->GetName().C_Str()
-                );
-                return false;
-            }
+            continue;
         }
 
-        out_scene.materials.emplace_back(material);
+        texture_loads[tex_idx].path = texture_paths[tex_idx];
+        pending_count += 1;
+        m_engine.get_thread_pool().submit([&, tex_idx] {
+            load_texture(m_engine.get_asset_archive(), texture_loads[tex_idx], resident_hashes);
+
+            std::lock_guard lock(loaded_mutex);
+            loaded_order.emplace_back(tex_idx);
+            loaded_cv.notify_one();
+        });
     }
+    spdlog::debug(
+        "App::create_scene_from_file: {} of {} textures already resident",
+        texture_paths.size() - pending_count,
+        texture_paths.size()
+    );
 
-    for (size_t mesh_idx = 0; mesh_idx < scene->mNumMeshes; ++mesh_idx)
+    // Every load has to be waited for even after a failure, as they reference the state above.
+    bool textures_success = true;
+    for (size_t i = 0; i < pending_count; ++i)
     {
-        std::vector<Vertex> vertices;
-        std::vector<uint32_t> indices;
+        size_t tex_idx;
+        {
+            CPU_ZONE("wait for texture load");
+            std::unique_lock lock(loaded_mutex);
+            loaded_cv.wait(lock, [&] { return loaded_order.size() > i; });
+            tex_idx = loaded_order[i];
+        }
+
+        TextureLoad &load = texture_loads[tex_idx];
+        if (!textures_success || !load.success)
+        {
+            textures_success = false;
+            continue;
+        }
 
-        const aiMesh *ai_mesh = scene->mMeshes[mesh_idx];
-        for (size_t vertex_idx = 0; vertex_idx < ai_mesh->mNumVertices; ++vertex_idx)
+        CPU_ZONE("add texture");
+        bool added;
+        if (!load.image.data.empty())
+        {
+            added = m_asset_cache.add_texture(
+                load.path,
+                load.content_hash,
+                load.image,
+                textures[tex_idx]
+            );
+        }
+        else
         {
-            Vertex vertex{
-                .position =
-                    {
-                        ai_mesh->mVertices[vertex_idx].x,
-                        ai_mesh->mVertices[vertex_idx].y,
-                        ai_mesh->mVertices[vertex_idx].z,
-                    },
-                .tex_coord_x = ai_mesh->mTextureCoords[0][vertex_idx].x,
-                .normal =
-                    {
-                        ai_mesh->mNormals[vertex_idx].x,
-                        ai_mesh->mNormals[vertex_idx].y,
-                        ai_mesh->mNormals[vertex_idx].z,
-                    },
-                .tex_coord_y = ai_mesh->mTextureCoords[0][vertex_idx].y,
-            };
-            vertices.emplace_back(vertex);
+            added = m_asset_cache.find_texture(load.path, load.content_hash, textures[tex_idx]);
         }
+        if (!added)
+        {
+            spdlog::error("App::create_scene_from_file: failed to add texture {}", load.path);
+            textures_success = false;
+        }
+        load.image = {};
+    }
 
-        for (size_t face_idx = 0; face_idx < ai_mesh->mNumFaces; ++face_idx)
+    if (textures_success)
+    {
+        for (size_t mat_idx = 0; mat_idx < material_textures.size(); ++mat_idx)
         {
-            const aiFace *face = &ai_mesh->mFaces[face_idx];
-            for (size_t index_idx = 0; index_idx < face->mNumIndices; ++index_idx)
+            TextureHandle diffuse = material_textures[mat_idx] == SIZE_MAX
+                                        ? m_asset_cache.acquire_white_texture()
+                                        : textures[material_textures[mat_idx]];
+            if (material_textures[mat_idx] != SIZE_MAX)
             {
-                indices.emplace_back(static_cast<uint32_t>(face->mIndices[index_idx]));
+                m_asset_cache.acquire(diffuse);
             }
+
+            out_scene.materials.emplace_back(Material{
+                .diffuse = diffuse,
+                .ready_value = m_asset_cache.get_texture(diffuse).ready_value,
+            });
         }
+    }
+
+    // Materials hold their own references, the ones taken while resolving paths are dropped.
+    for (TextureHandle texture : textures)
+    {
+        m_asset_cache.release(texture);
+    }
+
+    if (!textures_success)
+    {
+        destroy_scene(out_scene);
+        spdlog::error("App::create_scene_from_file: failed to load textures");
+        return false;
+    }
+
+    if (!create_material_buffer(out_scene))
+    {
+        destroy_scene(out_scene);
+        spdlog::error("App::create_scene_from_file: failed to create material buffer");
+        return false;
+    }
+
+    for (size_t mesh_idx = 0; mesh_idx < scene.meshes.size(); ++mesh_idx)
+    {
+        CPU_ZONE("load mesh");
+
+        const SceneMesh &scene_mesh = scene.meshes[mesh_idx];
 
         Mesh mesh;
-        if (!create_mesh(vertices, indices, mesh))
+        if (!create_mesh(
+                scene.vertices.subspan(scene_mesh.vertex_offset, scene_mesh.vertex_count),
+                scene.indices.subspan(scene_mesh.index_offset, scene_mesh.index_count),
+                mesh
+            ))
         {
             destroy_scene(out_scene);
             spdlog::error("App::create_scene_from_file: failed to create mesh #{}", mesh_idx);
             return false;
         }
-        mesh.material_idx = ai_mesh->mMaterialIndex;
+        mesh.meshlet_offset = scene_mesh.meshlet_offset;
+        mesh.meshlet_count = scene_mesh.meshlet_count;
+        mesh.lod_count = scene_mesh.lod_count;
+        std::copy_n(scene.lods.begin() + scene_mesh.lod_offset, mesh.lod_count, mesh.lods.begin());
+        mesh.material_idx = scene_mesh.material_idx;
         out_scene.meshes.emplace_back(mesh);
+
+        out_scene.occluders.emplace_back(build_occluder_mesh(
+            scene.vertices.subspan(scene_mesh.vertex_offset, scene_mesh.vertex_count),
+            scene.indices.subspan(scene_mesh.index_offset, scene_mesh.index_count),
+            std::span(mesh.lods.data(), mesh.lod_count),
+            mesh.bounding_sphere
+        ));
     }
+    out_scene.meshlets.assign(scene.meshlets.begin(), scene.meshlets.end());
 
-    std::vector nodes_to_process{scene->mRootNode};
-    while (!nodes_to_process.empty())
+    std::vector<BoundingBox> object_boxes;
+    object_boxes.reserve(scene.object_meshes.size());
+    for (uint32_t mesh_idx : scene.object_meshes)
     {
-        const aiNode *node = nodes_to_process.back();
-        nodes_to_process.pop_back();
+        out_scene.objects.emplace_back(Object{
+            .mesh_idx = mesh_idx,
+        });
 
-        for (size_t i = 0; i < node->mNumChildren; ++i)
-        {
-            nodes_to_process.emplace_back(node->mChildren[i]);
-        }
+        const Mesh &mesh = out_scene.meshes[mesh_idx];
+        out_scene.object_bounds.push_back(mesh.bounding_sphere, mesh.bounding_box);
+        object_boxes.emplace_back(mesh.bounding_box);
+    }
 
-        for (unsigned int i = 0; i < node->mNumMeshes; ++i)
-        {
-            out_scene.objects.emplace_back(Object{
-                .mesh_idx = node->mMeshes[i],
-            });
-        }
+    {
+        CPU_ZONE("build bvh");
+        out_scene.bvh.build(object_boxes);
+    }
+    spdlog::debug("scene bvh has {} nodes", out_scene.bvh.get_node_count());
+
+    if (!create_object_buffers(out_scene))
+    {
+        destroy_scene(out_scene);
+        spdlog::error("App::create_scene_from_file: failed to create object buffers");
+        return false;
+    }
+
+    // Uploads complete in the background, objects are drawn once their data is resident.
+    if (!m_engine.get_upload_manager().flush())
+    {
+        destroy_scene(out_scene);
+        spdlog::error("App::create_scene_from_file: failed to flush uploads");
+        return false;
     }
 
     spdlog::debug("scene has {} objects", out_scene.objects.size());
@@ -516,6 +1199,11 @@ void App::destroy_material(Material &material)
 
 void App::destroy_scene(Scene &scene)
 {
+    if (!m_engine.get_upload_manager().finish())
+    {
+        spdlog::error("App::destroy_scene: failed to finish pending uploads");
+    }
+
     for (auto &mesh : scene.meshes)
     {
         destroy_mesh(mesh);
@@ -526,7 +1214,72 @@ void App::destroy_scene(Scene &scene)
         destroy_material(material);
     }
 
+    if (scene.material_buffer.buffer != VK_NULL_HANDLE)
+    {
+        m_engine.destroy_buffer(scene.material_buffer);
+        scene.material_buffer = {};
+        scene.material_buffer_address = 0;
+    }
+
+    if (scene.object_buffer.buffer != VK_NULL_HANDLE)
+    {
+        m_engine.destroy_buffer(scene.object_buffer);
+        scene.object_buffer = {};
+        scene.object_buffer_address = 0;
+    }
+
+    if (scene.meshlet_buffer.buffer != VK_NULL_HANDLE)
+    {
+        m_engine.destroy_buffer(scene.meshlet_buffer);
+        scene.meshlet_buffer = {};
+        scene.meshlet_buffer_address = 0;
+    }
+    scene.gpu_meshlet_count = 0;
+
+    if (scene.draw_buffer.buffer != VK_NULL_HANDLE)
+    {
+        m_engine.destroy_buffer(scene.draw_buffer);
+        scene.draw_buffer = {};
+        scene.draw_buffer_address = 0;
+    }
+
+    if (scene.visibility_buffer.buffer != VK_NULL_HANDLE)
+    {
+        m_engine.destroy_buffer(scene.visibility_buffer);
+        scene.visibility_buffer = {};
+        scene.visibility_buffer_address = 0;
+    }
+
+    scene.ready_value = 0;
+
     scene.meshes.clear();
+    scene.meshlets.clear();
     scene.materials.clear();
     scene.objects.clear();
+    scene.object_bounds.clear();
+    scene.bvh.clear();
+    scene.occluders.clear();
+}
+
+[[nodiscard]] bool App::reload_scene()
+{
+    CPU_ZONE("App::reload_scene");
+
+    if (!m_engine.wait_idle())
+    {
+        spdlog::error("App::reload_scene: failed to wait for outstanding frames");
+        return false;
+    }
+
+    destroy_scene(m_scene);
+    if (!create_scene_from_file(m_options.scene_path, m_scene))
+    {
+        spdlog::error("App::reload_scene: failed to load scene from file");
+        return false;
+    }
+
+    // Textures only the previous scene referenced are no longer used by any frame in flight.
+    m_asset_cache.trim();
+
+    return true;
 }
@@ -1,28 +1,44 @@
 #pragma once
 
 #include <span>
+#include <vector>
 
 #include <SDL3/SDL_video.h>
 #include <vulkan/vulkan_core.h>
 
+#include "asset_cache.hpp"
+#include "cull_pass.hpp"
 #include "deletion_queue.hpp"
+#include "draw_list.hpp"
 #include "engine.hpp"
 #include "forward_pass.hpp"
+#include "hiz_pass.hpp"
 #include "imgui_pass.hpp"
+#include "occlusion_buffer.hpp"
+#include "options.hpp"
 
 class App
 {
+    Options m_options;
+
     DeletionQueue m_deletion_queue;
 
     Engine m_engine;
 
+    CullPass m_cull_pass;
     ForwardPass m_forward_pass;
+    HiZPass m_hiz_pass;
     ImGuiPass m_imgui_pass;
 
     double m_last_frame_time{0.0};
     double m_delta_time{0.0};
 
     bool m_disable_render{false};
+    bool m_reload_scene{false};
+    bool m_bvh_culling{true};
+    bool m_overdraw_view{false};
+    // Largest projected error in pixels a level of detail may have to be selected.
+    float m_max_lod_error{1.0f};
 
     Scene m_scene{
         .background_color{0.1f, 0.1f, 0.1f},
@@ -40,7 +56,15 @@ class App
         .objects{},
     };
 
+    // Objects of `m_scene` that passed CPU frustum and occlusion culling this frame and their
+    // sorted draws.
+    std::vector<uint32_t> m_visible_objects;
+    OcclusionBuffer m_occlusion_buffer;
+    DrawList m_draw_list;
+    float m_lod_scale{1.0f};
+
     VkSampler m_sampler;
+    AssetCache m_asset_cache;
 
     App() = delete;
     App(const App &) = delete;
@@ -49,8 +73,17 @@ class App
     App &operator=(App &&) = delete;
 
   public:
-    explicit App(SDL_Window *window)
-        : m_engine(window), m_forward_pass(m_engine), m_imgui_pass(m_engine)
+    App(SDL_Window *window, const Options &options)
+        : m_options(options),
+          m_engine(
+              window,
+              VkExtent2D{.width = options.width, .height = options.height},
+              options.archive_path,
+              options.quantize_vertices ? VertexFormat::Quantized : VertexFormat::Full
+          ),
+          m_cull_pass(m_engine), m_forward_pass(m_engine), m_hiz_pass(m_engine),
+          m_imgui_pass(m_engine),
+          m_asset_cache(m_engine)
     {
     }
 
@@ -65,20 +98,29 @@ class App
 
     void run();
 
+    [[nodiscard]] bool run_benchmark();
+
   private:
     void build_ui();
 
+    void build_draw_list();
+
+    // Records culling and the forward pass into the frame's command buffer.
+    void render_scene(VkCommandBuffer cmd_buffer);
     [[nodiscard]] bool render_frame();
+    [[nodiscard]] bool render_headless_frame();
 
-    [[nodiscard]] bool
-    create_mesh(std::span<Vertex> vertices, std::span<uint32_t> indices, Mesh &out_mesh);
+    [[nodiscard]] bool create_mesh(
+        std::span<const Vertex> vertices, std::span<const uint32_t> indices, Mesh &out_mesh
+    );
     void destroy_mesh(Mesh &mesh);
 
-    [[nodiscard]] bool create_material_from_file(
-        const std::string &diffuse_path, VkDescriptorSetLayout set_layout, Material &out_material
-    );
+    [[nodiscard]] bool create_material_buffer(Scene &scene);
     void destroy_material(Material &material);
 
+    [[nodiscard]] bool create_object_buffers(Scene &scene);
+
     [[nodiscard]] bool create_scene_from_file(const std::string &path, Scene &out_scene);
     void destroy_scene(Scene &scene);
+    [[nodiscard]] bool reload_scene();
 };
@@ -0,0 +1,134 @@
+#include "asset_archive.hpp"
+
+#include <bit>
+#include <cstring>
+#include <filesystem>
+
+#include <spdlog/spdlog.h>
+
+#include "cpu_profiler.hpp"
+
+static_assert(sizeof(AssetArchive::Header) == 24);
+
+std::string AssetArchive::get_entry_key(const std::string &root, const std::string &path)
+{
+    std::error_code ec;
+    std::filesystem::path absolute_path = std::filesystem::absolute(path, ec).lexically_normal();
+    return absolute_path.lexically_relative(root).generic_string();
+}
+
+[[nodiscard]] bool AssetArchive::open(const std::string &path)
+{
+    CPU_ZONE("AssetArchive::open");
+
+    close();
+
+    if constexpr (std::endian::native != std::endian::little)
+    {
+        spdlog::error("AssetArchive::open: archives are only supported on little-endian hosts");
+        return false;
+    }
+
+    if (!m_file.open(path))
+    {
+        spdlog::error("AssetArchive::open: failed to map archive {}", path);
+        return false;
+    }
+    std::span<const std::byte> data = m_file.get_data();
+
+    Header header;
+    if (data.size() < sizeof(header))
+    {
+        close();
+        spdlog::error("AssetArchive::open: {} is not an asset archive", path);
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION ||
+        header.index_size > data.size() - sizeof(header))
+    {
+        close();
+        spdlog::error("AssetArchive::open: {} is not a supported asset archive", path);
+        return false;
+    }
+
+    // Each index entry is the offset and size of its contents followed by the key's length
+    // and characters.
+    size_t offset = sizeof(header);
+    size_t index_end = offset + header.index_size;
+    for (uint32_t i = 0; i < header.entry_count; ++i)
+    {
+        uint64_t entry_offset, entry_size;
+        uint32_t key_size;
+        if (index_end - offset < sizeof(entry_offset) + sizeof(entry_size) + sizeof(key_size))
+        {
+            close();
+            spdlog::error("AssetArchive::open: index of {} is truncated", path);
+            return false;
+        }
+        std::memcpy(&entry_offset, data.data() + offset, sizeof(entry_offset));
+        offset += sizeof(entry_offset);
+        std::memcpy(&entry_size, data.data() + offset, sizeof(entry_size));
+        offset += sizeof(entry_size);
+        std::memcpy(&key_size, data.data() + offset, sizeof(key_size));
+        offset += sizeof(key_size);
+
+        if (index_end - offset < key_size || entry_offset > data.size() ||
+            entry_size > data.size() - entry_offset)
+        {
+            close();
+            spdlog::error("AssetArchive::open: index of {} is invalid", path);
+            return false;
+        }
+        std::string key(reinterpret_cast<const char *>(data.data() + offset), key_size);
+        offset += key_size;
+
+        m_entries.emplace(std::move(key), data.subspan(entry_offset, entry_size));
+    }
+
+    std::error_code ec;
+    std::filesystem::path absolute_path = std::filesystem::absolute(path, ec);
+    m_root = absolute_path.parent_path().lexically_normal().string();
+
+    spdlog::info(
+        "AssetArchive::open: mounted {} with {} entries ({:.1f} MiB)",
+        path,
+        m_entries.size(),
+        static_cast<double>(data.size()) / (1024.0 * 1024.0)
+    );
+    return true;
+}
+
+void AssetArchive::close()
+{
+    m_entries.clear();
+    m_root.clear();
+    m_file.close();
+}
+
+bool AssetArchive::contains(const std::string &path) const
+{
+    return is_open() && m_entries.contains(get_entry_key(m_root, path));
+}
+
+[[nodiscard]] bool AssetArchive::load(const std::string &path, AssetData &out_asset) const
+{
+    if (is_open())
+    {
+        auto it = m_entries.find(get_entry_key(m_root, path));
+        if (it != m_entries.end())
+        {
+            out_asset.data = it->second;
+            out_asset.mapped_file.close();
+            return true;
+        }
+    }
+
+    if (!out_asset.mapped_file.open(path))
+    {
+        spdlog::error("AssetArchive::load: failed to load asset {}", path);
+        return false;
+    }
+    out_asset.data = out_asset.mapped_file.get_data();
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+
+#include "mapped_file.hpp"
+
+// Bytes of a loaded asset. Assets served from an archive alias the archive's mapping and stay
+// valid until it is closed, loose files are mapped individually and owned by `mapped_file`.
+struct AssetData
+{
+    std::span<const std::byte> data;
+    MappedFile mapped_file;
+};
+
+// Packed archive of asset files, memory mapped once and served as zero-copy views.
+//
+// An archive starts with a header and an index of every entry followed by the contents of all
+// entries, each aligned to `ENTRY_ALIGNMENT` bytes. Entries are keyed by their path relative
+// to the directory containing the archive, so `load()` accepts the same paths that would be
+// used to open the loose files. All values are little-endian.
+class AssetArchive
+{
+  public:
+    static constexpr std::array<char, 8> MAGIC = {'A', 'U', 'R', 'P', 'A', 'C', 'K', '\0'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint64_t ENTRY_ALIGNMENT = 16;
+
+    struct Header
+    {
+        std::array<char, 8> magic;
+        uint32_t version;
+        uint32_t entry_count;
+        uint64_t index_size;
+    };
+
+  private:
+    MappedFile m_file;
+    std::string m_root;
+    std::unordered_map<std::string, std::span<const std::byte>> m_entries;
+
+    AssetArchive(const AssetArchive &) = delete;
+    AssetArchive &operator=(const AssetArchive &) = delete;
+    AssetArchive(AssetArchive &&) = delete;
+    AssetArchive &operator=(AssetArchive &&) = delete;
+
+  public:
+    AssetArchive() = default;
+
+    [[nodiscard]] bool open(const std::string &path);
+    void close();
+
+    bool is_open() const
+    {
+        return m_file.is_open();
+    }
+
+    size_t get_entry_count() const
+    {
+        return m_entries.size();
+    }
+
+    // Returns the key an entry for the file at `path` has in an archive located in `root`.
+    static std::string get_entry_key(const std::string &root, const std::string &path);
+
+    bool contains(const std::string &path) const;
+
+    // Looks up `path` in the archive and falls back to mapping the loose file if the archive
+    // is not open or has no such entry. Safe to call from any thread.
+    [[nodiscard]] bool load(const std::string &path, AssetData &out_asset) const;
+};
@@ -0,0 +1,344 @@
+#include "asset_cache.hpp"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "cpu_profiler.hpp"
+#include "engine.hpp"
+#include "vkerr.hpp"
+
+static std::string normalize_path(const std::string &path)
+{
+    return std::filesystem::path(path).lexically_normal().string();
+}
+
+[[nodiscard]] bool AssetCache::init(VkSampler sampler)
+{
+    m_sampler = sampler;
+    m_capacity = std::min(MAX_TEXTURES, m_engine.get_max_bindless_textures());
+
+    VkDescriptorBindingFlags binding_flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                             VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                             VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info = {};
+    binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    binding_flags_info.bindingCount = 1;
+    binding_flags_info.pBindingFlags = &binding_flags;
+
+    VkDescriptorSetLayoutBinding textures_binding = {};
+    textures_binding.binding = 0;
+    textures_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    textures_binding.descriptorCount = m_capacity;
+    textures_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo set_layout_info = {};
+    set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    set_layout_info.pNext = &binding_flags_info;
+    set_layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    set_layout_info.bindingCount = 1;
+    set_layout_info.pBindings = &textures_binding;
+    VKERR(
+        vkCreateDescriptorSetLayout(
+            m_engine.get_device(),
+            &set_layout_info,
+            nullptr,
+            &m_set_layout
+        ),
+        "AssetCache::init: failed to create texture set layout"
+    );
+
+    VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_capacity};
+    VkDescriptorPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    pool_info.maxSets = 1;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    VKERR(
+        vkCreateDescriptorPool(m_engine.get_device(), &pool_info, nullptr, &m_descriptor_pool),
+        "AssetCache::init: failed to create texture descriptor pool"
+    );
+
+    VkDescriptorSetAllocateInfo set_info = {};
+    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_info.descriptorPool = m_descriptor_pool;
+    set_info.descriptorSetCount = 1;
+    set_info.pSetLayouts = &m_set_layout;
+    VKERR(
+        vkAllocateDescriptorSets(m_engine.get_device(), &set_info, &m_texture_set),
+        "AssetCache::init: failed to allocate texture set"
+    );
+    spdlog::debug("AssetCache::init: texture set holds up to {} textures", m_capacity);
+
+    DecodedImage white_image{
+        .extent = VkExtent3D{.width = 1, .height = 1, .depth = 1},
+        .data = std::vector<std::byte>(4, std::byte{255}),
+        .mip_offsets = {0},
+    };
+    if (!create_texture(0, white_image, m_white_texture))
+    {
+        spdlog::error("AssetCache::init: failed to create white texture");
+        return false;
+    }
+
+    return true;
+}
+
+void AssetCache::destroy()
+{
+    for (TextureHandle handle = 0; handle < m_textures.size(); ++handle)
+    {
+        if (m_textures[handle].image.image != VK_NULL_HANDLE)
+        {
+            destroy_texture(handle);
+        }
+    }
+    m_textures.clear();
+    m_free_handles.clear();
+    m_textures_by_hash.clear();
+    m_paths.clear();
+    m_white_texture = INVALID_TEXTURE;
+
+    vkDestroyDescriptorPool(m_engine.get_device(), m_descriptor_pool, nullptr);
+    vkDestroyDescriptorSetLayout(m_engine.get_device(), m_set_layout, nullptr);
+    m_descriptor_pool = VK_NULL_HANDLE;
+    m_set_layout = VK_NULL_HANDLE;
+    m_texture_set = VK_NULL_HANDLE;
+}
+
+VkDeviceSize AssetCache::get_resident_texture_bytes() const
+{
+    VkDeviceSize bytes = 0;
+    for (const CachedTexture &texture : m_textures)
+    {
+        if (texture.image.image != VK_NULL_HANDLE)
+        {
+            bytes += texture.image.allocation_info.size;
+        }
+    }
+    return bytes;
+}
+
+std::unordered_set<uint64_t> AssetCache::get_content_hashes() const
+{
+    std::unordered_set<uint64_t> hashes;
+    for (const auto &[hash, handle] : m_textures_by_hash)
+    {
+        hashes.insert(hash);
+    }
+    return hashes;
+}
+
+[[nodiscard]] bool AssetCache::find_texture(const std::string &path, TextureHandle &out_handle)
+{
+    auto path_it = m_paths.find(normalize_path(path));
+    if (path_it == m_paths.end())
+    {
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::file_time_type write_time = std::filesystem::last_write_time(path, ec);
+    if (ec || write_time != path_it->second.write_time)
+    {
+        return false;
+    }
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec || size != path_it->second.size)
+    {
+        return false;
+    }
+
+    auto texture_it = m_textures_by_hash.find(path_it->second.content_hash);
+    if (texture_it == m_textures_by_hash.end())
+    {
+        return false;
+    }
+
+    out_handle = texture_it->second;
+    acquire(out_handle);
+    return true;
+}
+
+[[nodiscard]] bool AssetCache::find_texture(
+    const std::string &path, uint64_t content_hash, TextureHandle &out_handle
+)
+{
+    auto texture_it = m_textures_by_hash.find(content_hash);
+    if (texture_it == m_textures_by_hash.end())
+    {
+        return false;
+    }
+
+    remember_path(path, content_hash);
+    out_handle = texture_it->second;
+    acquire(out_handle);
+    return true;
+}
+
+[[nodiscard]] bool AssetCache::add_texture(
+    const std::string &path, uint64_t content_hash, const DecodedImage &image,
+    TextureHandle &out_handle
+)
+{
+    if (find_texture(path, content_hash, out_handle))
+    {
+        return true;
+    }
+
+    if (!create_texture(content_hash, image, out_handle))
+    {
+        spdlog::error("AssetCache::add_texture: failed to create texture for {}", path);
+        return false;
+    }
+    m_textures_by_hash.emplace(content_hash, out_handle);
+    remember_path(path, content_hash);
+
+    return true;
+}
+
+TextureHandle AssetCache::acquire_white_texture()
+{
+    acquire(m_white_texture);
+    return m_white_texture;
+}
+
+void AssetCache::acquire(TextureHandle handle)
+{
+    m_textures[handle].ref_count += 1;
+}
+
+void AssetCache::release(TextureHandle handle)
+{
+    if (handle == INVALID_TEXTURE)
+    {
+        return;
+    }
+
+    CachedTexture &texture = m_textures[handle];
+    if (texture.ref_count == 0)
+    {
+        spdlog::error("AssetCache::release: texture #{} has no references", handle);
+        return;
+    }
+    texture.ref_count -= 1;
+}
+
+void AssetCache::trim()
+{
+    CPU_ZONE("AssetCache::trim");
+
+    size_t destroyed_count = 0;
+    for (TextureHandle handle = 0; handle < m_textures.size(); ++handle)
+    {
+        const CachedTexture &texture = m_textures[handle];
+        if (handle != m_white_texture && texture.image.image != VK_NULL_HANDLE &&
+            texture.ref_count == 0)
+        {
+            destroy_texture(handle);
+            destroyed_count += 1;
+        }
+    }
+
+    if (destroyed_count > 0)
+    {
+        spdlog::debug("AssetCache::trim: destroyed {} unused textures", destroyed_count);
+    }
+}
+
+[[nodiscard]] bool AssetCache::create_texture(
+    uint64_t content_hash, const DecodedImage &image, TextureHandle &out_handle
+)
+{
+    TextureHandle handle;
+    if (!m_free_handles.empty())
+    {
+        handle = m_free_handles.back();
+    }
+    else if (m_textures.size() < m_capacity)
+    {
+        handle = static_cast<TextureHandle>(m_textures.size());
+    }
+    else
+    {
+        spdlog::error("AssetCache::create_texture: texture set is full ({} textures)", m_capacity);
+        return false;
+    }
+
+    CachedTexture texture = {};
+    texture.content_hash = content_hash;
+
+    if (!m_engine.create_image_from_decoded(image, texture.image))
+    {
+        spdlog::error("AssetCache::create_texture: failed to create image");
+        return false;
+    }
+    texture.ready_value = m_engine.get_upload_manager().get_last_upload_value();
+
+    // The handle's slot is not used by any pending frame: it was either never written or its
+    // previous texture was trimmed while the device was idle.
+    VkDescriptorImageInfo image_info{
+        .sampler = m_sampler,
+        .imageView = texture.image.view,
+        .imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
+    };
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_texture_set;
+    write.dstBinding = 0;
+    write.dstArrayElement = handle;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &image_info;
+    vkUpdateDescriptorSets(m_engine.get_device(), 1, &write, 0, nullptr);
+
+    if (handle == m_textures.size())
+    {
+        m_textures.emplace_back(texture);
+    }
+    else
+    {
+        m_free_handles.pop_back();
+        m_textures[handle] = texture;
+    }
+
+    out_handle = handle;
+    return true;
+}
+
+void AssetCache::destroy_texture(TextureHandle handle)
+{
+    CachedTexture &texture = m_textures[handle];
+
+    m_engine.destroy_image(texture.image);
+    if (handle != m_white_texture)
+    {
+        m_textures_by_hash.erase(texture.content_hash);
+    }
+
+    texture = {};
+    m_free_handles.emplace_back(handle);
+}
+
+void AssetCache::remember_path(const std::string &path, uint64_t content_hash)
+{
+    std::error_code ec;
+    std::filesystem::file_time_type write_time = std::filesystem::last_write_time(path, ec);
+    if (ec)
+    {
+        return;
+    }
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec)
+    {
+        return;
+    }
+
+    m_paths[normalize_path(path)] = PathEntry{
+        .write_time = write_time,
+        .size = size,
+        .content_hash = content_hash,
+    };
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "gpu.hpp"
+
+class Engine;
+struct DecodedImage;
+
+using TextureHandle = uint32_t;
+constexpr TextureHandle INVALID_TEXTURE = std::numeric_limits<TextureHandle>::max();
+
+struct CachedTexture
+{
+    GPUImage image;
+    uint64_t content_hash;
+    uint64_t ready_value;
+    uint32_t ref_count;
+};
+
+// Owns all textures sampled by materials. Textures are identified by a hash of their encoded
+// file contents, so files referenced by several materials, reloaded scenes or other scenes
+// share a single GPU image. The last known hash of every path is remembered
+// together with the file's size and modification time, which lets unchanged files be resolved
+// without reading them again.
+//
+// Textures stay resident when their reference count drops to zero and are only destroyed by
+// `trim()`, so a scene can be destroyed and reloaded without uploading anything.
+//
+// Every texture is written into a single update-after-bind descriptor array at the index of its
+// handle, so shaders select textures by handle and the set is bound once per pass.
+class AssetCache
+{
+    struct PathEntry
+    {
+        std::filesystem::file_time_type write_time;
+        uintmax_t size;
+        uint64_t content_hash;
+    };
+
+    Engine &m_engine;
+
+    VkSampler m_sampler{VK_NULL_HANDLE};
+    VkDescriptorSetLayout m_set_layout{VK_NULL_HANDLE};
+    VkDescriptorPool m_descriptor_pool{VK_NULL_HANDLE};
+    VkDescriptorSet m_texture_set{VK_NULL_HANDLE};
+    uint32_t m_capacity{0};
+
+    std::vector<CachedTexture> m_textures;
+    std::vector<TextureHandle> m_free_handles;
+    std::unordered_map<uint64_t, TextureHandle> m_textures_by_hash;
+    std::unordered_map<std::string, PathEntry> m_paths;
+
+    TextureHandle m_white_texture{INVALID_TEXTURE};
+
+    AssetCache() = delete;
+    AssetCache(const AssetCache &) = delete;
+    AssetCache &operator=(const AssetCache &) = delete;
+    AssetCache(AssetCache &&) = delete;
+    AssetCache &operator=(AssetCache &&) = delete;
+
+  public:
+    explicit AssetCache(Engine &engine) : m_engine(engine)
+    {
+    }
+
+    static constexpr uint32_t MAX_TEXTURES = 4096;
+
+    [[nodiscard]] bool init(VkSampler sampler);
+    void destroy();
+
+    // Layout of the texture set: binding 0 is an array of combined image samplers indexed by
+    // `TextureHandle`, only entries of resident textures are valid.
+    VkDescriptorSetLayout get_texture_set_layout() const
+    {
+        return m_set_layout;
+    }
+
+    VkDescriptorSet get_texture_set() const
+    {
+        return m_texture_set;
+    }
+
+    const CachedTexture &get_texture(TextureHandle handle) const
+    {
+        return m_textures[handle];
+    }
+
+    size_t get_resident_texture_count() const
+    {
+        return m_textures_by_hash.size();
+    }
+
+    VkDeviceSize get_resident_texture_bytes() const;
+
+    std::unordered_set<uint64_t> get_content_hashes() const;
+
+    // Returns a new reference to the texture last loaded from `path` if the file has not been
+    // modified since.
+    [[nodiscard]] bool find_texture(const std::string &path, TextureHandle &out_handle);
+
+    // Returns a new reference to the resident texture with the given content and remembers that
+    // `path` contains it.
+    [[nodiscard]] bool
+    find_texture(const std::string &path, uint64_t content_hash, TextureHandle &out_handle);
+
+    // Uploads a texture that is not resident yet and returns the first reference to it.
+    [[nodiscard]] bool add_texture(
+        const std::string &path, uint64_t content_hash, const DecodedImage &image,
+        TextureHandle &out_handle
+    );
+
+    TextureHandle acquire_white_texture();
+    void acquire(TextureHandle handle);
+    void release(TextureHandle handle);
+
+    // Destroys all textures without references. None of them may still be in use by the GPU.
+    void trim();
+
+  private:
+    [[nodiscard]] bool
+    create_texture(uint64_t content_hash, const DecodedImage &image, TextureHandle &out_handle);
+    void destroy_texture(TextureHandle handle);
+
+    void remember_path(const std::string &path, uint64_t content_hash);
+};
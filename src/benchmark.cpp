@@ -0,0 +1,141 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "json.hpp"
+
+// `suffix` is appended to every key, e.g. the unit of `values`.
+static void write_summary(std::ofstream &out, std::vector<double> values, const std::string &suffix)
+{
+    if (values.empty())
+    {
+        out << "null";
+        return;
+    }
+
+    std::sort(values.begin(), values.end());
+
+    double sum = 0.0;
+    for (double v : values)
+    {
+        sum += v;
+    }
+
+    auto percentile = [&](double p) {
+        size_t idx = static_cast<size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+        return values[idx];
+    };
+
+    out << "{\"mean" << suffix << "\": " << sum / static_cast<double>(values.size())
+        << ", \"min" << suffix << "\": " << values.front() << ", \"max" << suffix
+        << "\": " << values.back() << ", \"p50" << suffix << "\": " << percentile(0.50)
+        << ", \"p95" << suffix << "\": " << percentile(0.95) << ", \"p99" << suffix
+        << "\": " << percentile(0.99) << "}";
+}
+
+// Negative values mark measurements that are unavailable.
+static void write_optional(std::ofstream &out, double value)
+{
+    if (value >= 0.0)
+    {
+        out << value;
+    }
+    else
+    {
+        out << "null";
+    }
+}
+
+[[nodiscard]] bool write_benchmark_report(
+    const std::string &path, const Options &options, const std::string &device_name,
+    std::span<const FrameTiming> frames
+)
+{
+    std::ofstream out(path);
+    if (!out.is_open())
+    {
+        spdlog::error("write_benchmark_report: failed to open file {}", path);
+        return false;
+    }
+
+    std::vector<double> cpu_times;
+    std::vector<double> gpu_times;
+    std::vector<double> overdraws;
+    std::vector<double> occlusion_times;
+    std::vector<double> occlusion_rejections;
+    for (const FrameTiming &frame : frames)
+    {
+        cpu_times.emplace_back(frame.cpu_time_ms);
+        if (frame.gpu_time_ms >= 0.0)
+        {
+            gpu_times.emplace_back(frame.gpu_time_ms);
+        }
+        if (frame.overdraw >= 0.0)
+        {
+            overdraws.emplace_back(frame.overdraw);
+        }
+        if (frame.occlusion_time_ms >= 0.0)
+        {
+            occlusion_times.emplace_back(frame.occlusion_time_ms);
+            occlusion_rejections.emplace_back(frame.occlusion_rejection);
+        }
+    }
+
+    out << "{\n";
+    out << "  \"scene\": \"" << json_escape(options.scene_path) << "\",\n";
+    out << "  \"device\": \"" << json_escape(device_name) << "\",\n";
+    out << "  \"width\": " << options.width << ",\n";
+    out << "  \"height\": " << options.height << ",\n";
+    out << "  \"gpu_culling\": " << (options.gpu_culling ? "true" : "false") << ",\n";
+    out << "  \"occlusion_culling\": "
+        << (options.occlusion_culling ? "true" : "false") << ",\n";
+    out << "  \"software_occlusion\": "
+        << (options.software_occlusion ? "true" : "false") << ",\n";
+    out << "  \"depth_prepass\": " << (options.depth_prepass ? "true" : "false") << ",\n";
+    out << "  \"parallel_recording\": "
+        << (options.parallel_recording ? "true" : "false") << ",\n";
+    out << "  \"warmup_frames\": " << options.warmup_frame_count << ",\n";
+    out << "  \"frame_count\": " << frames.size() << ",\n";
+    out << "  \"cpu\": ";
+    write_summary(out, cpu_times, "_ms");
+    out << ",\n";
+    out << "  \"gpu\": ";
+    write_summary(out, gpu_times, "_ms");
+    out << ",\n";
+    out << "  \"overdraw\": ";
+    write_summary(out, overdraws, "");
+    out << ",\n";
+    out << "  \"occlusion\": ";
+    write_summary(out, occlusion_times, "_ms");
+    out << ",\n";
+    out << "  \"occlusion_rejection\": ";
+    write_summary(out, occlusion_rejections, "");
+    out << ",\n";
+    out << "  \"frames\": [\n";
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        out << "    {\"cpu_ms\": " << frames[i].cpu_time_ms << ", \"gpu_ms\": ";
+        write_optional(out, frames[i].gpu_time_ms);
+        out << ", \"overdraw\": ";
+        write_optional(out, frames[i].overdraw);
+        out << ", \"occlusion_ms\": ";
+        write_optional(out, frames[i].occlusion_time_ms);
+        out << ", \"occlusion_rejection\": ";
+        write_optional(out, frames[i].occlusion_rejection);
+        out << "}" << (i + 1 < frames.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+
+    if (!out.good())
+    {
+        spdlog::error("write_benchmark_report: failed to write file {}", path);
+        return false;
+    }
+
+    return true;
+}
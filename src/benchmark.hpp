@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "options.hpp"
+
+struct FrameTiming
+{
+    double cpu_time_ms{0.0};
+    double gpu_time_ms{-1.0};
+    // Fragment shader invocations of the forward pass per pixel.
+    double overdraw{-1.0};
+    // Cost of software occlusion culling and the fraction of tested objects it rejected.
+    double occlusion_time_ms{-1.0};
+    double occlusion_rejection{-1.0};
+};
+
+[[nodiscard]] bool write_benchmark_report(
+    const std::string &path, const Options &options, const std::string &device_name,
+    std::span<const FrameTiming> frames
+);
@@ -0,0 +1,435 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+namespace
+{
+
+enum class Containment
+{
+    Outside,
+    Intersecting,
+    Inside,
+};
+
+// Frustum planes in structure-of-arrays form, padded to 8 with planes that contain everything.
+struct FrustumPlanes
+{
+    alignas(16) std::array<float, 8> nx;
+    alignas(16) std::array<float, 8> ny;
+    alignas(16) std::array<float, 8> nz;
+    alignas(16) std::array<float, 8> abs_nx;
+    alignas(16) std::array<float, 8> abs_ny;
+    alignas(16) std::array<float, 8> abs_nz;
+    alignas(16) std::array<float, 8> d;
+};
+
+FrustumPlanes get_frustum_planes(const Frustum &frustum)
+{
+    FrustumPlanes planes{};
+    planes.d.fill(1.0f);
+    for (size_t i = 0; i < frustum.planes.size(); ++i)
+    {
+        const glm::vec4 &plane = frustum.planes[i];
+        planes.nx[i] = plane.x;
+        planes.ny[i] = plane.y;
+        planes.nz[i] = plane.z;
+        planes.abs_nx[i] = std::abs(plane.x);
+        planes.abs_ny[i] = std::abs(plane.y);
+        planes.abs_nz[i] = std::abs(plane.z);
+        planes.d[i] = plane.w;
+    }
+    return planes;
+}
+
+// A box is outside of a plane if even its furthest point along the normal, at a distance of
+// `dot(|n|, extent)` from the center, is behind it, and inside if its closest point is in front.
+Containment classify(const FrustumPlanes &planes, const glm::vec3 &center, const glm::vec3 &extent)
+{
+#if defined(__SSE__) || defined(_M_X64)
+    __m128 cx = _mm_set1_ps(center.x);
+    __m128 cy = _mm_set1_ps(center.y);
+    __m128 cz = _mm_set1_ps(center.z);
+    __m128 ex = _mm_set1_ps(extent.x);
+    __m128 ey = _mm_set1_ps(extent.y);
+    __m128 ez = _mm_set1_ps(extent.z);
+    __m128 zero = _mm_setzero_ps();
+
+    int outside = 0;
+    int intersecting = 0;
+    for (size_t i = 0; i < 8; i += 4)
+    {
+        __m128 dist = _mm_add_ps(
+            _mm_add_ps(
+                _mm_mul_ps(_mm_load_ps(&planes.nx[i]), cx),
+                _mm_mul_ps(_mm_load_ps(&planes.ny[i]), cy)
+            ),
+            _mm_add_ps(_mm_mul_ps(_mm_load_ps(&planes.nz[i]), cz), _mm_load_ps(&planes.d[i]))
+        );
+        __m128 radius = _mm_add_ps(
+            _mm_add_ps(
+                _mm_mul_ps(_mm_load_ps(&planes.abs_nx[i]), ex),
+                _mm_mul_ps(_mm_load_ps(&planes.abs_ny[i]), ey)
+            ),
+            _mm_mul_ps(_mm_load_ps(&planes.abs_nz[i]), ez)
+        );
+        outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(dist, radius), zero));
+        intersecting |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(dist, radius), zero));
+    }
+#else
+    bool outside = false;
+    bool intersecting = false;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        float dist = planes.nx[i] * center.x + planes.ny[i] * center.y +
+                     planes.nz[i] * center.z + planes.d[i];
+        float radius =
+            planes.abs_nx[i] * extent.x + planes.abs_ny[i] * extent.y + planes.abs_nz[i] * extent.z;
+        outside |= dist + radius < 0.0f;
+        intersecting |= dist - radius < 0.0f;
+    }
+#endif
+
+    if (outside)
+    {
+        return Containment::Outside;
+    }
+    return intersecting ? Containment::Intersecting : Containment::Inside;
+}
+
+bool intersects_sphere(
+    const BoundingSphere &sphere, const glm::vec3 &center, const glm::vec3 &extent
+)
+{
+    glm::vec3 offset = glm::max(glm::abs(sphere.center - center) - extent, glm::vec3(0.0f));
+    return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+}
+
+bool intersects_ray(
+    const glm::vec3 &origin, const glm::vec3 &inv_direction, float max_distance,
+    const glm::vec3 &center, const glm::vec3 &extent
+)
+{
+    glm::vec3 t0 = (center - extent - origin) * inv_direction;
+    glm::vec3 t1 = (center + extent - origin) * inv_direction;
+    glm::vec3 t_min = glm::min(t0, t1);
+    glm::vec3 t_max = glm::max(t0, t1);
+    float t_near = std::max(std::max(t_min.x, t_min.y), std::max(t_min.z, 0.0f));
+    float t_far = std::min(std::min(t_max.x, t_max.y), std::min(t_max.z, max_distance));
+    return t_near <= t_far;
+}
+
+// Deep enough for any tree built by `BVH::build`, which halves the object count on every level.
+using NodeStack = std::array<uint32_t, 64>;
+
+} // namespace
+
+void BVH::build(std::span<const BoundingBox> boxes)
+{
+    clear();
+    if (boxes.empty())
+    {
+        return;
+    }
+
+    m_centers.reserve(boxes.size());
+    m_extents.reserve(boxes.size());
+    for (const BoundingBox &box : boxes)
+    {
+        m_centers.emplace_back((box.min + box.max) * 0.5f);
+        m_extents.emplace_back((box.max - box.min) * 0.5f);
+    }
+
+    m_objects.resize(boxes.size());
+    std::iota(m_objects.begin(), m_objects.end(), 0);
+
+    m_nodes.reserve(2 * boxes.size());
+    m_nodes.emplace_back(Node{
+        .center = {},
+        .first = 0,
+        .extent = {},
+        .count = static_cast<uint32_t>(boxes.size()),
+    });
+    update_node_bounds(m_nodes[0]);
+    subdivide(0);
+}
+
+void BVH::clear()
+{
+    m_nodes.clear();
+    m_objects.clear();
+    m_centers.clear();
+    m_extents.clear();
+    m_dirty = false;
+}
+
+void BVH::update(uint32_t object, const BoundingBox &box)
+{
+    m_centers[object] = (box.min + box.max) * 0.5f;
+    m_extents[object] = (box.max - box.min) * 0.5f;
+    m_dirty = true;
+}
+
+void BVH::refit()
+{
+    if (!m_dirty)
+    {
+        return;
+    }
+
+    for (size_t i = m_nodes.size(); i-- > 0;)
+    {
+        update_node_bounds(m_nodes[i]);
+    }
+    m_dirty = false;
+}
+
+void BVH::query_frustum(const Frustum &frustum, std::vector<uint32_t> &out_objects) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    FrustumPlanes planes = get_frustum_planes(frustum);
+
+    NodeStack stack;
+    size_t stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0)
+    {
+        uint32_t node_idx = stack[--stack_size];
+        const Node &node = m_nodes[node_idx];
+
+        Containment containment = classify(planes, node.center, node.extent);
+        if (containment == Containment::Outside)
+        {
+            continue;
+        }
+        if (containment == Containment::Inside)
+        {
+            append_subtree(node_idx, out_objects);
+            continue;
+        }
+
+        if (node.count == 0)
+        {
+            stack[stack_size++] = node.first + 1;
+            stack[stack_size++] = node.first;
+            continue;
+        }
+
+        for (uint32_t i = node.first; i < node.first + node.count; ++i)
+        {
+            uint32_t object = m_objects[i];
+            if (classify(planes, m_centers[object], m_extents[object]) != Containment::Outside)
+            {
+                out_objects.emplace_back(object);
+            }
+        }
+    }
+}
+
+void BVH::query_sphere(const BoundingSphere &sphere, std::vector<uint32_t> &out_objects) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    NodeStack stack;
+    size_t stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0)
+    {
+        const Node &node = m_nodes[stack[--stack_size]];
+        if (!intersects_sphere(sphere, node.center, node.extent))
+        {
+            continue;
+        }
+
+        if (node.count == 0)
+        {
+            stack[stack_size++] = node.first + 1;
+            stack[stack_size++] = node.first;
+            continue;
+        }
+
+        for (uint32_t i = node.first; i < node.first + node.count; ++i)
+        {
+            uint32_t object = m_objects[i];
+            if (intersects_sphere(sphere, m_centers[object], m_extents[object]))
+            {
+                out_objects.emplace_back(object);
+            }
+        }
+    }
+}
+
+void BVH::query_ray(
+    const glm::vec3 &origin, const glm::vec3 &direction, float max_distance,
+    std::vector<uint32_t> &out_objects
+) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    glm::vec3 inv_direction = 1.0f / direction;
+
+    NodeStack stack;
+    size_t stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0)
+    {
+        const Node &node = m_nodes[stack[--stack_size]];
+        if (!intersects_ray(origin, inv_direction, max_distance, node.center, node.extent))
+        {
+            continue;
+        }
+
+        if (node.count == 0)
+        {
+            stack[stack_size++] = node.first + 1;
+            stack[stack_size++] = node.first;
+            continue;
+        }
+
+        for (uint32_t i = node.first; i < node.first + node.count; ++i)
+        {
+            uint32_t object = m_objects[i];
+            if (intersects_ray(
+                    origin,
+                    inv_direction,
+                    max_distance,
+                    m_centers[object],
+                    m_extents[object]
+                ))
+            {
+                out_objects.emplace_back(object);
+            }
+        }
+    }
+}
+
+void BVH::subdivide(uint32_t node_idx)
+{
+    Node node = m_nodes[node_idx];
+    if (node.count <= MAX_LEAF_SIZE)
+    {
+        return;
+    }
+
+    // Split at the median object center along the axis in which the centers are spread most.
+    glm::vec3 centers_min(std::numeric_limits<float>::max());
+    glm::vec3 centers_max(std::numeric_limits<float>::lowest());
+    for (uint32_t i = node.first; i < node.first + node.count; ++i)
+    {
+        centers_min = glm::min(centers_min, m_centers[m_objects[i]]);
+        centers_max = glm::max(centers_max, m_centers[m_objects[i]]);
+    }
+
+    glm::vec3 spread = centers_max - centers_min;
+    int axis = 0;
+    if (spread.y > spread[axis])
+    {
+        axis = 1;
+    }
+    if (spread.z > spread[axis])
+    {
+        axis = 2;
+    }
+    if (spread[axis] <= 0.0f)
+    {
+        return;
+    }
+
+    auto begin = m_objects.begin() + node.first;
+    auto middle = begin + node.count / 2;
+    auto end = begin + node.count;
+    std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) {
+        return m_centers[a][axis] < m_centers[b][axis];
+    });
+
+    uint32_t left_idx = static_cast<uint32_t>(m_nodes.size());
+    uint32_t left_count = node.count / 2;
+    m_nodes.emplace_back(Node{
+        .center = {},
+        .first = node.first,
+        .extent = {},
+        .count = left_count,
+    });
+    m_nodes.emplace_back(Node{
+        .center = {},
+        .first = node.first + left_count,
+        .extent = {},
+        .count = node.count - left_count,
+    });
+    update_node_bounds(m_nodes[left_idx]);
+    update_node_bounds(m_nodes[left_idx + 1]);
+
+    m_nodes[node_idx].first = left_idx;
+    m_nodes[node_idx].count = 0;
+
+    subdivide(left_idx);
+    subdivide(left_idx + 1);
+}
+
+void BVH::update_node_bounds(Node &node) const
+{
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    if (node.count == 0)
+    {
+        for (uint32_t child = node.first; child < node.first + 2; ++child)
+        {
+            min = glm::min(min, m_nodes[child].center - m_nodes[child].extent);
+            max = glm::max(max, m_nodes[child].center + m_nodes[child].extent);
+        }
+    }
+    else
+    {
+        for (uint32_t i = node.first; i < node.first + node.count; ++i)
+        {
+            uint32_t object = m_objects[i];
+            min = glm::min(min, m_centers[object] - m_extents[object]);
+            max = glm::max(max, m_centers[object] + m_extents[object]);
+        }
+    }
+
+    node.center = (min + max) * 0.5f;
+    node.extent = (max - min) * 0.5f;
+}
+
+void BVH::append_subtree(uint32_t node_idx, std::vector<uint32_t> &out_objects) const
+{
+    // The objects below a node form a contiguous range, bounded by its leftmost and rightmost
+    // leaves.
+    const Node *first_leaf = &m_nodes[node_idx];
+    while (first_leaf->count == 0)
+    {
+        first_leaf = &m_nodes[first_leaf->first];
+    }
+    const Node *last_leaf = &m_nodes[node_idx];
+    while (last_leaf->count == 0)
+    {
+        last_leaf = &m_nodes[last_leaf->first + 1];
+    }
+
+    out_objects.insert(
+        out_objects.end(),
+        m_objects.begin() + first_leaf->first,
+        m_objects.begin() + last_leaf->first + last_leaf->count
+    );
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "culling.hpp"
+
+// Bounding volume hierarchy over the bounding boxes of a scene's objects.
+//
+// Nodes are stored depth-first in a single array and the two children of an interior node are
+// always adjacent, so every child comes after its parent and a refit is one backwards pass over
+// the array. Boxes are kept in center/extent form, which lets a node be tested against several
+// frustum planes at once without selecting box corners per plane.
+class BVH
+{
+  public:
+    static constexpr uint32_t MAX_LEAF_SIZE = 4;
+
+    struct Node
+    {
+        glm::vec3 center;
+        // First child for interior nodes, first entry of the object list for leaves.
+        uint32_t first;
+        glm::vec3 extent;
+        // Number of objects for leaves, 0 for interior nodes.
+        uint32_t count;
+    };
+    static_assert(sizeof(Node) == 32);
+
+  private:
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_objects;
+
+    // Box of every object in center/extent form, indexed by object.
+    std::vector<glm::vec3> m_centers;
+    std::vector<glm::vec3> m_extents;
+
+    bool m_dirty{false};
+
+  public:
+    void build(std::span<const BoundingBox> boxes);
+    void clear();
+
+    // Replaces the box of `object`. Takes effect in queries after the next `refit()`.
+    void update(uint32_t object, const BoundingBox &box);
+
+    // Recomputes the bounds of all nodes from their objects without changing the tree's
+    // structure. Does nothing if no object has been updated since the last refit.
+    void refit();
+
+    // All of the following append the index of every object whose box passes the query to
+    // `out_objects`, in no particular order.
+    void query_frustum(const Frustum &frustum, std::vector<uint32_t> &out_objects) const;
+    void query_sphere(const BoundingSphere &sphere, std::vector<uint32_t> &out_objects) const;
+    void query_ray(
+        const glm::vec3 &origin, const glm::vec3 &direction, float max_distance,
+        std::vector<uint32_t> &out_objects
+    ) const;
+
+    size_t get_node_count() const
+    {
+        return m_nodes.size();
+    }
+
+    size_t get_object_count() const
+    {
+        return m_centers.size();
+    }
+
+  private:
+    void subdivide(uint32_t node_idx);
+    void update_node_bounds(Node &node) const;
+    void append_subtree(uint32_t node_idx, std::vector<uint32_t> &out_objects) const;
+};
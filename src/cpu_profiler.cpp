@@ -0,0 +1,153 @@
+#include "cpu_profiler.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "json.hpp"
+
+namespace
+{
+
+struct ZoneEvent
+{
+    const char *name;
+    int64_t start_ns;
+    int64_t duration_ns;
+};
+
+struct ThreadBuffer
+{
+    std::mutex mutex;
+    uint32_t id;
+    std::string name;
+    std::vector<ZoneEvent> events;
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> threads;
+    CPUProfiler::Clock::time_point epoch{CPUProfiler::Clock::now()};
+};
+
+Registry &get_registry()
+{
+    static Registry registry;
+    return registry;
+}
+
+ThreadBuffer &get_thread_buffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+        Registry &registry = get_registry();
+        std::lock_guard lock(registry.mutex);
+
+        auto buffer = std::make_shared<ThreadBuffer>();
+        buffer->id = static_cast<uint32_t>(registry.threads.size());
+        buffer->name = buffer->id == 0 ? "main" : "thread " + std::to_string(buffer->id);
+        registry.threads.emplace_back(buffer);
+        return buffer;
+    }();
+    return *buffer;
+}
+
+} // namespace
+
+void CPUProfiler::set_thread_name(const std::string &name)
+{
+    ThreadBuffer &buffer = get_thread_buffer();
+    std::lock_guard lock(buffer.mutex);
+    buffer.name = name;
+}
+
+void CPUProfiler::record(const char *name, Clock::time_point start, Clock::time_point end)
+{
+    Clock::time_point epoch = get_registry().epoch;
+    ThreadBuffer &buffer = get_thread_buffer();
+
+    std::lock_guard lock(buffer.mutex);
+    if (buffer.events.size() >= MAX_EVENTS_PER_THREAD)
+    {
+        buffer.events.erase(
+            buffer.events.begin(),
+            buffer.events.begin() + MAX_EVENTS_PER_THREAD / 2
+        );
+    }
+    buffer.events.emplace_back(ZoneEvent{
+        .name = name,
+        .start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch).count(),
+        .duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+    });
+}
+
+[[nodiscard]] bool CPUProfiler::write_chrome_trace(const std::string &path)
+{
+    std::ofstream out(path);
+    if (!out.is_open())
+    {
+        spdlog::error("CPUProfiler::write_chrome_trace: failed to open file {}", path);
+        return false;
+    }
+
+    std::vector<std::shared_ptr<ThreadBuffer>> threads;
+    {
+        Registry &registry = get_registry();
+        std::lock_guard lock(registry.mutex);
+        threads = registry.threads;
+    }
+
+    size_t event_count = 0;
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (const auto &thread : threads)
+    {
+        std::lock_guard lock(thread->mutex);
+
+        out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            << "\"tid\": " << thread->id << ", \"args\": {\"name\": \""
+            << json_escape(thread->name) << "\"}}";
+        first = false;
+
+        for (const ZoneEvent &event : thread->events)
+        {
+            out << ",\n{\"name\": \"" << json_escape(event.name)
+                << "\", \"cat\": \"cpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread->id
+                << ", \"ts\": " << static_cast<double>(event.start_ns) / 1000.0
+                << ", \"dur\": " << static_cast<double>(event.duration_ns) / 1000.0 << "}";
+        }
+        event_count += thread->events.size();
+    }
+    out << "\n]}\n";
+
+    if (!out.good())
+    {
+        spdlog::error("CPUProfiler::write_chrome_trace: failed to write file {}", path);
+        return false;
+    }
+
+    spdlog::info(
+        "CPUProfiler::write_chrome_trace: wrote {} zones from {} threads to {}",
+        event_count,
+        threads.size(),
+        path
+    );
+    return true;
+}
+
+void CPUProfiler::clear()
+{
+    Registry &registry = get_registry();
+    std::lock_guard lock(registry.mutex);
+    for (const auto &thread : registry.threads)
+    {
+        std::lock_guard thread_lock(thread->mutex);
+        thread->events.clear();
+    }
+}
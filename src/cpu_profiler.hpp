@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#define CPU_ZONE_CONCAT_INNER(a, b) a##b
+#define CPU_ZONE_CONCAT(a, b) CPU_ZONE_CONCAT_INNER(a, b)
+
+// Times the enclosing scope. `name` must be a string literal or otherwise outlive the profiler.
+#define CPU_ZONE(name) CPUZone CPU_ZONE_CONCAT(cpu_zone_, __LINE__)(name)
+
+// Records scoped CPU zones per thread into bounded buffers which can be written out as a
+// Chrome trace (chrome://tracing, https://ui.perfetto.dev) at any time.
+class CPUProfiler
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+    static void set_thread_name(const std::string &name);
+
+    static void record(const char *name, Clock::time_point start, Clock::time_point end);
+
+    [[nodiscard]] static bool write_chrome_trace(const std::string &path);
+
+    static void clear();
+};
+
+class CPUZone
+{
+    const char *m_name;
+    CPUProfiler::Clock::time_point m_start;
+
+    CPUZone(const CPUZone &) = delete;
+    CPUZone &operator=(const CPUZone &) = delete;
+    CPUZone(CPUZone &&) = delete;
+    CPUZone &operator=(CPUZone &&) = delete;
+
+  public:
+    explicit CPUZone(const char *name) : m_name(name), m_start(CPUProfiler::Clock::now())
+    {
+    }
+
+    ~CPUZone()
+    {
+        CPUProfiler::record(m_name, m_start, CPUProfiler::Clock::now());
+    }
+};
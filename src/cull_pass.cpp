@@ -0,0 +1,291 @@
+#include "cull_pass.hpp"
+
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+#include "culling.hpp"
+#include "engine.hpp"
+#include "hiz_pass.hpp"
+#include "vkerr.hpp"
+
+[[nodiscard]] bool CullPass::init(const HiZPass &hiz_pass)
+{
+    m_hiz_pass = &hiz_pass;
+
+    VkDescriptorSetLayout set_layout = hiz_pass.get_pyramid_set_layout();
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(CullPushConstants),
+    };
+    VkPipelineLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.setLayoutCount = 1;
+    layout_info.pSetLayouts = &set_layout;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push_constant_range;
+    VKERR(
+        vkCreatePipelineLayout(m_engine.get_device(), &layout_info, nullptr, &m_pipeline_layout),
+        "CullPass::init: failed to create pipeline layout"
+    );
+    m_deletion_queue.add([this] {
+        vkDestroyPipelineLayout(m_engine.get_device(), m_pipeline_layout, nullptr);
+    });
+
+    AssetData compute_code;
+    if (!m_engine.get_asset_archive().load("../shaders/cull.comp.bin", compute_code))
+    {
+        spdlog::error("CullPass::init: failed to load shader");
+        return false;
+    }
+
+    VkShaderModule compute_shader;
+    VkShaderModuleCreateInfo compute_info = {};
+    compute_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    compute_info.codeSize = compute_code.data.size();
+    compute_info.pCode = reinterpret_cast<const uint32_t *>(compute_code.data.data());
+    VKERR(
+        vkCreateShaderModule(m_engine.get_device(), &compute_info, nullptr, &compute_shader),
+        "CullPass::init: failed to create compute shader module"
+    );
+
+    // One pipeline for each `CullPhase`, selected by the shader's `PHASE` constant.
+    VkSpecializationMapEntry phase_entry{
+        .constantID = 0,
+        .offset = 0,
+        .size = sizeof(uint32_t),
+    };
+    std::array<uint32_t, 3> phases = {
+        static_cast<uint32_t>(CullPhase::All),
+        static_cast<uint32_t>(CullPhase::First),
+        static_cast<uint32_t>(CullPhase::Second),
+    };
+    std::array<VkSpecializationInfo, 3> specialization_infos;
+    std::array<VkComputePipelineCreateInfo, 3> pipeline_infos;
+    for (size_t i = 0; i < phases.size(); ++i)
+    {
+        specialization_infos[i] = {};
+        specialization_infos[i].mapEntryCount = 1;
+        specialization_infos[i].pMapEntries = &phase_entry;
+        specialization_infos[i].dataSize = sizeof(uint32_t);
+        specialization_infos[i].pData = &phases[i];
+
+        VkComputePipelineCreateInfo &pipeline_info = pipeline_infos[i];
+        pipeline_info = {};
+        pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeline_info.stage.module = compute_shader;
+        pipeline_info.stage.pName = "main";
+        pipeline_info.stage.pSpecializationInfo = &specialization_infos[i];
+        pipeline_info.layout = m_pipeline_layout;
+    }
+    VkResult res = vkCreateComputePipelines(
+        m_engine.get_device(),
+        VK_NULL_HANDLE,
+        static_cast<uint32_t>(pipeline_infos.size()),
+        pipeline_infos.data(),
+        nullptr,
+        m_pipelines.data()
+    );
+    vkDestroyShaderModule(m_engine.get_device(), compute_shader, nullptr);
+    VKERR(res, "CullPass::init: failed to create pipelines");
+    m_deletion_queue.add([this] {
+        for (VkPipeline pipeline : m_pipelines)
+        {
+            vkDestroyPipeline(m_engine.get_device(), pipeline, nullptr);
+        }
+    });
+    spdlog::trace("CullPass::init: created pipelines");
+
+    if (!m_engine.create_buffer(
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            sizeof(CullData),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            m_data_buffer
+        ))
+    {
+        spdlog::error("CullPass::init: failed to allocate cull data buffer");
+        return false;
+    }
+    m_deletion_queue.add([this] { m_engine.destroy_buffer(m_data_buffer); });
+    m_data_buffer_address = m_engine.get_buffer_address(m_data_buffer);
+
+    for (GPUBuffer &readback_buffer : m_readback_buffers)
+    {
+        if (!m_engine.create_buffer(
+                VMA_MEMORY_USAGE_GPU_TO_CPU,
+                sizeof(CullStatistics),
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                readback_buffer
+            ))
+        {
+            spdlog::error("CullPass::init: failed to allocate statistics readback buffer");
+            return false;
+        }
+        m_deletion_queue.add([this, &readback_buffer] {
+            m_engine.destroy_buffer(readback_buffer);
+        });
+    }
+
+    return true;
+}
+
+void CullPass::render(
+    VkCommandBuffer cmd_buffer, const Scene &scene, float lod_scale, CullPhase phase
+)
+{
+    uint64_t available_value = m_engine.get_upload_manager().get_available_value();
+    if (scene.gpu_meshlet_count == 0 || scene.ready_value > available_value)
+    {
+        return;
+    }
+
+    size_t frame_index = m_engine.get_frame_index();
+    bool first_phase = phase != CullPhase::Second;
+    bool last_phase = phase != CullPhase::First;
+
+    // The previous frame's draws may still be reading the draw buffers, and the first phase of
+    // this frame has written statistics the second one adds to.
+    memory_barrier(
+        cmd_buffer,
+        VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
+            VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+    );
+
+    if (first_phase)
+    {
+        // The frame that last used this slot has completed, so its statistics are ready.
+        GPUBuffer &readback_buffer = m_readback_buffers[frame_index];
+        if (m_readback_pending[frame_index])
+        {
+            if (m_engine.invalidate_buffer(readback_buffer))
+            {
+                std::memcpy(
+                    &m_statistics,
+                    readback_buffer.allocation_info.pMappedData,
+                    sizeof(CullStatistics)
+                );
+            }
+            m_readback_pending[frame_index] = false;
+        }
+
+        glm::mat4 projection = scene.camera.get_projection_matrix();
+        VkExtent2D depth_extent = m_hiz_pass->get_depth_extent();
+        CullData data{
+            .view = scene.camera.get_view_matrix(),
+            .projection =
+                glm::vec4(projection[0][0], projection[1][1], projection[2][2], projection[3][2]),
+            .z_near = scene.camera.z_near,
+            .depth_width = depth_extent.width,
+            .depth_height = depth_extent.height,
+            .pyramid_level_count = m_hiz_pass->get_level_count(),
+            .meshlet_visibility_address = scene.visibility_buffer_address,
+            .object_visibility_address =
+                scene.visibility_buffer_address + scene.gpu_meshlet_count * sizeof(uint32_t),
+            .statistics = {},
+        };
+        vkCmdUpdateBuffer(cmd_buffer, m_data_buffer.buffer, 0, sizeof(CullData), &data);
+        vkCmdFillBuffer(
+            cmd_buffer,
+            scene.visibility_buffer.buffer,
+            scene.gpu_meshlet_count * sizeof(uint32_t),
+            scene.objects.size() * sizeof(uint32_t),
+            0
+        );
+    }
+    vkCmdFillBuffer(cmd_buffer, scene.draw_buffer.buffer, 0, DRAW_COUNTS_SIZE, 0);
+    memory_barrier(
+        cmd_buffer,
+        VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+        VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+    );
+
+    Frustum frustum = extract_frustum(scene.camera.get_matrix());
+    CullPushConstants push_constants{
+        .frustum_planes =
+            {
+                frustum.planes[0],
+                frustum.planes[1],
+                frustum.planes[2],
+                frustum.planes[3],
+                frustum.planes[4],
+            },
+        .far_plane_distance = frustum.planes[5].w,
+        .lod_scale = lod_scale,
+        .cull_data_address = m_data_buffer_address,
+        .camera_position = scene.camera.eye,
+        .meshlet_count = scene.gpu_meshlet_count,
+        .meshlet_buffer_address = scene.meshlet_buffer_address,
+        .draw_buffer_address = scene.draw_buffer_address,
+    };
+    VkDescriptorSet pyramid_set = m_hiz_pass->get_pyramid_set();
+    vkCmdBindPipeline(
+        cmd_buffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        m_pipelines[static_cast<size_t>(phase)]
+    );
+    vkCmdBindDescriptorSets(
+        cmd_buffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        m_pipeline_layout,
+        0,
+        1,
+        &pyramid_set,
+        0,
+        nullptr
+    );
+    vkCmdPushConstants(
+        cmd_buffer,
+        m_pipeline_layout,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(CullPushConstants),
+        &push_constants
+    );
+    vkCmdDispatch(
+        cmd_buffer,
+        (push_constants.meshlet_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+        1,
+        1
+    );
+
+    memory_barrier(
+        cmd_buffer,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COPY_BIT,
+        VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT
+    );
+
+    if (last_phase)
+    {
+        VkBufferCopy region{
+            .srcOffset = offsetof(CullData, statistics),
+            .dstOffset = 0,
+            .size = sizeof(CullStatistics),
+        };
+        vkCmdCopyBuffer(
+            cmd_buffer,
+            m_data_buffer.buffer,
+            m_readback_buffers[frame_index].buffer,
+            1,
+            &region
+        );
+        memory_barrier(
+            cmd_buffer,
+            VK_PIPELINE_STAGE_2_COPY_BIT,
+            VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_HOST_BIT,
+            VK_ACCESS_2_HOST_READ_BIT
+        );
+        m_readback_pending[frame_index] = true;
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+
+#include <vulkan/vulkan_core.h>
+
+#include "deletion_queue.hpp"
+#include "engine.hpp"
+#include "gpu.hpp"
+#include "scene.hpp"
+
+class HiZPass;
+
+// Which meshlets a `CullPass::render` call draws, used as the `PHASE` constant of cull.comp.
+enum class CullPhase : uint32_t
+{
+    // Every visible meshlet, without occlusion culling.
+    All = 0,
+    // The meshlets that were visible in the last frame, to be drawn before the depth pyramid is
+    // built.
+    First = 1,
+    // The meshlets that are not occluded according to the depth pyramid and were not drawn in
+    // the first phase. Also decides which meshlets the first phase of the next frame draws.
+    Second = 2,
+};
+
+// Selects the level of detail of every object of a scene on the GPU, culls its meshlets against
+// the camera frustum and their normal cones and writes an indexed indirect draw for every
+// visible meshlet into the scene's draw buffer, together with the number of draws.
+//
+// With occlusion culling a frame is culled in two phases. The first draws what was visible in
+// the last frame, the second tests every meshlet against the depth pyramid built from that and
+// draws what became visible.
+class CullPass
+{
+  public:
+    static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+  private:
+    DeletionQueue m_deletion_queue;
+
+    Engine &m_engine;
+    const HiZPass *m_hiz_pass{nullptr};
+
+    VkPipelineLayout m_pipeline_layout;
+    std::array<VkPipeline, 3> m_pipelines;
+
+    // `CullData`, rewritten before the first phase of every frame.
+    GPUBuffer m_data_buffer;
+    VkDeviceAddress m_data_buffer_address{0};
+
+    // The statistics of each frame in flight, read once the frame slot comes around again.
+    std::array<GPUBuffer, Engine::NUM_FRAMES_IN_FLIGHT> m_readback_buffers;
+    std::array<bool, Engine::NUM_FRAMES_IN_FLIGHT> m_readback_pending{};
+    CullStatistics m_statistics{};
+
+    CullPass() = delete;
+    CullPass(const CullPass &) = delete;
+    CullPass &operator=(const CullPass &) = delete;
+    CullPass(CullPass &&) = delete;
+    CullPass &operator=(CullPass &&) = delete;
+
+  public:
+    explicit CullPass(Engine &engine) : m_engine(engine)
+    {
+    }
+
+    ~CullPass()
+    {
+        m_deletion_queue.delete_all();
+    }
+
+    // Statistics of the last frame whose results have been read back.
+    const CullStatistics &get_statistics() const
+    {
+        return m_statistics;
+    }
+
+    // `hiz_pass` provides the depth pyramid for the second phase and must outlive the pass.
+    [[nodiscard]] bool init(const HiZPass &hiz_pass);
+
+    // Must be recorded before the scene is drawn in the same command buffer, once per frame
+    // with `CullPhase::All` or with `CullPhase::First` and later `CullPhase::Second`. Does
+    // nothing if the scene's buffers are not resident yet. See `Camera::get_lod_scale` for
+    // `lod_scale`.
+    void render(VkCommandBuffer cmd_buffer, const Scene &scene, float lod_scale, CullPhase phase);
+};
@@ -0,0 +1,260 @@
+#include "culling.hpp"
+
+#include <bit>
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+void ObjectBounds::push_back(const BoundingSphere &sphere, const BoundingBox &box)
+{
+    center_x.emplace_back(sphere.center.x);
+    center_y.emplace_back(sphere.center.y);
+    center_z.emplace_back(sphere.center.z);
+    radius.emplace_back(sphere.radius);
+
+    min_x.emplace_back(box.min.x);
+    min_y.emplace_back(box.min.y);
+    min_z.emplace_back(box.min.z);
+    max_x.emplace_back(box.max.x);
+    max_y.emplace_back(box.max.y);
+    max_z.emplace_back(box.max.z);
+}
+
+void ObjectBounds::clear()
+{
+    for (std::vector<float> *values :
+         {&center_x, &center_y, &center_z, &radius, &min_x, &min_y, &min_z, &max_x, &max_y, &max_z})
+    {
+        values->clear();
+    }
+}
+
+Frustum extract_frustum(const glm::mat4 &view_proj)
+{
+    // glm matrices are column-major, so row `i` of the matrix is `(m[0][i], ..., m[3][i])`.
+    auto row = [&](int i) {
+        return glm::vec4(view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]);
+    };
+
+    Frustum frustum{
+        .planes =
+            {
+                row(3) + row(0),
+                row(3) - row(0),
+                row(3) + row(1),
+                row(3) - row(1),
+                row(3) + row(2),
+                row(3) - row(2),
+            },
+    };
+    for (glm::vec4 &plane : frustum.planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+BoundingBox compute_bounding_box(std::span<const Vertex> vertices)
+{
+    if (vertices.empty())
+    {
+        return BoundingBox{.min = glm::vec3(0.0f), .max = glm::vec3(0.0f)};
+    }
+
+    BoundingBox box{
+        .min = glm::vec3(std::numeric_limits<float>::max()),
+        .max = glm::vec3(std::numeric_limits<float>::lowest()),
+    };
+    for (const Vertex &vertex : vertices)
+    {
+        box.min = glm::min(box.min, vertex.position);
+        box.max = glm::max(box.max, vertex.position);
+    }
+    return box;
+}
+
+BoundingSphere compute_bounding_sphere(const BoundingBox &box)
+{
+    return BoundingSphere{
+        .center = (box.min + box.max) * 0.5f,
+        .radius = glm::length(box.max - box.min) * 0.5f,
+    };
+}
+
+bool is_sphere_visible(const Frustum &frustum, const BoundingSphere &sphere)
+{
+    for (const glm::vec4 &plane : frustum.planes)
+    {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool is_box_visible(const Frustum &frustum, const BoundingBox &box)
+{
+    // Only the corner furthest along the plane normal needs to be tested.
+    for (const glm::vec4 &plane : frustum.planes)
+    {
+        glm::vec3 corner(
+            plane.x >= 0.0f ? box.max.x : box.min.x,
+            plane.y >= 0.0f ? box.max.y : box.min.y,
+            plane.z >= 0.0f ? box.max.z : box.min.z
+        );
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if defined(__AVX__)
+
+static constexpr size_t CULL_BATCH_SIZE = 8;
+
+// Tests `CULL_BATCH_SIZE` objects starting at `first` and returns a bit mask of visible ones.
+static uint32_t cull_batch(const Frustum &frustum, const ObjectBounds &bounds, size_t first)
+{
+    __m256 center_x = _mm256_loadu_ps(&bounds.center_x[first]);
+    __m256 center_y = _mm256_loadu_ps(&bounds.center_y[first]);
+    __m256 center_z = _mm256_loadu_ps(&bounds.center_z[first]);
+    __m256 neg_radius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&bounds.radius[first]));
+    __m256 min_x = _mm256_loadu_ps(&bounds.min_x[first]);
+    __m256 min_y = _mm256_loadu_ps(&bounds.min_y[first]);
+    __m256 min_z = _mm256_loadu_ps(&bounds.min_z[first]);
+    __m256 max_x = _mm256_loadu_ps(&bounds.max_x[first]);
+    __m256 max_y = _mm256_loadu_ps(&bounds.max_y[first]);
+    __m256 max_z = _mm256_loadu_ps(&bounds.max_z[first]);
+
+    uint32_t mask = (1u << CULL_BATCH_SIZE) - 1;
+    for (const glm::vec4 &plane : frustum.planes)
+    {
+        __m256 nx = _mm256_set1_ps(plane.x);
+        __m256 ny = _mm256_set1_ps(plane.y);
+        __m256 nz = _mm256_set1_ps(plane.z);
+        __m256 d = _mm256_set1_ps(plane.w);
+
+        __m256 sphere_dist = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(nx, center_x), _mm256_mul_ps(ny, center_y)),
+            _mm256_add_ps(_mm256_mul_ps(nz, center_z), d)
+        );
+        mask &= static_cast<uint32_t>(
+            _mm256_movemask_ps(_mm256_cmp_ps(sphere_dist, neg_radius, _CMP_GE_OQ))
+        );
+
+        __m256 box_dist = _mm256_add_ps(
+            _mm256_add_ps(
+                _mm256_mul_ps(nx, plane.x >= 0.0f ? max_x : min_x),
+                _mm256_mul_ps(ny, plane.y >= 0.0f ? max_y : min_y)
+            ),
+            _mm256_add_ps(_mm256_mul_ps(nz, plane.z >= 0.0f ? max_z : min_z), d)
+        );
+        mask &= static_cast<uint32_t>(
+            _mm256_movemask_ps(_mm256_cmp_ps(box_dist, _mm256_setzero_ps(), _CMP_GE_OQ))
+        );
+
+        if (mask == 0)
+        {
+            break;
+        }
+    }
+    return mask;
+}
+
+#elif defined(__SSE__) || defined(_M_X64)
+
+static constexpr size_t CULL_BATCH_SIZE = 4;
+
+// Tests `CULL_BATCH_SIZE` objects starting at `first` and returns a bit mask of visible ones.
+static uint32_t cull_batch(const Frustum &frustum, const ObjectBounds &bounds, size_t first)
+{
+    __m128 center_x = _mm_loadu_ps(&bounds.center_x[first]);
+    __m128 center_y = _mm_loadu_ps(&bounds.center_y[first]);
+    __m128 center_z = _mm_loadu_ps(&bounds.center_z[first]);
+    __m128 neg_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&bounds.radius[first]));
+    __m128 min_x = _mm_loadu_ps(&bounds.min_x[first]);
+    __m128 min_y = _mm_loadu_ps(&bounds.min_y[first]);
+    __m128 min_z = _mm_loadu_ps(&bounds.min_z[first]);
+    __m128 max_x = _mm_loadu_ps(&bounds.max_x[first]);
+    __m128 max_y = _mm_loadu_ps(&bounds.max_y[first]);
+    __m128 max_z = _mm_loadu_ps(&bounds.max_z[first]);
+
+    uint32_t mask = (1u << CULL_BATCH_SIZE) - 1;
+    for (const glm::vec4 &plane : frustum.planes)
+    {
+        __m128 nx = _mm_set1_ps(plane.x);
+        __m128 ny = _mm_set1_ps(plane.y);
+        __m128 nz = _mm_set1_ps(plane.z);
+        __m128 d = _mm_set1_ps(plane.w);
+
+        __m128 sphere_dist = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(nx, center_x), _mm_mul_ps(ny, center_y)),
+            _mm_add_ps(_mm_mul_ps(nz, center_z), d)
+        );
+        mask &= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(sphere_dist, neg_radius)));
+
+        __m128 box_dist = _mm_add_ps(
+            _mm_add_ps(
+                _mm_mul_ps(nx, plane.x >= 0.0f ? max_x : min_x),
+                _mm_mul_ps(ny, plane.y >= 0.0f ? max_y : min_y)
+            ),
+            _mm_add_ps(_mm_mul_ps(nz, plane.z >= 0.0f ? max_z : min_z), d)
+        );
+        mask &= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(box_dist, _mm_setzero_ps())));
+
+        if (mask == 0)
+        {
+            break;
+        }
+    }
+    return mask;
+}
+
+#endif
+
+void cull_objects(
+    const Frustum &frustum, const ObjectBounds &bounds, std::vector<uint32_t> &out_visible
+)
+{
+    size_t first_scalar = 0;
+
+#if defined(__AVX__) || defined(__SSE__) || defined(_M_X64)
+    first_scalar = bounds.size() - bounds.size() % CULL_BATCH_SIZE;
+    for (size_t first = 0; first < first_scalar; first += CULL_BATCH_SIZE)
+    {
+        uint32_t mask = cull_batch(frustum, bounds, first);
+        while (mask != 0)
+        {
+            out_visible.emplace_back(static_cast<uint32_t>(first + std::countr_zero(mask)));
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    // Remaining objects, or all of them if no vector instructions are available.
+    for (size_t i = first_scalar; i < bounds.size(); ++i)
+    {
+        BoundingSphere sphere{
+            .center = glm::vec3(bounds.center_x[i], bounds.center_y[i], bounds.center_z[i]),
+            .radius = bounds.radius[i],
+        };
+        BoundingBox box{
+            .min = glm::vec3(bounds.min_x[i], bounds.min_y[i], bounds.min_z[i]),
+            .max = glm::vec3(bounds.max_x[i], bounds.max_y[i], bounds.max_z[i]),
+        };
+        if (is_sphere_visible(frustum, sphere) && is_box_visible(frustum, box))
+        {
+            out_visible.emplace_back(static_cast<uint32_t>(i));
+        }
+    }
+}
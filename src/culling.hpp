@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "vertex.hpp"
+
+struct BoundingBox
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+struct BoundingSphere
+{
+    glm::vec3 center;
+    float radius;
+};
+
+// Bounds of every object of a scene in structure-of-arrays layout so several objects can be
+// tested against a plane at once.
+struct ObjectBounds
+{
+    std::vector<float> center_x;
+    std::vector<float> center_y;
+    std::vector<float> center_z;
+    std::vector<float> radius;
+
+    std::vector<float> min_x;
+    std::vector<float> min_y;
+    std::vector<float> min_z;
+    std::vector<float> max_x;
+    std::vector<float> max_y;
+    std::vector<float> max_z;
+
+    size_t size() const
+    {
+        return radius.size();
+    }
+
+    void push_back(const BoundingSphere &sphere, const BoundingBox &box);
+    void clear();
+};
+
+// Simplified world space geometry of a mesh that is rasterized into the occlusion buffer to
+// hide the objects behind it.
+struct OccluderMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+
+    bool empty() const
+    {
+        return indices.empty();
+    }
+};
+
+// Planes of a view frustum with normals pointing inwards, in the order left, right, bottom, top,
+// near and far. A point `p` is inside a plane if `dot(plane.xyz, p) + plane.w >= 0`.
+struct Frustum
+{
+    std::array<glm::vec4, 6> planes;
+};
+
+// Extracts the normalized frustum planes of a combined projection and view matrix with a
+// clip space depth range of [-w, w].
+Frustum extract_frustum(const glm::mat4 &view_proj);
+
+BoundingBox compute_bounding_box(std::span<const Vertex> vertices);
+
+// Sphere around `box`.
+BoundingSphere compute_bounding_sphere(const BoundingBox &box);
+
+bool is_sphere_visible(const Frustum &frustum, const BoundingSphere &sphere);
+bool is_box_visible(const Frustum &frustum, const BoundingBox &box);
+
+// Appends the index of every object whose bounding sphere and bounding box both intersect
+// `frustum` to `out_visible`, in ascending order. Uses AVX or SSE when compiled for them.
+void cull_objects(
+    const Frustum &frustum, const ObjectBounds &bounds, std::vector<uint32_t> &out_visible
+);
@@ -0,0 +1,118 @@
+#include "draw_list.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+#include <glm/geometric.hpp>
+
+#include "cpu_profiler.hpp"
+
+void DrawList::build(const Scene &scene, std::span<const uint32_t> visible_objects, float lod_scale)
+{
+    CPU_ZONE("DrawList::build");
+
+    m_keys.clear();
+    m_unsorted_items.clear();
+    m_keys.reserve(visible_objects.size());
+    m_unsorted_items.reserve(visible_objects.size());
+    m_triangle_count = 0;
+
+    glm::vec3 eye = scene.camera.eye;
+    glm::vec3 forward = scene.camera.get_forward();
+    for (uint32_t object_idx : visible_objects)
+    {
+        const Mesh &mesh = scene.meshes[scene.objects[object_idx].mesh_idx];
+
+        float view_depth = glm::dot(mesh.bounding_sphere.center - eye, forward);
+        m_keys.emplace_back(make_key(
+            Pipeline::Opaque,
+            mesh.index_type,
+            view_depth,
+            static_cast<uint32_t>(mesh.material_idx)
+        ));
+        const MeshLod &lod = mesh.lods[mesh.select_lod(eye, lod_scale)];
+        m_triangle_count += lod.index_count / 3;
+        m_unsorted_items.emplace_back(DrawItem{
+            .index_count = lod.index_count,
+            .first_index = mesh.indices.offset + lod.index_offset,
+            .vertex_offset = static_cast<int32_t>(mesh.vertices.offset),
+            .object_index = object_idx,
+            .index_type = mesh.index_type,
+        });
+    }
+
+    sort();
+
+    m_items.resize(m_unsorted_items.size());
+    for (size_t i = 0; i < m_order.size(); ++i)
+    {
+        m_items[i] = m_unsorted_items[m_order[i]];
+    }
+}
+
+uint64_t DrawList::make_key(
+    Pipeline pipeline, VkIndexType index_type, float view_depth, uint32_t material
+)
+{
+    // The bits of non-negative floats sort like the floats themselves, so the top bits of the
+    // depth give a quantization with constant relative precision.
+    uint32_t depth_bits = std::bit_cast<uint32_t>(std::max(view_depth, 0.0f)) >> (32 - DEPTH_BITS);
+
+    uint64_t wide_indices = index_type == VK_INDEX_TYPE_UINT32 ? 1 : 0;
+
+    return static_cast<uint64_t>(pipeline) << (INDEX_TYPE_BITS + DEPTH_BITS + MATERIAL_BITS) |
+           wide_indices << (DEPTH_BITS + MATERIAL_BITS) |
+           static_cast<uint64_t>(depth_bits) << MATERIAL_BITS | static_cast<uint64_t>(material);
+}
+
+void DrawList::sort()
+{
+    size_t count = m_keys.size();
+    m_order.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        m_order[i] = static_cast<uint32_t>(i);
+    }
+    m_scratch_keys.resize(count);
+    m_scratch_order.resize(count);
+
+    // Least significant digit first radix sort over bytes. The histograms of all digits are
+    // gathered in one pass and digits that are equal for every key are skipped, which is
+    // common for the pipeline and the upper material bytes.
+    constexpr size_t DIGIT_COUNT = sizeof(uint64_t);
+    std::array<std::array<uint32_t, 256>, DIGIT_COUNT> histograms{};
+    for (uint64_t key : m_keys)
+    {
+        for (size_t digit = 0; digit < DIGIT_COUNT; ++digit)
+        {
+            ++histograms[digit][(key >> (digit * 8)) & 0xff];
+        }
+    }
+
+    for (size_t digit = 0; digit < DIGIT_COUNT; ++digit)
+    {
+        std::array<uint32_t, 256> &histogram = histograms[digit];
+        if (count == 0 || histogram[(m_keys[0] >> (digit * 8)) & 0xff] == count)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t &bucket : histogram)
+        {
+            uint32_t bucket_count = bucket;
+            bucket = offset;
+            offset += bucket_count;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t dst = histogram[(m_keys[i] >> (digit * 8)) & 0xff]++;
+            m_scratch_keys[dst] = m_keys[i];
+            m_scratch_order[dst] = m_order[i];
+        }
+        m_keys.swap(m_scratch_keys);
+        m_order.swap(m_scratch_order);
+    }
+}
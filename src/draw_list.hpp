@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "scene.hpp"
+
+// Everything needed to record one draw, copied out of the scene's objects, meshes and materials
+// so recording only touches one tightly packed array.
+struct DrawItem
+{
+    uint32_t index_count;
+    uint32_t first_index;
+    int32_t vertex_offset;
+    // Passed as the first instance so the shaders can find the object's material.
+    uint32_t object_index;
+    VkIndexType index_type;
+};
+
+// Per-frame list of draws sorted by a 64-bit key.
+//
+// From most to least significant the key holds the pipeline, the index type, the view depth of
+// the object's bounding sphere and the material. Draws sharing a pipeline and index buffer are
+// contiguous so each binding changes at most once. Sorting by depth before material draws opaque
+// objects front to back for early depth rejection; materials are bound bindlessly so grouping by
+// them would not save any state changes.
+class DrawList
+{
+  public:
+    static constexpr uint32_t PIPELINE_BITS = 7;
+    static constexpr uint32_t INDEX_TYPE_BITS = 1;
+    static constexpr uint32_t DEPTH_BITS = 24;
+    static constexpr uint32_t MATERIAL_BITS = 32;
+
+    enum class Pipeline : uint8_t
+    {
+        Opaque,
+    };
+
+  private:
+    std::vector<uint64_t> m_keys;
+    std::vector<uint32_t> m_order;
+    std::vector<uint64_t> m_scratch_keys;
+    std::vector<uint32_t> m_scratch_order;
+
+    std::vector<DrawItem> m_unsorted_items;
+    std::vector<DrawItem> m_items;
+    uint64_t m_triangle_count{0};
+
+  public:
+    // Draws every object of `visible_objects` at the level of detail selected by
+    // `Mesh::select_lod`.
+    void build(const Scene &scene, std::span<const uint32_t> visible_objects, float lod_scale);
+
+    std::span<const DrawItem> get_items() const
+    {
+        return m_items;
+    }
+
+    uint64_t get_triangle_count() const
+    {
+        return m_triangle_count;
+    }
+
+    // Objects behind the camera are clamped to a depth of zero.
+    static uint64_t
+    make_key(Pipeline pipeline, VkIndexType index_type, float view_depth, uint32_t material);
+
+  private:
+    void sort();
+};
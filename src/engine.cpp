@@ -1,8 +1,10 @@
 #include "engine.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <cstring>
+#include <filesystem>
 #include <limits>
 #include <vector>
 
@@ -26,10 +28,26 @@
 
 #include <stb_image.h>
 
+#include "cpu_profiler.hpp"
+#include "mipmap.hpp"
 #include "vkerr.hpp"
 
 bool Engine::init()
 {
+    if (!m_archive_path.empty() && std::filesystem::exists(m_archive_path))
+    {
+        m_deletion_queue.add([&] { m_asset_archive.close(); });
+        if (!m_asset_archive.open(m_archive_path))
+        {
+            spdlog::error("Engine::init: failed to open asset archive");
+            return false;
+        }
+    }
+    else
+    {
+        spdlog::info("Engine::init: no asset archive at `{}`, using loose files", m_archive_path);
+    }
+
     vkb::InstanceBuilder instance_builder;
     auto instance_builder_ret = instance_builder.set_app_name("Aurora")
                                     .set_app_version(0, 1)
@@ -38,6 +56,7 @@ bool Engine::init()
                                     .require_api_version(1, 3)
                                     .request_validation_layers()
                                     .set_debug_callback(Engine::debug_message_callback)
+                                    .set_headless(is_headless())
                                     .build();
     if (!instance_builder_ret)
     {
@@ -57,13 +76,23 @@ bool Engine::init()
     });
     spdlog::trace("Engine::init: created vulkan instance");
 
-    if (!SDL_Vulkan_CreateSurface(m_window, vkb_instance.instance, nullptr, &m_surface))
+    if (!is_headless())
     {
-        spdlog::error("Engine::init: failed to create surface from sdl window: {}", SDL_GetError());
-        return false;
+        if (!SDL_Vulkan_CreateSurface(m_window, vkb_instance.instance, nullptr, &m_surface))
+        {
+            spdlog::error(
+                "Engine::init: failed to create surface from sdl window: {}",
+                SDL_GetError()
+            );
+            return false;
+        }
+        m_deletion_queue.add([&] { vkDestroySurfaceKHR(m_instance, m_surface, nullptr); });
+        spdlog::trace("Engine::init: created vulkan surface from sdl window");
+    }
+    else
+    {
+        spdlog::info("Engine::init: running headless, no surface will be created");
     }
-    m_deletion_queue.add([&] { vkDestroySurfaceKHR(m_instance, m_surface, nullptr); });
-    spdlog::trace("Engine::init: created vulkan surface from sdl window");
 
     VkPhysicalDeviceVulkan13Features features_1_3 = {};
     features_1_3.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
@@ -74,10 +103,27 @@ bool Engine::init()
     features_1_2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
     features_1_2.bufferDeviceAddress = true;
     features_1_2.descriptorIndexing = true;
+    features_1_2.runtimeDescriptorArray = true;
+    features_1_2.descriptorBindingPartiallyBound = true;
+    features_1_2.descriptorBindingSampledImageUpdateAfterBind = true;
+    features_1_2.descriptorBindingUpdateUnusedWhilePending = true;
+    features_1_2.timelineSemaphore = true;
+    features_1_2.drawIndirectCount = true;
 
     vkb::PhysicalDeviceSelector selector(vkb_instance);
-    auto selector_ret = selector.set_surface(m_surface)
-                            .set_minimum_version(1, 3)
+    if (!is_headless())
+    {
+        selector.set_surface(m_surface);
+    }
+    VkPhysicalDeviceFeatures features = {};
+    features.samplerAnisotropy = true;
+    features.textureCompressionBC = true;
+    features.multiDrawIndirect = true;
+    features.drawIndirectFirstInstance = true;
+    features.pipelineStatisticsQuery = true;
+
+    auto selector_ret = selector.set_minimum_version(1, 3)
+                            .set_required_features(features)
                             .set_required_features_13(features_1_3)
                             .set_required_features_12(features_1_2)
                             .select();
@@ -91,6 +137,30 @@ bool Engine::init()
     }
     vkb::PhysicalDevice vkb_physical_device = selector_ret.value();
     m_physical_device = vkb_physical_device.physical_device;
+    m_device_name = vkb_physical_device.name;
+    m_max_sampler_anisotropy = vkb_physical_device.properties.limits.maxSamplerAnisotropy;
+
+    VkPhysicalDeviceVulkan12Properties properties_1_2 = {};
+    properties_1_2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &properties_1_2;
+    vkGetPhysicalDeviceProperties2(m_physical_device, &properties);
+    m_max_bindless_textures = std::min({
+        properties_1_2.maxDescriptorSetUpdateAfterBindSampledImages,
+        properties_1_2.maxDescriptorSetUpdateAfterBindSamplers,
+        properties_1_2.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        properties_1_2.maxPerStageDescriptorUpdateAfterBindSamplers,
+        properties_1_2.maxPerStageUpdateAfterBindResources,
+    });
+
+    // Optional, without it nothing is recorded into secondary command buffers while the gpu
+    // profiler counts pipeline statistics. The device builder enables the selected device's
+    // `features`.
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(m_physical_device, &supported_features);
+    m_inherited_queries = supported_features.inheritedQueries == VK_TRUE;
+    vkb_physical_device.features.inheritedQueries = supported_features.inheritedQueries;
     spdlog::trace("Engine::init: selected vulkan physical device");
     spdlog::info("Engine::init: selected physical device: {}", vkb_physical_device.name);
 
@@ -123,12 +193,15 @@ bool Engine::init()
     });
     spdlog::trace("Engine::init: created vma allocator");
 
-    if (!init_swapchain())
+    if (!is_headless())
     {
-        spdlog::error("Engine::init: failed to initialize swapchain");
-        return false;
+        if (!init_swapchain())
+        {
+            spdlog::error("Engine::init: failed to initialize swapchain");
+            return false;
+        }
+        spdlog::trace("Engine::init: initialized swapchain");
     }
-    spdlog::trace("Engine::init: initialized swapchain");
 
     {
         std::array pool_sizes = {
@@ -147,6 +220,7 @@ bool Engine::init()
 
         VkDescriptorPoolCreateInfo pool_info = {};
         pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
         pool_info.maxSets = 100;
         pool_info.poolSizeCount = pool_sizes.size();
         pool_info.pPoolSizes = pool_sizes.data();
@@ -171,6 +245,45 @@ bool Engine::init()
     m_graphics_queue_family = vkb_device.get_queue_index(vkb::QueueType::graphics).value();
     spdlog::trace("Engine::init: acquired graphics queue");
 
+    if (auto dedicated_ret = vkb_device.get_dedicated_queue(vkb::QueueType::transfer))
+    {
+        m_transfer_queue = dedicated_ret.value();
+        m_transfer_queue_family =
+            vkb_device.get_dedicated_queue_index(vkb::QueueType::transfer).value();
+        spdlog::info(
+            "Engine::init: using dedicated transfer queue family {}",
+            m_transfer_queue_family
+        );
+    }
+    else if (auto separate_ret = vkb_device.get_queue(vkb::QueueType::transfer))
+    {
+        m_transfer_queue = separate_ret.value();
+        m_transfer_queue_family = vkb_device.get_queue_index(vkb::QueueType::transfer).value();
+        spdlog::info(
+            "Engine::init: using separate transfer queue family {}",
+            m_transfer_queue_family
+        );
+    }
+    else
+    {
+        m_transfer_queue = m_graphics_queue;
+        m_transfer_queue_family = m_graphics_queue_family;
+        spdlog::info("Engine::init: no separate transfer queue, uploading on graphics queue");
+    }
+
+    float timestamp_period = 0.0f;
+    if (vkb_physical_device.get_queue_families()[m_graphics_queue_family].timestampValidBits > 0)
+    {
+        timestamp_period = vkb_physical_device.properties.limits.timestampPeriod;
+    }
+    if (!m_gpu_profiler.init(m_device, timestamp_period, NUM_FRAMES_IN_FLIGHT))
+    {
+        spdlog::error("Engine::init: failed to initialize gpu profiler");
+        return false;
+    }
+    m_deletion_queue.add([&] { m_gpu_profiler.destroy(); });
+    spdlog::trace("Engine::init: initialized gpu profiler");
+
     for (auto &frame : m_frames)
     {
         VkCommandPoolCreateInfo cmd_pool_info = {};
@@ -263,6 +376,50 @@ bool Engine::init()
         );
     }
 
+    m_deletion_queue.add([&] { m_thread_pool.destroy(); });
+    if (!m_thread_pool.init())
+    {
+        spdlog::error("Engine::init: failed to initialize thread pool");
+        return false;
+    }
+    spdlog::trace("Engine::init: initialized thread pool");
+
+    for (auto &frame : m_frames)
+    {
+        frame.secondary_commands.resize(std::max<size_t>(m_thread_pool.get_thread_count(), 1));
+        for (SecondaryCommands &commands : frame.secondary_commands)
+        {
+            VkCommandPoolCreateInfo cmd_pool_info = {};
+            cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            cmd_pool_info.queueFamilyIndex = m_graphics_queue_family;
+            VKERR(
+                vkCreateCommandPool(m_device, &cmd_pool_info, nullptr, &commands.cmd_pool),
+                "Engine::init: failed to create secondary command pool"
+            );
+            m_deletion_queue.add([&] {
+                vkDestroyCommandPool(m_device, commands.cmd_pool, nullptr);
+            });
+        }
+    }
+    spdlog::trace("Engine::init: created secondary command pools");
+
+    m_deletion_queue.add([&] { m_upload_manager.destroy(); });
+    if (!m_upload_manager.init())
+    {
+        spdlog::error("Engine::init: failed to initialize upload manager");
+        return false;
+    }
+    spdlog::trace("Engine::init: initialized upload manager");
+
+    m_deletion_queue.add([&] { m_geometry_buffer.destroy(); });
+    if (!m_geometry_buffer.init())
+    {
+        spdlog::error("Engine::init: failed to initialize geometry buffer");
+        return false;
+    }
+    spdlog::trace("Engine::init: initialized geometry buffer");
+
     return true;
 }
 
@@ -341,12 +498,23 @@ Engine::~Engine()
 [[nodiscard]] bool
 Engine::start_frame(VkCommandBuffer &out_cmd_buffer, uint32_t &swapchain_image_idx)
 {
+    CPU_ZONE("Engine::start_frame");
+
     FrameData &frame = m_frames[m_frame_idx];
 
-    VKERR(
-        vkWaitForFences(m_device, 1, &frame.fence, VK_TRUE, std::numeric_limits<uint64_t>::max()),
-        "Engine::start_frame: failed to wait on frame fence"
-    );
+    {
+        CPU_ZONE("wait frame fence");
+        VKERR(
+            vkWaitForFences(
+                m_device,
+                1,
+                &frame.fence,
+                VK_TRUE,
+                std::numeric_limits<uint64_t>::max()
+            ),
+            "Engine::start_frame: failed to wait on frame fence"
+        );
+    }
     VKERR(
         vkResetFences(m_device, 1, &frame.fence),
         "Engine::start_frame: failed to reset frame fence"
@@ -354,17 +522,42 @@ Engine::start_frame(VkCommandBuffer &out_cmd_buffer, uint32_t &swapchain_image_i
 
     frame.deletion_queue.delete_all();
 
-    VKERR(
-        vkAcquireNextImageKHR(
-            m_device,
-            m_swapchain.swapchain,
-            std::numeric_limits<uint64_t>::max(),
-            frame.render_semaphore,
-            VK_NULL_HANDLE,
-            &swapchain_image_idx
-        ),
-        "Engine::start_frame: failed to acquire next swapchain image"
-    );
+    // Secondary command buffers are recorded anew every frame, resetting their pools at once is
+    // cheaper than resetting each buffer.
+    for (SecondaryCommands &commands : frame.secondary_commands)
+    {
+        VKERR(
+            vkResetCommandPool(m_device, commands.cmd_pool, 0),
+            "Engine::start_frame: failed to reset secondary command pool"
+        );
+        commands.used_count = 0;
+    }
+
+    if (!m_upload_manager.update())
+    {
+        spdlog::error("Engine::start_frame: failed to update upload manager");
+        return false;
+    }
+
+    if (!is_headless())
+    {
+        CPU_ZONE("vkAcquireNextImageKHR");
+        VKERR(
+            vkAcquireNextImageKHR(
+                m_device,
+                m_swapchain.swapchain,
+                std::numeric_limits<uint64_t>::max(),
+                frame.render_semaphore,
+                VK_NULL_HANDLE,
+                &swapchain_image_idx
+            ),
+            "Engine::start_frame: failed to acquire next swapchain image"
+        );
+    }
+    else
+    {
+        swapchain_image_idx = 0;
+    }
 
     VKERR(
         vkResetCommandBuffer(frame.cmd_buffer, 0),
@@ -378,15 +571,52 @@ Engine::start_frame(VkCommandBuffer &out_cmd_buffer, uint32_t &swapchain_image_i
         "Engine::start_frame: failed to begin command buffer"
     );
 
+    frame.upload_wait_value = m_upload_manager.record_acquires(frame.cmd_buffer);
+
+    if (!m_gpu_profiler.begin_frame(frame.cmd_buffer, m_frame_idx, m_frame_number++))
+    {
+        spdlog::error("Engine::start_frame: failed to begin gpu profiler frame");
+        return false;
+    }
+    frame.gpu_frame_scope = m_gpu_profiler.begin_scope(frame.cmd_buffer, "Frame");
+
     out_cmd_buffer = frame.cmd_buffer;
 
     return true;
 }
 
+[[nodiscard]] bool
+Engine::get_secondary_command_buffer(size_t slot, VkCommandBuffer &out_cmd_buffer)
+{
+    SecondaryCommands &commands = m_frames[m_frame_idx].secondary_commands[slot];
+    if (commands.used_count == commands.cmd_buffers.size())
+    {
+        VkCommandBufferAllocateInfo cmd_buffer_info = {};
+        cmd_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmd_buffer_info.commandPool = commands.cmd_pool;
+        cmd_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        cmd_buffer_info.commandBufferCount = 1;
+        VkCommandBuffer cmd_buffer;
+        VKERR(
+            vkAllocateCommandBuffers(m_device, &cmd_buffer_info, &cmd_buffer),
+            "Engine::get_secondary_command_buffer: failed to allocate command buffer"
+        );
+        commands.cmd_buffers.push_back(cmd_buffer);
+    }
+
+    out_cmd_buffer = commands.cmd_buffers[commands.used_count++];
+
+    return true;
+}
+
 [[nodiscard]] bool Engine::finish_frame(uint32_t swapchain_image_idx)
 {
+    CPU_ZONE("Engine::finish_frame");
+
     FrameData &frame = m_frames[m_frame_idx];
 
+    m_gpu_profiler.end_scope(frame.cmd_buffer, frame.gpu_frame_scope);
+
     VKERR(
         vkEndCommandBuffer(frame.cmd_buffer),
         "Engine::render_frame: failed to end command buffer"
@@ -401,6 +631,23 @@ Engine::start_frame(VkCommandBuffer &out_cmd_buffer, uint32_t &swapchain_image_i
     render_semaphore_submit_info.semaphore = frame.render_semaphore;
     render_semaphore_submit_info.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR;
 
+    VkSemaphoreSubmitInfo upload_semaphore_submit_info = {};
+    upload_semaphore_submit_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    upload_semaphore_submit_info.semaphore = m_upload_manager.get_timeline_semaphore();
+    upload_semaphore_submit_info.value = frame.upload_wait_value;
+    upload_semaphore_submit_info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    std::array<VkSemaphoreSubmitInfo, 2> wait_semaphore_infos;
+    uint32_t wait_semaphore_count = 0;
+    if (!is_headless())
+    {
+        wait_semaphore_infos[wait_semaphore_count++] = render_semaphore_submit_info;
+    }
+    if (frame.upload_wait_value > 0)
+    {
+        wait_semaphore_infos[wait_semaphore_count++] = upload_semaphore_submit_info;
+    }
+
     VkSemaphoreSubmitInfo present_semaphore_submit_info = {};
     present_semaphore_submit_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
     present_semaphore_submit_info.semaphore = frame.present_semaphore;
@@ -408,16 +655,28 @@ Engine::start_frame(VkCommandBuffer &out_cmd_buffer, uint32_t &swapchain_image_i
 
     VkSubmitInfo2 submit_info = {};
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
-    submit_info.waitSemaphoreInfoCount = 1;
-    submit_info.pWaitSemaphoreInfos = &render_semaphore_submit_info;
     submit_info.commandBufferInfoCount = 1;
     submit_info.pCommandBufferInfos = &cmd_buffer_submit_info;
-    submit_info.signalSemaphoreInfoCount = 1;
-    submit_info.pSignalSemaphoreInfos = &present_semaphore_submit_info;
-    VKERR(
-        vkQueueSubmit2(m_graphics_queue, 1, &submit_info, frame.fence),
-        "Engine::render_frame: failed to submit render commands"
-    );
+    submit_info.waitSemaphoreInfoCount = wait_semaphore_count;
+    submit_info.pWaitSemaphoreInfos = wait_semaphore_infos.data();
+    if (!is_headless())
+    {
+        submit_info.signalSemaphoreInfoCount = 1;
+        submit_info.pSignalSemaphoreInfos = &present_semaphore_submit_info;
+    }
+    {
+        CPU_ZONE("vkQueueSubmit2");
+        VKERR(
+            vkQueueSubmit2(m_graphics_queue, 1, &submit_info, frame.fence),
+            "Engine::render_frame: failed to submit render commands"
+        );
+    }
+
+    if (is_headless())
+    {
+        m_frame_idx = (m_frame_idx + 1) % NUM_FRAMES_IN_FLIGHT;
+        return true;
+    }
 
     VkPresentInfoKHR present_info = {};
     present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -427,7 +686,11 @@ Engine::start_frame(VkCommandBuffer &out_cmd_buffer, uint32_t &swapchain_image_i
     present_info.pSwapchains = &m_swapchain.swapchain;
     present_info.pImageIndices = &swapchain_image_idx;
 
-    VkResult present_res = vkQueuePresentKHR(m_graphics_queue, &present_info);
+    VkResult present_res;
+    {
+        CPU_ZONE("vkQueuePresentKHR");
+        present_res = vkQueuePresentKHR(m_graphics_queue, &present_info);
+    }
     if (present_res != VK_SUCCESS)
     {
         if (!refresh_swapchain())
@@ -442,8 +705,23 @@ Engine::start_frame(VkCommandBuffer &out_cmd_buffer, uint32_t &swapchain_image_i
     return true;
 }
 
+[[nodiscard]] bool Engine::wait_idle()
+{
+    VKERR(vkDeviceWaitIdle(m_device), "Engine::wait_idle: failed to wait for device");
+
+    if (!m_gpu_profiler.resolve_all())
+    {
+        spdlog::error("Engine::wait_idle: failed to resolve gpu profiler results");
+        return false;
+    }
+
+    return true;
+}
+
 [[nodiscard]] bool Engine::immediate_submit(std::function<void(VkCommandBuffer)> f)
 {
+    CPU_ZONE("Engine::immediate_submit");
+
     VKERR(
         vkResetFences(m_device, 1, &m_immediate_commands.fence),
         "Engine::immediate_submit: failed to reset fence"
@@ -481,34 +759,38 @@ Engine::start_frame(VkCommandBuffer &out_cmd_buffer, uint32_t &swapchain_image_i
         "Engine::immediate_submit: failed to submit command buffer"
     );
 
-    VKERR(
-        vkWaitForFences(
-            m_device,
-            1,
-            &m_immediate_commands.fence,
-            VK_TRUE,
-            std::numeric_limits<uint64_t>::max()
-        ),
-        "Engine::immediate_submit: failed to wait for fence"
-    );
+    {
+        CPU_ZONE("wait immediate fence");
+        VKERR(
+            vkWaitForFences(
+                m_device,
+                1,
+                &m_immediate_commands.fence,
+                VK_TRUE,
+                std::numeric_limits<uint64_t>::max()
+            ),
+            "Engine::immediate_submit: failed to wait for fence"
+        );
+    }
 
     return true;
 }
 
 [[nodiscard]] bool Engine::create_image(
-    VmaMemoryUsage memory_usage, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage,
-    VkImageAspectFlags aspect_mask, GPUImage &out_image
+    VmaMemoryUsage memory_usage, VkFormat format, VkExtent3D extent, uint32_t mip_levels,
+    VkImageUsageFlags usage, VkImageAspectFlags aspect_mask, GPUImage &out_image
 )
 {
     out_image.format = format;
     out_image.extent = extent;
+    out_image.mip_levels = mip_levels;
 
     VkImageCreateInfo image_info = {};
     image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     image_info.imageType = VK_IMAGE_TYPE_2D;
     image_info.format = format;
     image_info.extent = extent;
-    image_info.mipLevels = 1;
+    image_info.mipLevels = mip_levels;
     image_info.arrayLayers = 1;
     image_info.samples = VK_SAMPLE_COUNT_1_BIT;
     image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -536,7 +818,7 @@ Engine::start_frame(VkCommandBuffer &out_cmd_buffer, uint32_t &swapchain_image_i
     view_info.format = format;
     view_info.subresourceRange.aspectMask = aspect_mask;
     view_info.subresourceRange.baseMipLevel = 0;
-    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.levelCount = mip_levels;
     view_info.subresourceRange.baseArrayLayer = 0;
     view_info.subresourceRange.layerCount = 1;
 
@@ -554,97 +836,46 @@ Engine::start_frame(VkCommandBuffer &out_cmd_buffer, uint32_t &swapchain_image_i
     return true;
 }
 
-[[nodiscard]] bool Engine::create_image_from_file(
-    [[maybe_unused]] const std::string &path, [[maybe_unused]] GPUImage &out_image
-)
+[[nodiscard]] bool Engine::create_image_from_file(const std::string &path, GPUImage &out_image)
 {
-    int channels = 4;
-    int width, height;
-    stbi_uc *image_data = stbi_load(path.c_str(), &width, &height, nullptr, channels);
-    if (image_data == nullptr)
+    CPU_ZONE("Engine::create_image_from_file");
+
+    DecodedImage image;
+    if (!decode_image_file(path, image))
     {
         spdlog::error("Engine::create_image_from_file: failed to load image data from file");
         return false;
     }
-    VkExtent3D extent{
-        .width = static_cast<uint32_t>(width),
-        .height = static_cast<uint32_t>(height),
-        .depth = 1,
-    };
+
+    return create_image_from_decoded(image, out_image);
+}
+
+[[nodiscard]] bool
+Engine::create_image_from_decoded(const DecodedImage &image, GPUImage &out_image)
+{
+    CPU_ZONE("Engine::create_image_from_decoded");
 
     if (!create_image(
             VMA_MEMORY_USAGE_GPU_ONLY,
-            VK_FORMAT_R8G8B8A8_SRGB,
-            extent,
+            image.format,
+            image.extent,
+            static_cast<uint32_t>(image.mip_offsets.size()),
             VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
             VK_IMAGE_ASPECT_COLOR_BIT,
             out_image
         ))
     {
-        spdlog::error("Engine::create_image_from_file: failed to create gpu image");
-        stbi_image_free(image_data);
+        spdlog::error("Engine::create_image_from_decoded: failed to create gpu image");
         return false;
     }
 
-    GPUBuffer transfer_buffer;
-    if (!create_buffer(
-            VMA_MEMORY_USAGE_CPU_TO_GPU,
-            width * height * channels,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            transfer_buffer
-        ))
+    if (!m_upload_manager.upload_image(out_image, image.data, image.mip_offsets))
     {
-        stbi_image_free(image_data);
         destroy_image(out_image);
-        spdlog::error("Engine::create_image: failed to allocate transfer buffer");
+        spdlog::error("Engine::create_image_from_decoded: failed to upload image data");
         return false;
     }
 
-    std::memcpy(transfer_buffer.allocation_info.pMappedData, image_data, width * height * channels);
-
-    bool upload_success = immediate_submit([&](VkCommandBuffer cmd_buffer) {
-        transition_image(
-            cmd_buffer,
-            out_image.image,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-        );
-        VkBufferImageCopy region = {};
-        region.imageSubresource = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .mipLevel = 0,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-        };
-        region.imageExtent = extent;
-        vkCmdCopyBufferToImage(
-            cmd_buffer,
-            transfer_buffer.buffer,
-            out_image.image,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &region
-        );
-        transition_image(
-            cmd_buffer,
-            out_image.image,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL
-        );
-    });
-    if (!upload_success)
-    {
-        destroy_image(out_image);
-        destroy_buffer(transfer_buffer);
-        stbi_image_free(image_data);
-
-        spdlog::error("Engine::create_image_from_file: failed to transfer image data");
-        return false;
-    }
-
-    destroy_buffer(transfer_buffer);
-    stbi_image_free(image_data);
-
     return true;
 }
 
@@ -688,6 +919,24 @@ void Engine::destroy_buffer(GPUBuffer &buffer)
     vmaDestroyBuffer(m_allocator, buffer.buffer, buffer.allocation);
 }
 
+VkDeviceAddress Engine::get_buffer_address(const GPUBuffer &buffer)
+{
+    VkBufferDeviceAddressInfo address_info = {};
+    address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    address_info.buffer = buffer.buffer;
+    return vkGetBufferDeviceAddress(m_device, &address_info);
+}
+
+[[nodiscard]] bool Engine::invalidate_buffer(const GPUBuffer &buffer)
+{
+    VKERR(
+        vmaInvalidateAllocation(m_allocator, buffer.allocation, 0, VK_WHOLE_SIZE),
+        "Engine::invalidate_buffer: failed to invalidate buffer"
+    );
+
+    return true;
+}
+
 VkBool32 Engine::debug_message_callback(
     VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type,
     const VkDebugUtilsMessengerCallbackDataEXT *cb_data, [[maybe_unused]] void *user_data
@@ -734,9 +983,9 @@ void transition_image(
     VkCommandBuffer cmd_buffer, VkImage image, VkImageLayout src_layout, VkImageLayout dst_layout
 )
 {
-    VkImageAspectFlags aspect_mask = (dst_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL)
-                                         ? VK_IMAGE_ASPECT_DEPTH_BIT
-                                         : VK_IMAGE_ASPECT_COLOR_BIT;
+    bool depth = dst_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL ||
+                 dst_layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+    VkImageAspectFlags aspect_mask = depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
 
     VkImageMemoryBarrier2 image_barrier = {};
     image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
@@ -757,6 +1006,82 @@ void transition_image(
     vkCmdPipelineBarrier2(cmd_buffer, &dep_info);
 }
 
+void memory_barrier(
+    VkCommandBuffer cmd_buffer, VkPipelineStageFlags2 src_stage, VkAccessFlags2 src_access,
+    VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access
+)
+{
+    VkMemoryBarrier2 barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = src_stage;
+    barrier.srcAccessMask = src_access;
+    barrier.dstStageMask = dst_stage;
+    barrier.dstAccessMask = dst_access;
+
+    VkDependencyInfo dep_info = {};
+    dep_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dep_info.memoryBarrierCount = 1;
+    dep_info.pMemoryBarriers = &barrier;
+    vkCmdPipelineBarrier2(cmd_buffer, &dep_info);
+}
+
+// Takes ownership of `texels` as returned by stb_image and builds the full mip chain from them.
+static void finish_decode(stbi_uc *texels, int width, int height, DecodedImage &out_image)
+{
+    out_image.extent = VkExtent3D{
+        .width = static_cast<uint32_t>(width),
+        .height = static_cast<uint32_t>(height),
+        .depth = 1,
+    };
+
+    size_t size = static_cast<size_t>(width) * height * 4;
+    out_image.data.resize(size);
+    std::memcpy(out_image.data.data(), texels, size);
+    stbi_image_free(texels);
+
+    out_image.format = VK_FORMAT_R8G8B8A8_SRGB;
+    generate_mip_chain(out_image.extent, true, out_image.data, out_image.mip_offsets);
+}
+
+[[nodiscard]] bool decode_image_file(const std::string &path, DecodedImage &out_image)
+{
+    CPU_ZONE("decode_image_file");
+
+    int width, height;
+    stbi_uc *texels = stbi_load(path.c_str(), &width, &height, nullptr, 4);
+    if (texels == nullptr)
+    {
+        spdlog::error("decode_image_file: failed to decode {}: {}", path, stbi_failure_reason());
+        return false;
+    }
+    finish_decode(texels, width, height, out_image);
+
+    return true;
+}
+
+[[nodiscard]] bool decode_image_memory(std::span<const uint8_t> encoded, DecodedImage &out_image)
+{
+    CPU_ZONE("decode_image_memory");
+
+    int width, height;
+    stbi_uc *texels = stbi_load_from_memory(
+        encoded.data(),
+        static_cast<int>(encoded.size()),
+        &width,
+        &height,
+        nullptr,
+        4
+    );
+    if (texels == nullptr)
+    {
+        spdlog::error("decode_image_memory: failed to decode image: {}", stbi_failure_reason());
+        return false;
+    }
+    finish_decode(texels, width, height, out_image);
+
+    return true;
+}
+
 VkImageSubresourceRange full_image_range(VkImageAspectFlags aspect_mask)
 {
     return VkImageSubresourceRange{
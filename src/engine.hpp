@@ -1,9 +1,13 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <functional>
 #include <glm/trigonometric.hpp>
+#include <span>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <SDL3/SDL_video.h>
 
@@ -11,9 +15,26 @@
 #include <vulkan/vulkan_core.h>
 
 #include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 
+#include "asset_archive.hpp"
 #include "deletion_queue.hpp"
+#include "geometry_buffer.hpp"
 #include "gpu.hpp"
+#include "gpu_profiler.hpp"
+#include "image_data.hpp"
+#include "thread_pool.hpp"
+#include "upload_manager.hpp"
+
+// Secondary command buffers of one recording slot, see `Engine::get_secondary_command_buffer`.
+struct SecondaryCommands
+{
+    VkCommandPool cmd_pool;
+    std::vector<VkCommandBuffer> cmd_buffers;
+    // Buffers handed out in the current frame, the rest are free for reuse.
+    size_t used_count{0};
+};
 
 struct FrameData
 {
@@ -23,6 +44,12 @@ struct FrameData
     VkSemaphore present_semaphore;
     VkFence fence;
 
+    uint32_t gpu_frame_scope;
+    uint64_t upload_wait_value{0};
+
+    // One per recording slot, their pools are reset when the frame is started.
+    std::vector<SecondaryCommands> secondary_commands;
+
     DeletionQueue deletion_queue;
 };
 
@@ -30,8 +57,58 @@ struct ForwardPushConstants
 {
     glm::mat4 camera;
     VkDeviceAddress vertex_buffer_address;
+    VkDeviceAddress material_buffer_address;
+    VkDeviceAddress object_buffer_address;
 };
 
+// Exactly the 128 bytes every device is guaranteed to support. The far plane is the near plane
+// facing the other way, so only its distance is stored. Everything else lives in `CullData`.
+struct CullPushConstants
+{
+    std::array<glm::vec4, 5> frustum_planes;
+    float far_plane_distance;
+    float lod_scale;
+    VkDeviceAddress cull_data_address;
+    glm::vec3 camera_position;
+    uint32_t meshlet_count;
+    VkDeviceAddress meshlet_buffer_address;
+    VkDeviceAddress draw_buffer_address;
+};
+static_assert(sizeof(CullPushConstants) == 128);
+
+// Counted by the cull pass over all of its phases in a frame.
+struct CullStatistics
+{
+    // Objects with at least one meshlet of their selected level of detail in the frustum, and
+    // those of them with at least one meshlet that is neither back-facing nor occluded.
+    uint32_t frustum_object_count;
+    uint32_t visible_object_count;
+    // Meshlets drawn because they were visible in the previous frame, or drawn after the
+    // occlusion test because they just became visible.
+    uint32_t first_phase_meshlet_count;
+    uint32_t second_phase_meshlet_count;
+    uint32_t occluded_meshlet_count;
+};
+
+// Per-frame data of the cull pass, laid out as `CullData` in cull.comp (std430) and written with
+// vkCmdUpdateBuffer before the first phase, which also resets the statistics.
+struct CullData
+{
+    glm::mat4 view;
+    // Elements [0][0], [1][1], [2][2] and [3][2] of the projection matrix.
+    glm::vec4 projection;
+    float z_near;
+    uint32_t depth_width;
+    uint32_t depth_height;
+    uint32_t pyramid_level_count;
+    // Whether each meshlet was visible in the last frame, followed by the flags of each object
+    // counted in `statistics`.
+    VkDeviceAddress meshlet_visibility_address;
+    VkDeviceAddress object_visibility_address;
+    CullStatistics statistics;
+};
+static_assert(offsetof(CullData, statistics) == 112);
+
 struct Swapchain
 {
     uint64_t generation{0};
@@ -44,27 +121,43 @@ struct Swapchain
 
 class Engine
 {
+  public:
     static constexpr size_t NUM_FRAMES_IN_FLIGHT = 2;
 
+  private:
     SDL_Window *m_window;
+    VkExtent2D m_headless_extent;
+    std::string m_archive_path;
 
     VkInstance m_instance{VK_NULL_HANDLE};
     VkDebugUtilsMessengerEXT m_debug_messenger{VK_NULL_HANDLE};
     VkSurfaceKHR m_surface{VK_NULL_HANDLE};
     VkPhysicalDevice m_physical_device{VK_NULL_HANDLE};
+    std::string m_device_name;
+    float m_max_sampler_anisotropy{1.0f};
+    uint32_t m_max_bindless_textures{0};
+    bool m_inherited_queries{false};
     VkDevice m_device{VK_NULL_HANDLE};
     Swapchain m_swapchain;
 
     VkQueue m_graphics_queue{VK_NULL_HANDLE};
     uint32_t m_graphics_queue_family{0};
 
+    VkQueue m_transfer_queue{VK_NULL_HANDLE};
+    uint32_t m_transfer_queue_family{0};
+
     VmaAllocator m_allocator;
 
     VkDescriptorPool m_descriptor_pool;
 
     size_t m_frame_idx{0};
+    uint64_t m_frame_number{0};
     std::array<FrameData, NUM_FRAMES_IN_FLIGHT> m_frames;
 
+    GPUProfiler m_gpu_profiler;
+    ThreadPool m_thread_pool;
+    AssetArchive m_asset_archive;
+
     DeletionQueue m_deletion_queue;
     struct
     {
@@ -73,6 +166,9 @@ class Engine
         VkFence fence;
     } m_immediate_commands;
 
+    UploadManager m_upload_manager;
+    GeometryBuffer m_geometry_buffer;
+
     Engine(const Engine &) = delete;
     Engine &operator=(const Engine &) = delete;
     Engine(Engine &&) = delete;
@@ -85,7 +181,17 @@ class Engine
         const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData, void *pUserData
     );
 
-    explicit Engine(SDL_Window *window) : m_window(window)
+    // A null `window` runs the engine headless: no surface or swapchain is created and frames
+    // are rendered at `headless_extent` without being presented. Assets are served from the
+    // archive at `archive_path` if it exists and from loose files otherwise. All meshes are
+    // stored in `vertex_format`.
+    Engine(
+        SDL_Window *window, VkExtent2D headless_extent, std::string archive_path,
+        VertexFormat vertex_format
+    )
+        : m_window(window), m_headless_extent(headless_extent),
+          m_archive_path(std::move(archive_path)), m_upload_manager(*this),
+          m_geometry_buffer(*this, vertex_format)
     {
     }
 
@@ -96,6 +202,83 @@ class Engine
         return m_window;
     }
 
+    bool is_headless() const
+    {
+        return m_window == nullptr;
+    }
+
+    VkExtent2D get_render_extent() const
+    {
+        return is_headless() ? m_headless_extent : m_swapchain.extent;
+    }
+
+    const std::string &get_device_name() const
+    {
+        return m_device_name;
+    }
+
+    float get_max_sampler_anisotropy() const
+    {
+        return m_max_sampler_anisotropy;
+    }
+
+    // Largest number of combined image samplers an update-after-bind descriptor array visible
+    // to a single shader stage may hold.
+    uint32_t get_max_bindless_textures() const
+    {
+        return m_max_bindless_textures;
+    }
+
+    // Whether secondary command buffers may be executed while a query is active.
+    bool has_inherited_queries() const
+    {
+        return m_inherited_queries;
+    }
+
+    uint64_t get_frame_number() const
+    {
+        return m_frame_number;
+    }
+
+    // Slot of the frame being recorded, below `NUM_FRAMES_IN_FLIGHT`. Work submitted with the
+    // previous frame of the same slot has completed once `start_frame` returns.
+    size_t get_frame_index() const
+    {
+        return m_frame_idx;
+    }
+
+    GPUProfiler &get_gpu_profiler()
+    {
+        return m_gpu_profiler;
+    }
+
+    UploadManager &get_upload_manager()
+    {
+        return m_upload_manager;
+    }
+
+    GeometryBuffer &get_geometry_buffer()
+    {
+        return m_geometry_buffer;
+    }
+
+    ThreadPool &get_thread_pool()
+    {
+        return m_thread_pool;
+    }
+
+    // Number of threads that can record secondary command buffers at the same time, one per
+    // worker of the thread pool.
+    size_t get_recording_slot_count() const
+    {
+        return m_frames[m_frame_idx].secondary_commands.size();
+    }
+
+    const AssetArchive &get_asset_archive() const
+    {
+        return m_asset_archive;
+    }
+
     VkInstance get_instance()
     {
         return m_instance;
@@ -126,6 +309,16 @@ class Engine
         return m_graphics_queue_family;
     }
 
+    VkQueue get_transfer_queue()
+    {
+        return m_transfer_queue;
+    }
+
+    uint32_t get_transfer_queue_family()
+    {
+        return m_transfer_queue_family;
+    }
+
     VkDescriptorPool get_descriptor_pool()
     {
         return m_descriptor_pool;
@@ -138,11 +331,19 @@ class Engine
     [[nodiscard]] bool start_frame(VkCommandBuffer &out_cmd_buffer, uint32_t &swapchain_image_idx);
     [[nodiscard]] bool finish_frame(uint32_t swapchain_image_idx);
 
+    // Hands out a secondary command buffer of the current frame from the command pool of `slot`.
+    // Each slot must only be used by one thread at a time. The buffer is reset when this frame
+    // slot is started again.
+    [[nodiscard]] bool get_secondary_command_buffer(size_t slot, VkCommandBuffer &out_cmd_buffer);
+
+    [[nodiscard]] bool wait_idle();
+
     [[nodiscard]] bool create_image(
-        VmaMemoryUsage memory_usage, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage,
-        VkImageAspectFlags aspect_mask, GPUImage &out_image
+        VmaMemoryUsage memory_usage, VkFormat format, VkExtent3D extent, uint32_t mip_levels,
+        VkImageUsageFlags usage, VkImageAspectFlags aspect_mask, GPUImage &out_image
     );
     [[nodiscard]] bool create_image_from_file(const std::string &path, GPUImage &out_image);
+    [[nodiscard]] bool create_image_from_decoded(const DecodedImage &image, GPUImage &out_image);
     void destroy_image(GPUImage &image);
 
     [[nodiscard]] bool create_buffer(
@@ -150,6 +351,9 @@ class Engine
         GPUBuffer &out_buffer
     );
     void destroy_buffer(GPUBuffer &buffer);
+    VkDeviceAddress get_buffer_address(const GPUBuffer &buffer);
+    // Makes device writes to a host visible buffer visible to the host.
+    [[nodiscard]] bool invalidate_buffer(const GPUBuffer &buffer);
 
     [[nodiscard]] bool immediate_submit(std::function<void(VkCommandBuffer)> f);
 
@@ -157,12 +361,21 @@ class Engine
     [[nodiscard]] bool init_swapchain();
 };
 
+// Safe to call from any thread.
+[[nodiscard]] bool decode_image_file(const std::string &path, DecodedImage &out_image);
+[[nodiscard]] bool decode_image_memory(std::span<const uint8_t> encoded, DecodedImage &out_image);
+
 VkImageSubresourceRange full_image_range(VkImageAspectFlags aspect_mask);
 
 void transition_image(
     VkCommandBuffer cmd_buffer, VkImage image, VkImageLayout src_layout, VkImageLayout dst_layout
 );
 
+void memory_barrier(
+    VkCommandBuffer cmd_buffer, VkPipelineStageFlags2 src_stage, VkAccessFlags2 src_access,
+    VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access
+);
+
 void blit_image(
     VkCommandBuffer cmd_buffer, VkImage src_image, VkExtent3D src_extent, VkImage dst_image,
     VkExtent3D dst_extent
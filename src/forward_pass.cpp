@@ -1,12 +1,17 @@
 #include "forward_pass.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+
 #include <spdlog/spdlog.h>
 
+#include "cpu_profiler.hpp"
 #include "engine.hpp"
-#include "read_file.hpp"
 #include "vkerr.hpp"
 
-[[nodiscard]] bool ForwardPass::init()
+[[nodiscard]] bool ForwardPass::init(VkDescriptorSetLayout texture_set_layout)
 {
     spdlog::trace("ForwardPass::init: initializing forward render pass");
 
@@ -17,10 +22,11 @@
             VMA_MEMORY_USAGE_GPU_ONLY,
             VK_FORMAT_R16G16B16A16_SFLOAT,
             VkExtent3D{
-                .width = m_engine.get_swapchain().extent.width,
-                .height = m_engine.get_swapchain().extent.height,
+                .width = m_engine.get_render_extent().width,
+                .height = m_engine.get_render_extent().height,
                 .depth = 1,
             },
+            1,
             render_target_usage,
             VK_IMAGE_ASPECT_COLOR_BIT,
             m_render_target
@@ -32,16 +38,19 @@
     m_deletion_queue.add([this] { m_engine.destroy_image(m_render_target); });
     spdlog::trace("ForwardPass::init: created render color target");
 
-    VkImageUsageFlags depth_target_usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    // Sampled to build the depth pyramid for occlusion culling.
+    VkImageUsageFlags depth_target_usage =
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
     if (!m_engine.create_image(
 
             VMA_MEMORY_USAGE_GPU_ONLY,
             VK_FORMAT_D32_SFLOAT,
             VkExtent3D{
-                .width = m_engine.get_swapchain().extent.width,
-                .height = m_engine.get_swapchain().extent.height,
+                .width = m_engine.get_render_extent().width,
+                .height = m_engine.get_render_extent().height,
                 .depth = 1,
             },
+            1,
             depth_target_usage,
             VK_IMAGE_ASPECT_DEPTH_BIT,
             m_depth_target
@@ -53,39 +62,15 @@
     m_deletion_queue.add([this] { m_engine.destroy_image(m_depth_target); });
     spdlog::trace("ForwardPass::init: created render depth target");
 
-    VkDescriptorSetLayoutBinding diffuse_binding = {};
-    diffuse_binding.binding = 0;
-    diffuse_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    diffuse_binding.descriptorCount = 1;
-    diffuse_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    VkDescriptorSetLayoutCreateInfo set_layout_info = {};
-    set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    set_layout_info.bindingCount = 1;
-    set_layout_info.pBindings = &diffuse_binding;
-    VKERR(
-        vkCreateDescriptorSetLayout(
-            m_engine.get_device(),
-            &set_layout_info,
-            nullptr,
-            &m_set_layout
-        ),
-        "ForwardPass::init: failed to create descriptor set layout"
-    );
-    m_deletion_queue.add([this] {
-        vkDestroyDescriptorSetLayout(m_engine.get_device(), m_set_layout, nullptr);
-    });
-    spdlog::trace("ForwardPass::init: created descriptor set layout");
-
     VkPushConstantRange push_constant_range{
-        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
         .offset = 0,
         .size = sizeof(ForwardPushConstants),
     };
     VkPipelineLayoutCreateInfo layout_info = {};
     layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     layout_info.setLayoutCount = 1;
-    layout_info.pSetLayouts = &m_set_layout;
+    layout_info.pSetLayouts = &texture_set_layout;
     layout_info.pushConstantRangeCount = 1;
     layout_info.pPushConstantRanges = &push_constant_range;
     VKERR(
@@ -97,43 +82,97 @@
     });
     spdlog::trace("ForwardPass::init: created pipeline layout");
 
-    std::vector<uint8_t> vertex_code = read_file("../shaders/forward.vert.bin");
-    std::vector<uint8_t> fragment_code = read_file("../shaders/forward.frag.bin");
-    spdlog::trace("ForwardPass::init: read vertex and fragment shader");
+    VkShaderModule vertex_shader, fragment_shader, overdraw_shader;
+    if (!load_shader("../shaders/forward.vert.bin", vertex_shader) ||
+        !load_shader("../shaders/forward.frag.bin", fragment_shader) ||
+        !load_shader("../shaders/overdraw.frag.bin", overdraw_shader))
+    {
+        spdlog::error("ForwardPass::init: failed to load shaders");
+        return false;
+    }
+    spdlog::trace("ForwardPass::init: created shader modules");
+
+    if (!create_pipeline(vertex_shader, fragment_shader, false, m_pipeline) ||
+        !create_pipeline(vertex_shader, VK_NULL_HANDLE, false, m_depth_pipeline) ||
+        !create_pipeline(vertex_shader, overdraw_shader, true, m_overdraw_pipeline))
+    {
+        spdlog::error("ForwardPass::init: failed to create pipelines");
+        return false;
+    }
+    spdlog::trace("ForwardPass::init: created graphics pipelines");
 
-    VkShaderModule vertex_shader;
-    VkShaderModuleCreateInfo vertex_info = {};
-    vertex_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    vertex_info.codeSize = vertex_code.size();
-    vertex_info.pCode = reinterpret_cast<uint32_t *>(vertex_code.data());
+    spdlog::trace("ForwardPass::init: initializion complete");
+
+    return true;
+}
+
+[[nodiscard]] bool ForwardPass::load_shader(const std::string &path, VkShaderModule &out_shader)
+{
+    AssetData code;
+    if (!m_engine.get_asset_archive().load(path, code))
+    {
+        spdlog::error("ForwardPass::load_shader: failed to load {}", path);
+        return false;
+    }
+
+    VkShaderModuleCreateInfo shader_info = {};
+    shader_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shader_info.codeSize = code.data.size();
+    shader_info.pCode = reinterpret_cast<const uint32_t *>(code.data.data());
     VKERR(
-        vkCreateShaderModule(m_engine.get_device(), &vertex_info, nullptr, &vertex_shader),
-        "ForwardPass::init: failed to create vertex shader module"
+        vkCreateShaderModule(m_engine.get_device(), &shader_info, nullptr, &out_shader),
+        "ForwardPass::load_shader: failed to create shader module"
     );
-    m_deletion_queue.add([this, vertex_shader] {
-        vkDestroyShaderModule(m_engine.get_device(), vertex_shader, nullptr);
+    m_deletion_queue.add([this, out_shader] {
+        vkDestroyShaderModule(m_engine.get_device(), out_shader, nullptr);
     });
-    spdlog::trace("ForwardPass::init: created vertex shader module");
+
+    return true;
+}
+
+[[nodiscard]] bool ForwardPass::create_pipeline(
+    VkShaderModule vertex_shader, VkShaderModule fragment_shader, bool additive_blending,
+    VkPipeline &out_pipeline
+)
+{
+    bool depth_only = fragment_shader == VK_NULL_HANDLE;
+
+    // Selects how forward.vert decodes vertices from the geometry buffer and whether it
+    // produces anything but the position.
+    struct VertexSpecialization
+    {
+        VkBool32 quantized_vertices;
+        VkBool32 position_only;
+    } vertex_specialization_data{
+        .quantized_vertices =
+            m_engine.get_geometry_buffer().get_vertex_format() == VertexFormat::Quantized,
+        .position_only = depth_only,
+    };
+    std::array vertex_specialization_entries{
+        VkSpecializationMapEntry{
+            .constantID = 0,
+            .offset = offsetof(VertexSpecialization, quantized_vertices),
+            .size = sizeof(VkBool32),
+        },
+        VkSpecializationMapEntry{
+            .constantID = 1,
+            .offset = offsetof(VertexSpecialization, position_only),
+            .size = sizeof(VkBool32),
+        },
+    };
+    VkSpecializationInfo vertex_specialization{
+        .mapEntryCount = static_cast<uint32_t>(vertex_specialization_entries.size()),
+        .pMapEntries = vertex_specialization_entries.data(),
+        .dataSize = sizeof(VertexSpecialization),
+        .pData = &vertex_specialization_data,
+    };
 
     VkPipelineShaderStageCreateInfo vertex_stage = {};
     vertex_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertex_stage.stage = VK_SHADER_STAGE_VERTEX_BIT;
     vertex_stage.module = vertex_shader;
     vertex_stage.pName = "main";
-
-    VkShaderModule fragment_shader;
-    VkShaderModuleCreateInfo fragment_info = {};
-    fragment_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    fragment_info.codeSize = fragment_code.size();
-    fragment_info.pCode = reinterpret_cast<uint32_t *>(fragment_code.data());
-    VKERR(
-        vkCreateShaderModule(m_engine.get_device(), &fragment_info, nullptr, &fragment_shader),
-        "ForwardPass::init: failed to create fragment shader module"
-    );
-    m_deletion_queue.add([this, fragment_shader] {
-        vkDestroyShaderModule(m_engine.get_device(), fragment_shader, nullptr);
-    });
-    spdlog::trace("ForwardPass::init: created fragment shader module");
+    vertex_stage.pSpecializationInfo = &vertex_specialization;
 
     VkPipelineShaderStageCreateInfo fragment_stage = {};
     fragment_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -166,11 +205,10 @@
     multisample_state.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
     multisample_state.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
+    // Depth writes and the compare op are set in `render` depending on the pre-pass.
     VkPipelineDepthStencilStateCreateInfo depth_stencil_state = {};
     depth_stencil_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
     depth_stencil_state.depthTestEnable = VK_TRUE;
-    depth_stencil_state.depthWriteEnable = VK_TRUE;
-    depth_stencil_state.depthCompareOp = VK_COMPARE_OP_LESS;
 
     VkPipelineColorBlendAttachmentState color_blend_attachment_state{
         .blendEnable = VK_TRUE,
@@ -183,13 +221,31 @@
         .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
                           VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
     };
+    if (additive_blending)
+    {
+        color_blend_attachment_state.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        color_blend_attachment_state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        color_blend_attachment_state.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    }
+    if (depth_only)
+    {
+        // The depth pipeline is used within the same rendering as the main pass, so it keeps
+        // the color attachment but never writes to it.
+        color_blend_attachment_state.blendEnable = VK_FALSE;
+        color_blend_attachment_state.colorWriteMask = 0;
+    }
 
     VkPipelineColorBlendStateCreateInfo color_blend_state = {};
     color_blend_state.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     color_blend_state.attachmentCount = 1;
     color_blend_state.pAttachments = &color_blend_attachment_state;
 
-    std::array dynamic_states{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    std::array dynamic_states{
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+        VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
+        VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
+    };
 
     VkPipelineDynamicStateCreateInfo dynamic_state = {};
     dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -205,7 +261,7 @@
     VkGraphicsPipelineCreateInfo pipeline_info = {};
     pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipeline_info.pNext = &pipeline_rendering_info;
-    pipeline_info.stageCount = stages.size();
+    pipeline_info.stageCount = depth_only ? 1 : stages.size();
     pipeline_info.pStages = stages.data();
     pipeline_info.pVertexInputState = &vertex_input_state;
     pipeline_info.pInputAssemblyState = &input_assembly_state;
@@ -224,51 +280,65 @@
             1,
             &pipeline_info,
             nullptr,
-            &m_pipeline
+            &out_pipeline
         ),
-        "ForwardPass::init: failed to create pipeline"
+        "ForwardPass::create_pipeline: failed to create pipeline"
     );
-    m_deletion_queue.add([this] { vkDestroyPipeline(m_engine.get_device(), m_pipeline, nullptr); });
-    spdlog::trace("ForwardPass::init: created graphics pipeline");
-
-    spdlog::trace("ForwardPass::init: initializion complete");
+    m_deletion_queue.add([this, out_pipeline] {
+        vkDestroyPipeline(m_engine.get_device(), out_pipeline, nullptr);
+    });
 
     return true;
 }
 
-void ForwardPass::render(VkCommandBuffer cmd_buffer, const Scene &scene)
+void ForwardPass::render(
+    VkCommandBuffer cmd_buffer, const Scene &scene, VkDescriptorSet texture_set,
+    const ForwardSettings &settings, std::span<const DrawItem> draws, bool keep_targets
+)
 {
-    transition_image(
-        cmd_buffer,
-        m_render_target.image,
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_GENERAL
-    );
-    transition_image(
-        cmd_buffer,
-        m_depth_target.image,
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL
-    );
+    if (keep_targets)
+    {
+        memory_barrier(
+            cmd_buffer,
+            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT
+        );
+    }
+    else
+    {
+        transition_image(
+            cmd_buffer,
+            m_render_target.image,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_GENERAL
+        );
+        transition_image(
+            cmd_buffer,
+            m_depth_target.image,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL
+        );
 
-    VkClearColorValue clear_color{
-        .float32 =
-            {
-                scene.background_color[0],
-                scene.background_color[1],
-                scene.background_color[2],
-                1.0f,
-            }
-    };
-    VkImageSubresourceRange clear_range = full_image_range(VK_IMAGE_ASPECT_COLOR_BIT);
-    vkCmdClearColorImage(
-        cmd_buffer,
-        m_render_target.image,
-        VK_IMAGE_LAYOUT_GENERAL,
-        &clear_color,
-        1,
-        &clear_range
-    );
+        // The overdraw view adds up from black.
+        VkClearColorValue clear_color{.float32 = {0.0f, 0.0f, 0.0f, 1.0f}};
+        if (!settings.overdraw_view)
+        {
+            clear_color.float32[0] = scene.background_color[0];
+            clear_color.float32[1] = scene.background_color[1];
+            clear_color.float32[2] = scene.background_color[2];
+        }
+        VkImageSubresourceRange clear_range = full_image_range(VK_IMAGE_ASPECT_COLOR_BIT);
+        vkCmdClearColorImage(
+            cmd_buffer,
+            m_render_target.image,
+            VK_IMAGE_LAYOUT_GENERAL,
+            &clear_color,
+            1,
+            &clear_range
+        );
+    }
 
     VkRenderingAttachmentInfo color_attachment = {};
     color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
@@ -281,7 +351,8 @@ void ForwardPass::render(VkCommandBuffer cmd_buffer, const Scene &scene)
     depth_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
     depth_attachment.imageView = m_depth_target.view;
     depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-    depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depth_attachment.loadOp =
+        keep_targets ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
     depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     depth_attachment.clearValue.depthStencil.depth = 1.0f;
 
@@ -295,8 +366,56 @@ void ForwardPass::render(VkCommandBuffer cmd_buffer, const Scene &scene)
     rendering_info.colorAttachmentCount = 1;
     rendering_info.pColorAttachments = &color_attachment;
     rendering_info.pDepthAttachment = &depth_attachment;
+
+    // The GPU-culled draws are just two indirect draws, only long CPU draw lists are worth
+    // splitting up. Secondary command buffers can only run within the profiler's statistics
+    // query if the device supports inherited queries.
+    bool counting_statistics = m_engine.get_gpu_profiler().is_counting_statistics();
+    size_t task_count = 1;
+    if (settings.parallel_recording && !settings.gpu_culling &&
+        (!counting_statistics || m_engine.has_inherited_queries()))
+    {
+        task_count = std::min(
+            m_engine.get_recording_slot_count(),
+            draws.size() / MIN_DRAWS_PER_TASK
+        );
+    }
+
+    if (task_count > 1)
+    {
+        rendering_info.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+        vkCmdBeginRendering(cmd_buffer, &rendering_info);
+        record_parallel(
+            cmd_buffer,
+            scene,
+            texture_set,
+            settings,
+            draws,
+            task_count,
+            counting_statistics
+        );
+        vkCmdEndRendering(cmd_buffer);
+        return;
+    }
+
     vkCmdBeginRendering(cmd_buffer, &rendering_info);
 
+    // The pipelines of the pre-pass and the main pass share their layout and dynamic state, so
+    // everything but the depth state is only set once.
+    bind_state(cmd_buffer, scene, texture_set);
+    if (settings.depth_prepass)
+    {
+        record_pass(cmd_buffer, scene, settings, true, draws);
+    }
+    record_pass(cmd_buffer, scene, settings, false, draws);
+
+    vkCmdEndRendering(cmd_buffer);
+}
+
+void ForwardPass::bind_state(
+    VkCommandBuffer cmd_buffer, const Scene &scene, VkDescriptorSet texture_set
+)
+{
     VkViewport viewport{
         .x = 0.0f,
         .y = static_cast<float>(m_render_target.extent.height),
@@ -315,39 +434,229 @@ void ForwardPass::render(VkCommandBuffer cmd_buffer, const Scene &scene)
             },
     };
 
-    vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
     vkCmdSetViewport(cmd_buffer, 0, 1, &viewport);
     vkCmdSetScissor(cmd_buffer, 0, 1, &scissor);
 
-    for (const Object &obj : scene.objects)
+    // All meshes live in the engine's geometry buffer and all textures in the asset cache's
+    // texture set, so only the index buffer changes between draws of different index types.
+    const GeometryBuffer &geometry_buffer = m_engine.get_geometry_buffer();
+    ForwardPushConstants push_constants{
+        .camera = scene.camera.get_matrix(),
+        .vertex_buffer_address = geometry_buffer.get_vertex_buffer_address(),
+        .material_buffer_address = scene.material_buffer_address,
+        .object_buffer_address = scene.object_buffer_address,
+    };
+    vkCmdPushConstants(
+        cmd_buffer,
+        m_pipeline_layout,
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        0,
+        sizeof(ForwardPushConstants),
+        &push_constants
+    );
+    vkCmdBindDescriptorSets(
+        cmd_buffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        m_pipeline_layout,
+        0,
+        1,
+        &texture_set,
+        0,
+        nullptr
+    );
+}
+
+void ForwardPass::record_pass(
+    VkCommandBuffer cmd_buffer, const Scene &scene, const ForwardSettings &settings,
+    bool prepass, std::span<const DrawItem> draws
+)
+{
+    if (prepass)
+    {
+        vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_depth_pipeline);
+        vkCmdSetDepthWriteEnable(cmd_buffer, VK_TRUE);
+        vkCmdSetDepthCompareOp(cmd_buffer, VK_COMPARE_OP_LESS);
+        record_draws(cmd_buffer, scene, settings.gpu_culling, draws);
+        return;
+    }
+
+    // After the pre-pass only the closest fragment of each pixel passes, and the depth buffer
+    // already holds the final values.
+    vkCmdBindPipeline(
+        cmd_buffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        settings.overdraw_view ? m_overdraw_pipeline : m_pipeline
+    );
+    vkCmdSetDepthWriteEnable(cmd_buffer, settings.depth_prepass ? VK_FALSE : VK_TRUE);
+    vkCmdSetDepthCompareOp(
+        cmd_buffer,
+        settings.depth_prepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS
+    );
+    record_draws(cmd_buffer, scene, settings.gpu_culling, draws);
+}
+
+void ForwardPass::record_parallel(
+    VkCommandBuffer cmd_buffer, const Scene &scene, VkDescriptorSet texture_set,
+    const ForwardSettings &settings, std::span<const DrawItem> draws, size_t task_count,
+    bool inherit_statistics
+)
+{
+    CPU_ZONE("ForwardPass::record_parallel");
+
+    // Each task records its chunk into one buffer per pass. All pre-pass buffers are executed
+    // before the main pass and the chunks in order, so the draws keep the draw list's order.
+    size_t pass_count = settings.depth_prepass ? 2 : 1;
+    m_secondary_buffers.assign(pass_count * task_count, VK_NULL_HANDLE);
+    std::atomic<bool> failed{false};
+    m_engine.get_thread_pool().run(task_count, [&](size_t task) {
+        CPU_ZONE("record forward draws");
+        size_t first = task * draws.size() / task_count;
+        size_t last = (task + 1) * draws.size() / task_count;
+        for (size_t pass = 0; pass < pass_count; ++pass)
+        {
+            if (!record_secondary(
+                    task,
+                    scene,
+                    texture_set,
+                    settings,
+                    settings.depth_prepass && pass == 0,
+                    draws.subspan(first, last - first),
+                    inherit_statistics,
+                    m_secondary_buffers[pass * task_count + task]
+                ))
+            {
+                failed = true;
+                return;
+            }
+        }
+    });
+
+    // The rendering may only contain secondary command buffers, so nothing is drawn on failure.
+    if (failed)
+    {
+        spdlog::error("ForwardPass::record_parallel: failed to record secondary command buffers");
+        return;
+    }
+    vkCmdExecuteCommands(
+        cmd_buffer,
+        static_cast<uint32_t>(m_secondary_buffers.size()),
+        m_secondary_buffers.data()
+    );
+}
+
+[[nodiscard]] bool ForwardPass::record_secondary(
+    size_t slot, const Scene &scene, VkDescriptorSet texture_set, const ForwardSettings &settings,
+    bool prepass, std::span<const DrawItem> draws, bool inherit_statistics,
+    VkCommandBuffer &out_cmd_buffer
+)
+{
+    if (!m_engine.get_secondary_command_buffer(slot, out_cmd_buffer))
     {
-        const Mesh &mesh = scene.meshes[obj.mesh_idx];
+        spdlog::error("ForwardPass::record_secondary: failed to get command buffer");
+        return false;
+    }
+
+    VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info = {};
+    inheritance_rendering_info.sType =
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    inheritance_rendering_info.colorAttachmentCount = 1;
+    inheritance_rendering_info.pColorAttachmentFormats = &m_render_target.format;
+    inheritance_rendering_info.depthAttachmentFormat = m_depth_target.format;
+    inheritance_rendering_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritance_info = {};
+    inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance_info.pNext = &inheritance_rendering_info;
+    if (inherit_statistics)
+    {
+        inheritance_info.pipelineStatistics = GPUProfiler::PIPELINE_STATISTICS;
+    }
+
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                       VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance_info;
+    VKERR(
+        vkBeginCommandBuffer(out_cmd_buffer, &begin_info),
+        "ForwardPass::record_secondary: failed to begin command buffer"
+    );
+
+    // Secondary command buffers inherit no state from the primary.
+    bind_state(out_cmd_buffer, scene, texture_set);
+    record_pass(out_cmd_buffer, scene, settings, prepass, draws);
 
-        ForwardPushConstants push_constants{
-            .camera = scene.camera.get_matrix(),
-            .vertex_buffer_address = mesh.vertex_buffer_address,
-        };
-        vkCmdBindDescriptorSets(
+    VKERR(
+        vkEndCommandBuffer(out_cmd_buffer),
+        "ForwardPass::record_secondary: failed to end command buffer"
+    );
+
+    return true;
+}
+
+void ForwardPass::record_draws(
+    VkCommandBuffer cmd_buffer, const Scene &scene, bool gpu_culling,
+    std::span<const DrawItem> draws
+)
+{
+    // The vertex shader finds each object's material through the instance index, so nothing
+    // can be drawn before the scene's object buffer is resident.
+    uint64_t available_value = m_engine.get_upload_manager().get_available_value();
+    bool resident = scene.gpu_meshlet_count > 0 && scene.ready_value <= available_value;
+    if (!resident)
+    {
+        return;
+    }
+
+    const GeometryBuffer &geometry_buffer = m_engine.get_geometry_buffer();
+    if (gpu_culling)
+    {
+        // The cull pass writes the draws for each index type into its own half of the buffer.
+        uint32_t max_draw_count = scene.gpu_meshlet_count;
+        std::array<VkIndexType, 2> index_types{VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32};
+        for (uint32_t i = 0; i < index_types.size(); ++i)
+        {
+            vkCmdBindIndexBuffer(
+                cmd_buffer,
+                geometry_buffer.get_index_buffer(index_types[i]).buffer,
+                0,
+                index_types[i]
+            );
+            vkCmdDrawIndexedIndirectCount(
+                cmd_buffer,
+                scene.draw_buffer.buffer,
+                DRAW_COUNTS_SIZE + i * max_draw_count * sizeof(VkDrawIndexedIndirectCommand),
+                scene.draw_buffer.buffer,
+                i * sizeof(uint32_t),
+                max_draw_count,
+                sizeof(VkDrawIndexedIndirectCommand)
+            );
+        }
+        return;
+    }
+
+    // Draws are sorted by index type, so the index buffer is bound at most twice.
+    VkIndexType bound_index_type = VK_INDEX_TYPE_MAX_ENUM;
+    for (const DrawItem &draw : draws)
+    {
+        if (draw.index_type != bound_index_type)
+        {
+            vkCmdBindIndexBuffer(
+                cmd_buffer,
+                geometry_buffer.get_index_buffer(draw.index_type).buffer,
+                0,
+                draw.index_type
+            );
+            bound_index_type = draw.index_type;
+        }
+
+        vkCmdDrawIndexed(
             cmd_buffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            m_pipeline_layout,
-            0,
+            draw.index_count,
             1,
-            &scene.materials[mesh.material_idx].diffuse_set,
-            0,
-            nullptr
+            draw.first_index,
+            draw.vertex_offset,
+            draw.object_index
         );
-        vkCmdPushConstants(
-            cmd_buffer,
-            m_pipeline_layout,
-            VK_SHADER_STAGE_VERTEX_BIT,
-            0,
-            sizeof(ForwardPushConstants),
-            &push_constants
-        );
-        vkCmdBindIndexBuffer(cmd_buffer, mesh.index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdDrawIndexed(cmd_buffer, mesh.index_count, 1, 0, 0, 0);
     }
-
-    vkCmdEndRendering(cmd_buffer);
 }
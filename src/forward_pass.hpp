@@ -1,26 +1,54 @@
 #pragma once
 
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
 #include <vulkan/vulkan_core.h>
 
 #include "deletion_queue.hpp"
+#include "draw_list.hpp"
 #include "gpu.hpp"
 #include "scene.hpp"
 
 class Engine;
 
+struct ForwardSettings
+{
+    bool gpu_culling{false};
+    // Lay down depth with a position-only pipeline first so every pixel is shaded only once.
+    bool depth_prepass{false};
+    // Shade each fragment with a constant that is added up, showing how often pixels are shaded.
+    bool overdraw_view{false};
+    // Record the draws of the CPU draw list on the engine's workers into secondary command
+    // buffers.
+    bool parallel_recording{false};
+};
+
 class ForwardPass
 {
+  public:
+    // Draw lists are only split across workers in chunks of at least this many draws, shorter
+    // ones are recorded faster on the calling thread.
+    static constexpr size_t MIN_DRAWS_PER_TASK = 512;
+
+  private:
     DeletionQueue m_deletion_queue;
 
     Engine &m_engine;
 
-    VkDescriptorSetLayout m_set_layout;
     VkPipelineLayout m_pipeline_layout;
     VkPipeline m_pipeline;
+    VkPipeline m_depth_pipeline;
+    VkPipeline m_overdraw_pipeline;
 
     GPUImage m_render_target;
     GPUImage m_depth_target;
 
+    // Secondary command buffers of the last parallel recording, in order of execution.
+    std::vector<VkCommandBuffer> m_secondary_buffers;
+
     ForwardPass() = delete;
     ForwardPass(const ForwardPass &) = delete;
     ForwardPass &operator=(const ForwardPass &) = delete;
@@ -42,12 +70,59 @@ class ForwardPass
         return m_render_target;
     }
 
-    VkDescriptorSetLayout get_descriptor_set_layout() const
+    const GPUImage &get_depth_image() const
     {
-        return m_set_layout;
+        return m_depth_target;
     }
 
-    [[nodiscard]] bool init();
+    // `texture_set_layout` is the layout of the asset cache's texture set.
+    [[nodiscard]] bool init(VkDescriptorSetLayout texture_set_layout);
+
+    // Draws `draws` in order, or the draws written by the cull pass if `settings.gpu_culling`
+    // is set. With `keep_targets` the draws are added to what the previous call of the frame
+    // rendered instead of clearing the render and depth targets first. With
+    // `settings.parallel_recording` long draw lists are recorded on the engine's thread pool, so
+    // this must not be called from one of its workers.
+    void render(
+        VkCommandBuffer cmd_buffer, const Scene &scene, VkDescriptorSet texture_set,
+        const ForwardSettings &settings, std::span<const DrawItem> draws, bool keep_targets
+    );
+
+  private:
+    [[nodiscard]] bool load_shader(const std::string &path, VkShaderModule &out_shader);
+
+    // Without a fragment shader the pipeline only writes depth and only decodes positions.
+    [[nodiscard]] bool create_pipeline(
+        VkShaderModule vertex_shader, VkShaderModule fragment_shader, bool additive_blending,
+        VkPipeline &out_pipeline
+    );
+
+    // Sets the state shared by the pipelines of the pre-pass and the main pass.
+    void bind_state(VkCommandBuffer cmd_buffer, const Scene &scene, VkDescriptorSet texture_set);
+
+    // Binds the pipeline and depth state of the pre-pass or the main pass and records `draws`.
+    void record_pass(
+        VkCommandBuffer cmd_buffer, const Scene &scene, const ForwardSettings &settings,
+        bool prepass, std::span<const DrawItem> draws
+    );
+
+    // Splits `draws` into `task_count` chunks recorded on the engine's workers and executes
+    // them from `cmd_buffer`, which must be in a rendering begun for secondary command buffers.
+    // `inherit_statistics` must be set while the GPU profiler's statistics query is active.
+    void record_parallel(
+        VkCommandBuffer cmd_buffer, const Scene &scene, VkDescriptorSet texture_set,
+        const ForwardSettings &settings, std::span<const DrawItem> draws, size_t task_count,
+        bool inherit_statistics
+    );
+
+    [[nodiscard]] bool record_secondary(
+        size_t slot, const Scene &scene, VkDescriptorSet texture_set,
+        const ForwardSettings &settings, bool prepass, std::span<const DrawItem> draws,
+        bool inherit_statistics, VkCommandBuffer &out_cmd_buffer
+    );
 
-    void render(VkCommandBuffer cmd_buffer, const Scene &scene);
+    void record_draws(
+        VkCommandBuffer cmd_buffer, const Scene &scene, bool gpu_culling,
+        std::span<const DrawItem> draws
+    );
 };
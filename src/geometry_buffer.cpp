@@ -0,0 +1,137 @@
+#include "geometry_buffer.hpp"
+
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "engine.hpp"
+
+[[nodiscard]] bool GeometryBuffer::init()
+{
+    if (!m_engine.create_buffer(
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            VERTEX_BUFFER_SIZE,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            m_vertex_buffer
+        ))
+    {
+        spdlog::error("GeometryBuffer::init: failed to allocate vertex buffer");
+        return false;
+    }
+    m_deletion_queue.add([&] { m_engine.destroy_buffer(m_vertex_buffer); });
+
+    if (!m_engine.create_buffer(
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            INDEX16_CAPACITY * sizeof(uint16_t),
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            m_index16_buffer
+        ))
+    {
+        spdlog::error("GeometryBuffer::init: failed to allocate 16-bit index buffer");
+        return false;
+    }
+    m_deletion_queue.add([&] { m_engine.destroy_buffer(m_index16_buffer); });
+
+    if (!m_engine.create_buffer(
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            INDEX32_CAPACITY * sizeof(uint32_t),
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            m_index32_buffer
+        ))
+    {
+        spdlog::error("GeometryBuffer::init: failed to allocate 32-bit index buffer");
+        return false;
+    }
+    m_deletion_queue.add([&] { m_engine.destroy_buffer(m_index32_buffer); });
+
+    m_vertex_buffer_address = m_engine.get_buffer_address(m_vertex_buffer);
+
+    m_vertex_ranges.init(VERTEX_BUFFER_SIZE / m_vertex_size);
+    m_index16_ranges.init(INDEX16_CAPACITY);
+    m_index32_ranges.init(INDEX32_CAPACITY);
+
+    return true;
+}
+
+void GeometryBuffer::destroy()
+{
+    m_deletion_queue.delete_all();
+}
+
+[[nodiscard]] bool GeometryBuffer::allocate(
+    std::span<const std::byte> vertices, std::span<const uint32_t> indices,
+    GeometryRange &out_vertices, GeometryRange &out_indices, VkIndexType &out_index_type
+)
+{
+    size_t vertex_count = vertices.size() / m_vertex_size;
+    VkIndexType index_type = vertex_count <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    RangeAllocator &index_ranges = get_index_ranges(index_type);
+
+    uint64_t vertex_offset, index_offset;
+    if (!m_vertex_ranges.allocate(vertex_count, vertex_offset))
+    {
+        spdlog::error(
+            "GeometryBuffer::allocate: vertex arena is full ({} of {} used, {} requested)",
+            m_vertex_ranges.get_used(),
+            m_vertex_ranges.get_capacity(),
+            vertex_count
+        );
+        return false;
+    }
+    if (!index_ranges.allocate(indices.size(), index_offset))
+    {
+        m_vertex_ranges.free(vertex_offset, vertex_count);
+        spdlog::error(
+            "GeometryBuffer::allocate: {}-bit index arena is full ({} of {} used, {} requested)",
+            index_type == VK_INDEX_TYPE_UINT16 ? 16 : 32,
+            index_ranges.get_used(),
+            index_ranges.get_capacity(),
+            indices.size()
+        );
+        return false;
+    }
+
+    GeometryRange vertex_range{
+        .offset = static_cast<uint32_t>(vertex_offset),
+        .count = static_cast<uint32_t>(vertex_count),
+    };
+    GeometryRange index_range{
+        .offset = static_cast<uint32_t>(index_offset),
+        .count = static_cast<uint32_t>(indices.size()),
+    };
+
+    std::vector<uint16_t> narrow_indices;
+    std::span<const std::byte> index_data = std::as_bytes(indices);
+    VkDeviceSize index_size = sizeof(uint32_t);
+    if (index_type == VK_INDEX_TYPE_UINT16)
+    {
+        narrow_indices.assign(indices.begin(), indices.end());
+        index_data = std::as_bytes(std::span(narrow_indices));
+        index_size = sizeof(uint16_t);
+    }
+
+    UploadManager &upload_manager = m_engine.get_upload_manager();
+    if (!upload_manager.upload_buffer(m_vertex_buffer, vertex_offset * m_vertex_size, vertices) ||
+        !upload_manager.upload_buffer(
+            get_index_buffer(index_type),
+            index_offset * index_size,
+            index_data
+        ))
+    {
+        free(vertex_range, index_range, index_type);
+        spdlog::error("GeometryBuffer::allocate: failed to upload vertex and index data");
+        return false;
+    }
+
+    out_vertices = vertex_range;
+    out_indices = index_range;
+    out_index_type = index_type;
+    return true;
+}
+
+void GeometryBuffer::free(GeometryRange vertices, GeometryRange indices, VkIndexType index_type)
+{
+    m_vertex_ranges.free(vertices.offset, vertices.count);
+    get_index_ranges(index_type).free(indices.offset, indices.count);
+}
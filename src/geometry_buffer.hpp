@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include <vulkan/vulkan_core.h>
+
+#include "deletion_queue.hpp"
+#include "gpu.hpp"
+#include "range_allocator.hpp"
+#include "vertex.hpp"
+
+class Engine;
+
+// Range of elements within one of the geometry buffer's arenas.
+struct GeometryRange
+{
+    uint32_t offset{0};
+    uint32_t count{0};
+};
+
+// Device-local vertex and index arenas shared by all meshes. Meshes own ranges inside them and
+// are drawn with `firstIndex` and `vertexOffset` relative to the index buffer binding of their
+// index type and a single vertex buffer address.
+//
+// All vertices are stored in the format chosen at construction. Meshes with at most 65536
+// vertices get 16-bit indices, larger ones 32-bit indices, each type in its own arena.
+class GeometryBuffer
+{
+  public:
+    static constexpr VkDeviceSize VERTEX_BUFFER_SIZE = 128 * 1024 * 1024;
+    static constexpr uint32_t INDEX16_CAPACITY = 16 * 1024 * 1024;
+    static constexpr uint32_t INDEX32_CAPACITY = 8 * 1024 * 1024;
+
+  private:
+    DeletionQueue m_deletion_queue;
+
+    Engine &m_engine;
+    VertexFormat m_vertex_format;
+    size_t m_vertex_size;
+
+    GPUBuffer m_vertex_buffer;
+    GPUBuffer m_index16_buffer;
+    GPUBuffer m_index32_buffer;
+    VkDeviceAddress m_vertex_buffer_address{0};
+
+    RangeAllocator m_vertex_ranges;
+    RangeAllocator m_index16_ranges;
+    RangeAllocator m_index32_ranges;
+
+    GeometryBuffer() = delete;
+    GeometryBuffer(const GeometryBuffer &) = delete;
+    GeometryBuffer &operator=(const GeometryBuffer &) = delete;
+    GeometryBuffer(GeometryBuffer &&) = delete;
+    GeometryBuffer &operator=(GeometryBuffer &&) = delete;
+
+  public:
+    GeometryBuffer(Engine &engine, VertexFormat vertex_format)
+        : m_engine(engine), m_vertex_format(vertex_format),
+          m_vertex_size(get_vertex_size(vertex_format))
+    {
+    }
+
+    [[nodiscard]] bool init();
+    void destroy();
+
+    VertexFormat get_vertex_format() const
+    {
+        return m_vertex_format;
+    }
+
+    const GPUBuffer &get_index_buffer(VkIndexType index_type) const
+    {
+        return index_type == VK_INDEX_TYPE_UINT16 ? m_index16_buffer : m_index32_buffer;
+    }
+
+    VkDeviceAddress get_vertex_buffer_address() const
+    {
+        return m_vertex_buffer_address;
+    }
+
+    uint64_t get_used_bytes() const
+    {
+        return m_vertex_ranges.get_used() * m_vertex_size +
+               m_index16_ranges.get_used() * sizeof(uint16_t) +
+               m_index32_ranges.get_used() * sizeof(uint32_t);
+    }
+
+    uint64_t get_capacity_bytes() const
+    {
+        return m_vertex_ranges.get_capacity() * m_vertex_size +
+               m_index16_ranges.get_capacity() * sizeof(uint16_t) +
+               m_index32_ranges.get_capacity() * sizeof(uint32_t);
+    }
+
+    // Allocates ranges for `vertices`, which must be encoded in the buffer's vertex format, and
+    // `indices` and uploads them through the engine's upload manager. Indices are relative to the
+    // first vertex of `out_vertices` and are stored with `out_index_type`.
+    [[nodiscard]] bool allocate(
+        std::span<const std::byte> vertices, std::span<const uint32_t> indices,
+        GeometryRange &out_vertices, GeometryRange &out_indices, VkIndexType &out_index_type
+    );
+
+    // Returns ranges to the arenas. They must no longer be in use by the GPU.
+    void free(GeometryRange vertices, GeometryRange indices, VkIndexType index_type);
+
+  private:
+    RangeAllocator &get_index_ranges(VkIndexType index_type)
+    {
+        return index_type == VK_INDEX_TYPE_UINT16 ? m_index16_ranges : m_index32_ranges;
+    }
+};
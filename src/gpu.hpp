@@ -14,6 +14,7 @@ struct GPUImage
 {
     VkExtent3D extent;
     VkFormat format;
+    uint32_t mip_levels;
     VkImage image;
     VkImageView view;
     VmaAllocation allocation;
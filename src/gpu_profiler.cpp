@@ -0,0 +1,341 @@
+#include "gpu_profiler.hpp"
+
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+#include "vkerr.hpp"
+
+[[nodiscard]] bool GPUProfiler::init(VkDevice device, float timestamp_period, size_t num_frames)
+{
+    m_device = device;
+    m_timestamp_period = timestamp_period;
+
+    if (!is_enabled())
+    {
+        spdlog::warn("GPUProfiler::init: timestamps unsupported, gpu profiling disabled");
+        return true;
+    }
+
+    m_frames.resize(num_frames);
+    for (auto &frame : m_frames)
+    {
+        VkQueryPoolCreateInfo query_pool_info = {};
+        query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        query_pool_info.queryCount = MAX_SCOPES_PER_FRAME * 2;
+        VKERR(
+            vkCreateQueryPool(m_device, &query_pool_info, nullptr, &frame.pool),
+            "GPUProfiler::init: failed to create timestamp query pool"
+        );
+        m_deletion_queue.add([this, &frame] { vkDestroyQueryPool(m_device, frame.pool, nullptr); });
+
+        VkQueryPoolCreateInfo statistics_pool_info = {};
+        statistics_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        statistics_pool_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        statistics_pool_info.queryCount = 1;
+        statistics_pool_info.pipelineStatistics = PIPELINE_STATISTICS;
+        VKERR(
+            vkCreateQueryPool(m_device, &statistics_pool_info, nullptr, &frame.statistics_pool),
+            "GPUProfiler::init: failed to create pipeline statistics query pool"
+        );
+        m_deletion_queue.add([this, &frame] {
+            vkDestroyQueryPool(m_device, frame.statistics_pool, nullptr);
+        });
+
+        frame.scopes.reserve(MAX_SCOPES_PER_FRAME);
+    }
+    spdlog::trace("GPUProfiler::init: created {} sets of query pools", m_frames.size());
+
+    return true;
+}
+
+void GPUProfiler::destroy()
+{
+    m_deletion_queue.delete_all();
+    m_frames.clear();
+}
+
+uint32_t GPUProfiler::get_pass_id(const std::string &name)
+{
+    for (uint32_t i = 0; i < m_passes.size(); ++i)
+    {
+        if (m_passes[i].name == name)
+        {
+            return i;
+        }
+    }
+
+    GPUPassStats &pass = m_passes.emplace_back();
+    pass.name = name;
+    pass.samples.reserve(AVERAGE_WINDOW);
+    return static_cast<uint32_t>(m_passes.size() - 1);
+}
+
+[[nodiscard]] bool
+GPUProfiler::begin_frame(VkCommandBuffer cmd_buffer, size_t frame_idx, uint64_t frame_number)
+{
+    if (!is_enabled())
+    {
+        return true;
+    }
+
+    m_current_frame = frame_idx;
+    FrameQueries &frame = m_frames[m_current_frame];
+
+    if (!resolve(frame))
+    {
+        spdlog::error("GPUProfiler::begin_frame: failed to resolve previous results");
+        return false;
+    }
+
+    vkCmdResetQueryPool(cmd_buffer, frame.pool, 0, MAX_SCOPES_PER_FRAME * 2);
+    vkCmdResetQueryPool(cmd_buffer, frame.statistics_pool, 0, 1);
+    frame.frame_number = frame_number;
+    frame.scopes.clear();
+    frame.statistics_begun = false;
+    frame.statistics_ended = false;
+    frame.pending = true;
+
+    return true;
+}
+
+uint32_t GPUProfiler::begin_scope(VkCommandBuffer cmd_buffer, const std::string &name)
+{
+    if (!is_enabled())
+    {
+        return INVALID_SCOPE;
+    }
+
+    FrameQueries &frame = m_frames[m_current_frame];
+    if (frame.scopes.size() >= MAX_SCOPES_PER_FRAME)
+    {
+        spdlog::warn("GPUProfiler::begin_scope: too many scopes in frame, ignoring `{}`", name);
+        return INVALID_SCOPE;
+    }
+
+    uint32_t scope = static_cast<uint32_t>(frame.scopes.size());
+    frame.scopes.emplace_back(Scope{.pass_id = get_pass_id(name), .ended = false});
+    vkCmdWriteTimestamp2(
+        cmd_buffer,
+        VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
+        frame.pool,
+        scope * 2
+    );
+
+    return scope;
+}
+
+void GPUProfiler::end_scope(VkCommandBuffer cmd_buffer, uint32_t scope)
+{
+    if (scope == INVALID_SCOPE)
+    {
+        return;
+    }
+
+    FrameQueries &frame = m_frames[m_current_frame];
+    vkCmdWriteTimestamp2(
+        cmd_buffer,
+        VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
+        frame.pool,
+        scope * 2 + 1
+    );
+    frame.scopes[scope].ended = true;
+}
+
+void GPUProfiler::begin_statistics(VkCommandBuffer cmd_buffer)
+{
+    if (!is_enabled())
+    {
+        return;
+    }
+
+    FrameQueries &frame = m_frames[m_current_frame];
+    if (frame.statistics_begun)
+    {
+        spdlog::warn("GPUProfiler::begin_statistics: statistics already counted in frame");
+        return;
+    }
+
+    vkCmdBeginQuery(cmd_buffer, frame.statistics_pool, 0, 0);
+    frame.statistics_begun = true;
+}
+
+void GPUProfiler::end_statistics(VkCommandBuffer cmd_buffer)
+{
+    if (!is_enabled())
+    {
+        return;
+    }
+
+    FrameQueries &frame = m_frames[m_current_frame];
+    if (!frame.statistics_begun || frame.statistics_ended)
+    {
+        return;
+    }
+
+    vkCmdEndQuery(cmd_buffer, frame.statistics_pool, 0);
+    frame.statistics_ended = true;
+}
+
+[[nodiscard]] bool GPUProfiler::resolve_all()
+{
+    for (size_t i = 1; i <= m_frames.size(); ++i)
+    {
+        if (!resolve(m_frames[(m_current_frame + i) % m_frames.size()]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+[[nodiscard]] bool GPUProfiler::resolve(FrameQueries &frame)
+{
+    if (!frame.pending)
+    {
+        return true;
+    }
+    frame.pending = false;
+
+    if (frame.scopes.empty() && !frame.statistics_ended)
+    {
+        return true;
+    }
+
+    std::array<uint64_t, MAX_SCOPES_PER_FRAME * 2> timestamps;
+    uint32_t query_count = static_cast<uint32_t>(frame.scopes.size() * 2);
+    if (query_count > 0)
+    {
+        VKERR(
+            vkGetQueryPoolResults(
+                m_device,
+                frame.pool,
+                0,
+                query_count,
+                query_count * sizeof(uint64_t),
+                timestamps.data(),
+                sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT
+            ),
+            "GPUProfiler::resolve: failed to get query pool results"
+        );
+    }
+
+    HistoryEntry entry{
+        .frame_number = frame.frame_number,
+        .pass_times_ms = std::vector<double>(m_passes.size(), -1.0),
+        .fragment_invocations = -1,
+    };
+
+    if (frame.statistics_ended)
+    {
+        uint64_t fragment_invocations;
+        VKERR(
+            vkGetQueryPoolResults(
+                m_device,
+                frame.statistics_pool,
+                0,
+                1,
+                sizeof(uint64_t),
+                &fragment_invocations,
+                sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT
+            ),
+            "GPUProfiler::resolve: failed to get pipeline statistics results"
+        );
+        m_fragment_invocations = fragment_invocations;
+        entry.fragment_invocations = static_cast<int64_t>(fragment_invocations);
+    }
+
+    for (size_t i = 0; i < frame.scopes.size(); ++i)
+    {
+        const Scope &scope = frame.scopes[i];
+        if (!scope.ended)
+        {
+            continue;
+        }
+
+        double time_ms = static_cast<double>(timestamps[i * 2 + 1] - timestamps[i * 2]) *
+                         static_cast<double>(m_timestamp_period) / 1'000'000.0;
+        entry.pass_times_ms[scope.pass_id] = time_ms;
+
+        GPUPassStats &pass = m_passes[scope.pass_id];
+        if (pass.samples.size() < AVERAGE_WINDOW)
+        {
+            pass.samples.emplace_back(time_ms);
+        }
+        else
+        {
+            pass.samples[pass.next_sample] = time_ms;
+        }
+        pass.next_sample = (pass.next_sample + 1) % AVERAGE_WINDOW;
+
+        double sum = 0.0;
+        for (double sample : pass.samples)
+        {
+            sum += sample;
+        }
+        pass.last_ms = time_ms;
+        pass.average_ms = sum / static_cast<double>(pass.samples.size());
+    }
+
+    if (m_resolve_callback)
+    {
+        m_resolve_callback(entry.frame_number, entry.pass_times_ms, entry.fragment_invocations);
+    }
+
+    m_history.emplace_back(std::move(entry));
+    if (m_history.size() > HISTORY_LENGTH)
+    {
+        m_history.pop_front();
+    }
+
+    return true;
+}
+
+[[nodiscard]] bool GPUProfiler::export_csv(const std::string &path) const
+{
+    std::ofstream out(path);
+    if (!out.is_open())
+    {
+        spdlog::error("GPUProfiler::export_csv: failed to open file {}", path);
+        return false;
+    }
+
+    out << "frame";
+    for (const GPUPassStats &pass : m_passes)
+    {
+        out << "," << pass.name << "_ms";
+    }
+    out << ",fragment_invocations\n";
+
+    for (const HistoryEntry &entry : m_history)
+    {
+        out << entry.frame_number;
+        for (size_t i = 0; i < m_passes.size(); ++i)
+        {
+            out << ",";
+            if (i < entry.pass_times_ms.size() && entry.pass_times_ms[i] >= 0.0)
+            {
+                out << entry.pass_times_ms[i];
+            }
+        }
+        out << ",";
+        if (entry.fragment_invocations >= 0)
+        {
+            out << entry.fragment_invocations;
+        }
+        out << "\n";
+    }
+
+    if (!out.good())
+    {
+        spdlog::error("GPUProfiler::export_csv: failed to write file {}", path);
+        return false;
+    }
+
+    spdlog::info("GPUProfiler::export_csv: wrote {} frames to {}", m_history.size(), path);
+    return true;
+}
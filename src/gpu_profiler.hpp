@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "deletion_queue.hpp"
+
+// `fragment_invocations` is -1 if the frame did not count them.
+using GPUProfilerResolveCallback = std::function<void(
+    uint64_t frame_number, std::span<const double> pass_times_ms, int64_t fragment_invocations
+)>;
+
+struct GPUPassStats
+{
+    std::string name;
+    double last_ms{0.0};
+    double average_ms{0.0};
+
+    std::vector<double> samples;
+    size_t next_sample{0};
+};
+
+// Records timestamp queries around named passes in the frame command buffers. Results are only
+// read back once the frame slot comes around again (i.e. its fence has been waited on), so they
+// lag `num_frames` frames behind and never stall the CPU.
+//
+// In addition to the timestamps each frame can count the fragment shader invocations of one
+// span of its commands with a pipeline statistics query.
+class GPUProfiler
+{
+  public:
+    static constexpr uint32_t MAX_SCOPES_PER_FRAME = 32;
+    static constexpr size_t AVERAGE_WINDOW = 120;
+    static constexpr size_t HISTORY_LENGTH = 4096;
+    static constexpr uint32_t INVALID_SCOPE = UINT32_MAX;
+    static constexpr VkQueryPipelineStatisticFlags PIPELINE_STATISTICS =
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+  private:
+    struct Scope
+    {
+        uint32_t pass_id;
+        bool ended;
+    };
+
+    struct FrameQueries
+    {
+        VkQueryPool pool{VK_NULL_HANDLE};
+        VkQueryPool statistics_pool{VK_NULL_HANDLE};
+        uint64_t frame_number{0};
+        std::vector<Scope> scopes;
+        bool statistics_begun{false};
+        bool statistics_ended{false};
+        bool pending{false};
+    };
+
+    struct HistoryEntry
+    {
+        uint64_t frame_number;
+        std::vector<double> pass_times_ms;
+        int64_t fragment_invocations;
+    };
+
+    DeletionQueue m_deletion_queue;
+
+    VkDevice m_device{VK_NULL_HANDLE};
+    float m_timestamp_period{0.0f};
+
+    std::vector<FrameQueries> m_frames;
+    size_t m_current_frame{0};
+
+    std::vector<GPUPassStats> m_passes;
+    std::deque<HistoryEntry> m_history;
+    uint64_t m_fragment_invocations{0};
+
+    GPUProfilerResolveCallback m_resolve_callback;
+
+  public:
+    // A `timestamp_period` of zero disables the profiler, all scopes then become no-ops.
+    [[nodiscard]] bool init(VkDevice device, float timestamp_period, size_t num_frames);
+    void destroy();
+
+    bool is_enabled() const
+    {
+        return m_timestamp_period > 0.0f;
+    }
+
+    const std::vector<GPUPassStats> &get_passes() const
+    {
+        return m_passes;
+    }
+
+    // Fragment shader invocations counted in the last resolved frame.
+    uint64_t get_fragment_invocations() const
+    {
+        return m_fragment_invocations;
+    }
+
+    void set_resolve_callback(GPUProfilerResolveCallback callback)
+    {
+        m_resolve_callback = std::move(callback);
+    }
+
+    uint32_t get_pass_id(const std::string &name);
+
+    // Must be called right after the frame's fence has been waited on and its command buffer
+    // has begun recording.
+    [[nodiscard]] bool
+    begin_frame(VkCommandBuffer cmd_buffer, size_t frame_idx, uint64_t frame_number);
+
+    uint32_t begin_scope(VkCommandBuffer cmd_buffer, const std::string &name);
+    void end_scope(VkCommandBuffer cmd_buffer, uint32_t scope);
+
+    // Counts the fragment shader invocations between the two calls. At most once per frame and
+    // both calls have to be outside of a render pass.
+    void begin_statistics(VkCommandBuffer cmd_buffer);
+    void end_statistics(VkCommandBuffer cmd_buffer);
+
+    // Whether the statistics query of the frame being recorded is active, secondary command
+    // buffers executed meanwhile have to inherit it.
+    bool is_counting_statistics() const
+    {
+        if (!is_enabled())
+        {
+            return false;
+        }
+        const FrameQueries &frame = m_frames[m_current_frame];
+        return frame.statistics_begun && !frame.statistics_ended;
+    }
+
+    // Reads back all outstanding results. The device must be idle.
+    [[nodiscard]] bool resolve_all();
+
+    [[nodiscard]] bool export_csv(const std::string &path) const;
+
+  private:
+    [[nodiscard]] bool resolve(FrameQueries &frame);
+};
@@ -0,0 +1,14 @@
+#include "hash.hpp"
+
+uint64_t hash_bytes(std::span<const std::byte> data, uint64_t seed)
+{
+    constexpr uint64_t PRIME = 0x100000001b3ull;
+
+    uint64_t hash = seed;
+    for (std::byte b : data)
+    {
+        hash ^= static_cast<uint64_t>(b);
+        hash *= PRIME;
+    }
+    return hash;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// 64-bit FNV-1a. Used to identify file contents, not for anything security related.
+uint64_t hash_bytes(std::span<const std::byte> data, uint64_t seed = 0xcbf29ce484222325ull);
@@ -0,0 +1,366 @@
+#include "hiz_pass.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include <spdlog/spdlog.h>
+
+#include "engine.hpp"
+#include "vkerr.hpp"
+
+struct HiZPushConstants
+{
+    int32_t source_width;
+    int32_t source_height;
+    int32_t destination_width;
+    int32_t destination_height;
+};
+
+[[nodiscard]] bool HiZPass::init(const GPUImage &depth_image)
+{
+    spdlog::trace("HiZPass::init: initializing depth pyramid pass");
+
+    m_depth_image = depth_image.image;
+    m_depth_extent = VkExtent2D{
+        .width = depth_image.extent.width,
+        .height = depth_image.extent.height,
+    };
+
+    VkExtent3D pyramid_extent{
+        .width = std::bit_ceil((m_depth_extent.width + 1) / 2),
+        .height = std::bit_ceil((m_depth_extent.height + 1) / 2),
+        .depth = 1,
+    };
+    uint32_t largest_side = std::max(pyramid_extent.width, pyramid_extent.height);
+    uint32_t level_count = std::min(
+        static_cast<uint32_t>(std::bit_width(largest_side)),
+        MAX_LEVELS
+    );
+    if (!m_engine.create_image(
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            VK_FORMAT_R32_SFLOAT,
+            pyramid_extent,
+            level_count,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            m_pyramid
+        ))
+    {
+        spdlog::error("HiZPass::init: failed to allocate depth pyramid");
+        return false;
+    }
+    m_deletion_queue.add([this] { m_engine.destroy_image(m_pyramid); });
+
+    for (uint32_t level = 0; level < level_count; ++level)
+    {
+        VkImageViewCreateInfo view_info = {};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = m_pyramid.image;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = m_pyramid.format;
+        view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        view_info.subresourceRange.baseMipLevel = level;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.baseArrayLayer = 0;
+        view_info.subresourceRange.layerCount = 1;
+        VKERR(
+            vkCreateImageView(m_engine.get_device(), &view_info, nullptr, &m_level_views[level]),
+            "HiZPass::init: failed to create pyramid level view"
+        );
+        m_deletion_queue.add([this, level] {
+            vkDestroyImageView(m_engine.get_device(), m_level_views[level], nullptr);
+        });
+    }
+    // The pyramid stays in the general layout so the cull pass can bind it before it is first
+    // built.
+    if (!m_engine.immediate_submit([this](VkCommandBuffer cmd_buffer) {
+            transition_image(
+                cmd_buffer,
+                m_pyramid.image,
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_GENERAL
+            );
+        }))
+    {
+        spdlog::error("HiZPass::init: failed to transition depth pyramid");
+        return false;
+    }
+    spdlog::trace(
+        "HiZPass::init: created {}x{} depth pyramid with {} levels",
+        pyramid_extent.width,
+        pyramid_extent.height,
+        level_count
+    );
+
+    // Only ever read with texelFetch.
+    VkSamplerCreateInfo sampler_info = {};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter = VK_FILTER_NEAREST;
+    sampler_info.minFilter = VK_FILTER_NEAREST;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.minLod = 0.0f;
+    sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+    VKERR(
+        vkCreateSampler(m_engine.get_device(), &sampler_info, nullptr, &m_sampler),
+        "HiZPass::init: failed to create sampler"
+    );
+    m_deletion_queue.add([this] { vkDestroySampler(m_engine.get_device(), m_sampler, nullptr); });
+
+    std::array level_bindings{
+        VkDescriptorSetLayoutBinding{
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = nullptr,
+        },
+        VkDescriptorSetLayoutBinding{
+            .binding = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = nullptr,
+        },
+    };
+    VkDescriptorSetLayoutCreateInfo set_layout_info = {};
+    set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    set_layout_info.bindingCount = level_bindings.size();
+    set_layout_info.pBindings = level_bindings.data();
+    VKERR(
+        vkCreateDescriptorSetLayout(
+            m_engine.get_device(),
+            &set_layout_info,
+            nullptr,
+            &m_level_set_layout
+        ),
+        "HiZPass::init: failed to create level set layout"
+    );
+    m_deletion_queue.add([this] {
+        vkDestroyDescriptorSetLayout(m_engine.get_device(), m_level_set_layout, nullptr);
+    });
+
+    set_layout_info.bindingCount = 1;
+    VKERR(
+        vkCreateDescriptorSetLayout(
+            m_engine.get_device(),
+            &set_layout_info,
+            nullptr,
+            &m_pyramid_set_layout
+        ),
+        "HiZPass::init: failed to create pyramid set layout"
+    );
+    m_deletion_queue.add([this] {
+        vkDestroyDescriptorSetLayout(m_engine.get_device(), m_pyramid_set_layout, nullptr);
+    });
+
+    std::array pool_sizes{
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, level_count + 1},
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, level_count},
+    };
+    VkDescriptorPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets = level_count + 1;
+    pool_info.poolSizeCount = pool_sizes.size();
+    pool_info.pPoolSizes = pool_sizes.data();
+    VKERR(
+        vkCreateDescriptorPool(m_engine.get_device(), &pool_info, nullptr, &m_descriptor_pool),
+        "HiZPass::init: failed to create descriptor pool"
+    );
+    m_deletion_queue.add([this] {
+        vkDestroyDescriptorPool(m_engine.get_device(), m_descriptor_pool, nullptr);
+    });
+
+    std::array<VkDescriptorSetLayout, MAX_LEVELS> level_set_layouts;
+    level_set_layouts.fill(m_level_set_layout);
+    VkDescriptorSetAllocateInfo set_info = {};
+    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_info.descriptorPool = m_descriptor_pool;
+    set_info.descriptorSetCount = level_count;
+    set_info.pSetLayouts = level_set_layouts.data();
+    VKERR(
+        vkAllocateDescriptorSets(m_engine.get_device(), &set_info, m_level_sets.data()),
+        "HiZPass::init: failed to allocate level sets"
+    );
+    set_info.descriptorSetCount = 1;
+    set_info.pSetLayouts = &m_pyramid_set_layout;
+    VKERR(
+        vkAllocateDescriptorSets(m_engine.get_device(), &set_info, &m_pyramid_set),
+        "HiZPass::init: failed to allocate pyramid set"
+    );
+
+    for (uint32_t level = 0; level < level_count; ++level)
+    {
+        VkDescriptorImageInfo source_info{
+            .sampler = m_sampler,
+            .imageView = level == 0 ? depth_image.view : m_level_views[level - 1],
+            .imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL
+                                      : VK_IMAGE_LAYOUT_GENERAL,
+        };
+        VkDescriptorImageInfo destination_info{
+            .sampler = VK_NULL_HANDLE,
+            .imageView = m_level_views[level],
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+        };
+
+        std::array<VkWriteDescriptorSet, 2> writes = {};
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet = m_level_sets[level];
+        writes[0].dstBinding = 0;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[0].pImageInfo = &source_info;
+        writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[1].dstSet = m_level_sets[level];
+        writes[1].dstBinding = 1;
+        writes[1].descriptorCount = 1;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[1].pImageInfo = &destination_info;
+        vkUpdateDescriptorSets(m_engine.get_device(), writes.size(), writes.data(), 0, nullptr);
+    }
+
+    VkDescriptorImageInfo pyramid_info{
+        .sampler = m_sampler,
+        .imageView = m_pyramid.view,
+        .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+    };
+    VkWriteDescriptorSet pyramid_write = {};
+    pyramid_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    pyramid_write.dstSet = m_pyramid_set;
+    pyramid_write.dstBinding = 0;
+    pyramid_write.descriptorCount = 1;
+    pyramid_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pyramid_write.pImageInfo = &pyramid_info;
+    vkUpdateDescriptorSets(m_engine.get_device(), 1, &pyramid_write, 0, nullptr);
+    spdlog::trace("HiZPass::init: created descriptor sets");
+
+    VkPushConstantRange push_constant_range{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(HiZPushConstants),
+    };
+    VkPipelineLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.setLayoutCount = 1;
+    layout_info.pSetLayouts = &m_level_set_layout;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push_constant_range;
+    VKERR(
+        vkCreatePipelineLayout(m_engine.get_device(), &layout_info, nullptr, &m_pipeline_layout),
+        "HiZPass::init: failed to create pipeline layout"
+    );
+    m_deletion_queue.add([this] {
+        vkDestroyPipelineLayout(m_engine.get_device(), m_pipeline_layout, nullptr);
+    });
+
+    AssetData compute_code;
+    if (!m_engine.get_asset_archive().load("../shaders/hiz.comp.bin", compute_code))
+    {
+        spdlog::error("HiZPass::init: failed to load shader");
+        return false;
+    }
+
+    VkShaderModule compute_shader;
+    VkShaderModuleCreateInfo compute_info = {};
+    compute_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    compute_info.codeSize = compute_code.data.size();
+    compute_info.pCode = reinterpret_cast<const uint32_t *>(compute_code.data.data());
+    VKERR(
+        vkCreateShaderModule(m_engine.get_device(), &compute_info, nullptr, &compute_shader),
+        "HiZPass::init: failed to create compute shader module"
+    );
+
+    VkComputePipelineCreateInfo pipeline_info = {};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = compute_shader;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.layout = m_pipeline_layout;
+    VkResult res = vkCreateComputePipelines(
+        m_engine.get_device(),
+        VK_NULL_HANDLE,
+        1,
+        &pipeline_info,
+        nullptr,
+        &m_pipeline
+    );
+    vkDestroyShaderModule(m_engine.get_device(), compute_shader, nullptr);
+    VKERR(res, "HiZPass::init: failed to create pipeline");
+    m_deletion_queue.add([this] { vkDestroyPipeline(m_engine.get_device(), m_pipeline, nullptr); });
+    spdlog::trace("HiZPass::init: created pipeline");
+
+    return true;
+}
+
+void HiZPass::render(VkCommandBuffer cmd_buffer)
+{
+    transition_image(
+        cmd_buffer,
+        m_depth_image,
+        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+        VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL
+    );
+
+    vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+
+    VkExtent2D source_extent = m_depth_extent;
+    for (uint32_t level = 0; level < m_pyramid.mip_levels; ++level)
+    {
+        VkExtent2D destination_extent{
+            .width = std::max(m_pyramid.extent.width >> level, 1u),
+            .height = std::max(m_pyramid.extent.height >> level, 1u),
+        };
+
+        HiZPushConstants push_constants{
+            .source_width = static_cast<int32_t>(source_extent.width),
+            .source_height = static_cast<int32_t>(source_extent.height),
+            .destination_width = static_cast<int32_t>(destination_extent.width),
+            .destination_height = static_cast<int32_t>(destination_extent.height),
+        };
+        vkCmdBindDescriptorSets(
+            cmd_buffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            m_pipeline_layout,
+            0,
+            1,
+            &m_level_sets[level],
+            0,
+            nullptr
+        );
+        vkCmdPushConstants(
+            cmd_buffer,
+            m_pipeline_layout,
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            sizeof(HiZPushConstants),
+            &push_constants
+        );
+        vkCmdDispatch(
+            cmd_buffer,
+            (destination_extent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+            (destination_extent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+            1
+        );
+
+        // Each level is read by the next one and all of them by the cull pass.
+        memory_barrier(
+            cmd_buffer,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_SAMPLED_READ_BIT
+        );
+
+        source_extent = destination_extent;
+    }
+
+    transition_image(
+        cmd_buffer,
+        m_depth_image,
+        VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL
+    );
+}
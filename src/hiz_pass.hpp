@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <vulkan/vulkan_core.h>
+
+#include "deletion_queue.hpp"
+#include "gpu.hpp"
+
+class Engine;
+
+// Builds a depth pyramid (Hi-Z) from the forward pass's depth target for occlusion culling.
+// Every texel of level 0 holds the farthest depth of a 2x2 block of depth target pixels and every
+// further level the farthest of a 2x2 block of the previous one, so a texel of level `l` covers
+// `2^(l + 1)` pixels in each direction. Level 0 is rounded up to a power of two, the texels past
+// the depth target repeat its edge.
+class HiZPass
+{
+  public:
+    static constexpr uint32_t MAX_LEVELS = 16;
+    static constexpr uint32_t WORKGROUP_SIZE = 8;
+
+  private:
+    DeletionQueue m_deletion_queue;
+
+    Engine &m_engine;
+
+    VkImage m_depth_image{VK_NULL_HANDLE};
+    VkExtent2D m_depth_extent{};
+
+    GPUImage m_pyramid;
+    std::array<VkImageView, MAX_LEVELS> m_level_views{};
+
+    VkSampler m_sampler;
+    VkDescriptorPool m_descriptor_pool;
+    VkDescriptorSetLayout m_level_set_layout;
+    VkDescriptorSetLayout m_pyramid_set_layout;
+    std::array<VkDescriptorSet, MAX_LEVELS> m_level_sets{};
+    VkDescriptorSet m_pyramid_set;
+
+    VkPipelineLayout m_pipeline_layout;
+    VkPipeline m_pipeline;
+
+    HiZPass() = delete;
+    HiZPass(const HiZPass &) = delete;
+    HiZPass &operator=(const HiZPass &) = delete;
+    HiZPass(HiZPass &&) = delete;
+    HiZPass &operator=(HiZPass &&) = delete;
+
+  public:
+    explicit HiZPass(Engine &engine) : m_engine(engine)
+    {
+    }
+
+    ~HiZPass()
+    {
+        m_deletion_queue.delete_all();
+    }
+
+    // Layout of a set with the whole pyramid as a combined image sampler at binding 0.
+    VkDescriptorSetLayout get_pyramid_set_layout() const
+    {
+        return m_pyramid_set_layout;
+    }
+
+    VkDescriptorSet get_pyramid_set() const
+    {
+        return m_pyramid_set;
+    }
+
+    uint32_t get_level_count() const
+    {
+        return m_pyramid.mip_levels;
+    }
+
+    VkExtent2D get_depth_extent() const
+    {
+        return m_depth_extent;
+    }
+
+    // `depth_image` must have been created with `VK_IMAGE_USAGE_SAMPLED_BIT`.
+    [[nodiscard]] bool init(const GPUImage &depth_image);
+
+    // Must be recorded after depth has been rendered, outside of a render pass. The depth image
+    // is expected and left in `VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL` and the pyramid is left
+    // in `VK_IMAGE_LAYOUT_GENERAL`, ready to be sampled by compute shaders.
+    void render(VkCommandBuffer cmd_buffer);
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+// Texels prepared on the CPU and not yet uploaded to the GPU. `data` holds the full mip chain,
+// each level tightly packed in `format` and starting at the matching entry of `mip_offsets`.
+struct DecodedImage
+{
+    VkExtent3D extent;
+    VkFormat format{VK_FORMAT_R8G8B8A8_SRGB};
+    std::vector<std::byte> data;
+    std::vector<VkDeviceSize> mip_offsets;
+};
@@ -0,0 +1,36 @@
+#include "json.hpp"
+
+std::string json_escape(const std::string &str)
+{
+    std::string escaped;
+    escaped.reserve(str.size());
+    for (char c : str)
+    {
+        switch (c)
+        {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    escaped += ' ';
+                }
+                else
+                {
+                    escaped += c;
+                }
+                break;
+        }
+    }
+    return escaped;
+}
@@ -0,0 +1,304 @@
+#include "ktx2.hpp"
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "mipmap.hpp"
+#include "texture_compression.hpp"
+
+namespace
+{
+
+constexpr std::array<uint8_t, 12> KTX2_IDENTIFIER{
+    0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a,
+};
+
+// Identifier, nine header fields and the section index.
+constexpr size_t HEADER_SIZE = 12 + 9 * 4 + 4 * 4 + 2 * 8;
+constexpr size_t LEVEL_INDEX_ENTRY_SIZE = 3 * 8;
+
+// Data format descriptor color models, see the Khronos Data Format Specification.
+constexpr uint8_t KHR_DF_MODEL_BC1A = 128;
+constexpr uint8_t KHR_DF_MODEL_BC4 = 131;
+constexpr uint8_t KHR_DF_MODEL_BC5 = 132;
+constexpr uint8_t KHR_DF_MODEL_BC7 = 134;
+constexpr uint8_t KHR_DF_PRIMARIES_BT709 = 1;
+constexpr uint8_t KHR_DF_TRANSFER_LINEAR = 1;
+constexpr uint8_t KHR_DF_TRANSFER_SRGB = 2;
+
+uint32_t read_u32(std::span<const uint8_t> data, size_t offset)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        value |= static_cast<uint32_t>(data[offset + i]) << (i * 8);
+    }
+    return value;
+}
+
+uint64_t read_u64(std::span<const uint8_t> data, size_t offset)
+{
+    return static_cast<uint64_t>(read_u32(data, offset)) |
+           static_cast<uint64_t>(read_u32(data, offset + 4)) << 32;
+}
+
+void write_u8(std::vector<uint8_t> &out, uint8_t value)
+{
+    out.emplace_back(value);
+}
+
+void write_u16(std::vector<uint8_t> &out, uint16_t value)
+{
+    for (size_t i = 0; i < 2; ++i)
+    {
+        out.emplace_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+void write_u32(std::vector<uint8_t> &out, uint32_t value)
+{
+    for (size_t i = 0; i < 4; ++i)
+    {
+        out.emplace_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+void write_u64(std::vector<uint8_t> &out, uint64_t value)
+{
+    write_u32(out, static_cast<uint32_t>(value));
+    write_u32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void patch_u64(std::vector<uint8_t> &out, size_t offset, uint64_t value)
+{
+    for (size_t i = 0; i < 8; ++i)
+    {
+        out[offset + i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+}
+
+// Builds a basic data format descriptor with one sample per block-compressed channel.
+std::vector<uint8_t> make_dfd(VkFormat format)
+{
+    struct Sample
+    {
+        uint16_t bit_offset;
+        uint8_t bit_length;
+        uint8_t channel;
+    };
+
+    uint8_t model;
+    std::vector<Sample> samples;
+    switch (format)
+    {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            model = KHR_DF_MODEL_BC1A;
+            samples = {{0, 64, 0}};
+            break;
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            model = KHR_DF_MODEL_BC4;
+            samples = {{0, 64, 0}};
+            break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            model = KHR_DF_MODEL_BC5;
+            samples = {{0, 64, 0}, {64, 64, 1}};
+            break;
+        default:
+            model = KHR_DF_MODEL_BC7;
+            samples = {{0, 128, 0}};
+            break;
+    }
+
+    uint16_t block_size = static_cast<uint16_t>(24 + 16 * samples.size());
+
+    std::vector<uint8_t> dfd;
+    write_u32(dfd, 4 + block_size);
+    write_u32(dfd, 0);
+    write_u16(dfd, 2);
+    write_u16(dfd, block_size);
+    write_u8(dfd, model);
+    write_u8(dfd, KHR_DF_PRIMARIES_BT709);
+    write_u8(dfd, is_srgb_format(format) ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR);
+    write_u8(dfd, 0);
+    // Texel block dimensions minus one.
+    for (size_t dimension = 0; dimension < 4; ++dimension)
+    {
+        write_u8(dfd, dimension < 2 ? 3 : 0);
+    }
+    write_u8(dfd, static_cast<uint8_t>(get_block_byte_size(format)));
+    for (size_t plane = 1; plane < 8; ++plane)
+    {
+        write_u8(dfd, 0);
+    }
+    for (const Sample &sample : samples)
+    {
+        write_u16(dfd, sample.bit_offset);
+        write_u8(dfd, sample.bit_length - 1);
+        write_u8(dfd, sample.channel);
+        write_u32(dfd, 0);
+        write_u32(dfd, 0);
+        write_u32(dfd, 0xffffffff);
+    }
+
+    return dfd;
+}
+
+} // namespace
+
+std::string get_cooked_texture_path(const std::string &source_path)
+{
+    return std::filesystem::path(source_path).replace_extension(".ktx2").string();
+}
+
+[[nodiscard]] bool read_ktx2(std::span<const uint8_t> file, DecodedImage &out_image)
+{
+    if (file.size() < HEADER_SIZE ||
+        std::memcmp(file.data(), KTX2_IDENTIFIER.data(), KTX2_IDENTIFIER.size()) != 0)
+    {
+        spdlog::error("read_ktx2: not a ktx2 file");
+        return false;
+    }
+
+    auto format = static_cast<VkFormat>(read_u32(file, 12));
+    uint32_t width = read_u32(file, 20);
+    uint32_t height = read_u32(file, 24);
+    uint32_t depth = read_u32(file, 28);
+    uint32_t layer_count = read_u32(file, 32);
+    uint32_t face_count = read_u32(file, 36);
+    uint32_t level_count = read_u32(file, 40);
+    uint32_t supercompression = read_u32(file, 44);
+
+    if (get_block_byte_size(format) == 0)
+    {
+        spdlog::error("read_ktx2: unsupported format {}", static_cast<int>(format));
+        return false;
+    }
+    if (width == 0 || height == 0 || depth > 1 || layer_count > 1 || face_count != 1 ||
+        supercompression != 0)
+    {
+        spdlog::error("read_ktx2: only uncompressed 2d images are supported");
+        return false;
+    }
+
+    VkExtent3D extent{.width = width, .height = height, .depth = 1};
+    if (level_count != get_mip_level_count(extent))
+    {
+        spdlog::error("read_ktx2: expected a full mip chain, got {} levels", level_count);
+        return false;
+    }
+    if (file.size() < HEADER_SIZE + level_count * LEVEL_INDEX_ENTRY_SIZE)
+    {
+        spdlog::error("read_ktx2: truncated level index");
+        return false;
+    }
+
+    out_image.extent = extent;
+    out_image.format = format;
+    out_image.mip_offsets.clear();
+    out_image.data.clear();
+
+    for (uint32_t level = 0; level < level_count; ++level)
+    {
+        size_t entry = HEADER_SIZE + level * LEVEL_INDEX_ENTRY_SIZE;
+        uint64_t offset = read_u64(file, entry);
+        uint64_t length = read_u64(file, entry + 8);
+
+        uint64_t expected_length = get_compressed_level_size(format, get_mip_extent(extent, level));
+        if (length != expected_length || offset > file.size() || file.size() - offset < length)
+        {
+            spdlog::error("read_ktx2: invalid data for level {}", level);
+            return false;
+        }
+
+        out_image.mip_offsets.emplace_back(out_image.data.size());
+        const auto *level_data = reinterpret_cast<const std::byte *>(file.data() + offset);
+        out_image.data.insert(out_image.data.end(), level_data, level_data + length);
+    }
+
+    return true;
+}
+
+[[nodiscard]] bool write_ktx2(const std::string &path, const DecodedImage &image)
+{
+    uint32_t block_size = get_block_byte_size(image.format);
+    if (block_size == 0)
+    {
+        spdlog::error("write_ktx2: unsupported format {}", static_cast<int>(image.format));
+        return false;
+    }
+
+    uint32_t level_count = static_cast<uint32_t>(image.mip_offsets.size());
+    std::vector<uint8_t> dfd = make_dfd(image.format);
+
+    std::vector<uint8_t> out(KTX2_IDENTIFIER.begin(), KTX2_IDENTIFIER.end());
+    write_u32(out, static_cast<uint32_t>(image.format));
+    write_u32(out, 1);
+    write_u32(out, image.extent.width);
+    write_u32(out, image.extent.height);
+    write_u32(out, 0);
+    write_u32(out, 0);
+    write_u32(out, 1);
+    write_u32(out, level_count);
+    write_u32(out, 0);
+
+    size_t dfd_offset = HEADER_SIZE + level_count * LEVEL_INDEX_ENTRY_SIZE;
+    write_u32(out, static_cast<uint32_t>(dfd_offset));
+    write_u32(out, static_cast<uint32_t>(dfd.size()));
+    write_u32(out, 0);
+    write_u32(out, 0);
+    write_u64(out, 0);
+    write_u64(out, 0);
+
+    size_t level_index_offset = out.size();
+    for (uint32_t level = 0; level < level_count; ++level)
+    {
+        write_u64(out, 0);
+        write_u64(out, 0);
+        write_u64(out, 0);
+    }
+    out.insert(out.end(), dfd.begin(), dfd.end());
+
+    // Levels are stored from the smallest to the largest, each aligned to the block size.
+    for (uint32_t level = level_count; level-- > 0;)
+    {
+        while (out.size() % block_size != 0)
+        {
+            out.emplace_back(0);
+        }
+
+        VkDeviceSize begin = image.mip_offsets[level];
+        VkDeviceSize end = level + 1 < level_count ? image.mip_offsets[level + 1]
+                                                   : static_cast<VkDeviceSize>(image.data.size());
+        size_t entry = level_index_offset + level * LEVEL_INDEX_ENTRY_SIZE;
+        patch_u64(out, entry, out.size());
+        patch_u64(out, entry + 8, end - begin);
+        patch_u64(out, entry + 16, end - begin);
+
+        const auto *level_data = reinterpret_cast<const uint8_t *>(image.data.data());
+        out.insert(out.end(), level_data + begin, level_data + end);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        spdlog::error("write_ktx2: failed to open file {}", path);
+        return false;
+    }
+    file.write(
+        reinterpret_cast<const char *>(out.data()),
+        static_cast<std::streamsize>(out.size())
+    );
+    if (!file.good())
+    {
+        spdlog::error("write_ktx2: failed to write file {}", path);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "image_data.hpp"
+
+// Reads and writes the subset of KTX 2.0 used for cooked textures: single 2D images without
+// array layers, cube faces or supercompression, in one of the block-compressed formats from
+// texture_compression.hpp, with every mip level present.
+
+// Path of the cooked texture for a source image: the same path with a `.ktx2` extension.
+std::string get_cooked_texture_path(const std::string &source_path);
+
+[[nodiscard]] bool read_ktx2(std::span<const uint8_t> file, DecodedImage &out_image);
+
+[[nodiscard]] bool write_ktx2(const std::string &path, const DecodedImage &image);
@@ -4,55 +4,109 @@
 #include <spdlog/spdlog.h>
 
 #include "app.hpp"
+#include "cpu_profiler.hpp"
+#include "options.hpp"
 
-int main()
+int main(int argc, char **argv)
 {
     spdlog::set_level(spdlog::level::trace);
+    CPUProfiler::set_thread_name("main");
+
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (options.show_help)
+    {
+        print_usage(argv[0]);
+        return 0;
+    }
 
     SDL_SetAppMetadata("Aurora", "0.1", nullptr);
     spdlog::trace("main: set sdl app metadata");
 
-    if (!SDL_Init(SDL_INIT_VIDEO))
+    SDL_Window *window = nullptr;
+    if (!options.headless)
     {
-        spdlog::error("main: failed to initialize sdl: {}", SDL_GetError());
-        return 1;
-    }
-    spdlog::trace("main: initialized sdl video and audio subsystem");
+        if (!SDL_Init(SDL_INIT_VIDEO))
+        {
+            spdlog::error("main: failed to initialize sdl: {}", SDL_GetError());
+            return 1;
+        }
+        spdlog::trace("main: initialized sdl video and audio subsystem");
 
-    SDL_Window *window =
-        SDL_CreateWindow("Aurora", 1280, 720, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
-    if (!window)
+        window = SDL_CreateWindow(
+            "Aurora",
+            options.width,
+            options.height,
+            SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE
+        );
+        if (!window)
+        {
+            spdlog::error("main: failed to create window: {}", SDL_GetError());
+            return 1;
+        }
+        spdlog::trace("main: created sdl window");
+    }
+    else
     {
-        spdlog::error("main: failed to create window: {}", SDL_GetError());
-        return 1;
+        spdlog::trace("main: running headless, skipping window creation");
     }
-    spdlog::trace("main: created sdl window");
 
+    int exit_code = 0;
     try
     {
-        App app(window);
+        App app(window, options);
         if (app.init())
         {
             spdlog::trace("main: initialized app");
-            spdlog::trace("main: running app");
-            app.run();
+            if (options.headless)
+            {
+                spdlog::trace("main: running benchmark");
+                if (!app.run_benchmark())
+                {
+                    spdlog::error("main: benchmark failed");
+                    exit_code = 1;
+                }
+            }
+            else
+            {
+                spdlog::trace("main: running app");
+                app.run();
+            }
             spdlog::trace("main: app has exitted");
         }
         else
         {
             spdlog::error("main: failed to initialize app");
+            exit_code = 1;
         }
     }
     catch (const std::exception &e)
     {
         spdlog::error("main: app threw exception: {}", e.what());
+        exit_code = 1;
     }
     catch (...)
     {
         spdlog::error("main: app threw unknown exception");
+        exit_code = 1;
+    }
+
+    if (!options.trace_path.empty())
+    {
+        if (!CPUProfiler::write_chrome_trace(options.trace_path))
+        {
+            spdlog::error("main: failed to write cpu trace");
+        }
     }
 
-    SDL_DestroyWindow(window);
+    if (window)
+    {
+        SDL_DestroyWindow(window);
+    }
     spdlog::trace("main: process terminating...");
-    return 0;
+    return exit_code;
 }
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+// Read-only memory mapping of a whole file. The mapping is released on `close()` or when the
+// object is destroyed, invalidating all views previously returned by `get_data()`.
+class MappedFile
+{
+    const std::byte *m_data{nullptr};
+    size_t m_size{0};
+
+#ifdef _WIN32
+    void *m_file{nullptr};
+    void *m_mapping{nullptr};
+#endif
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+  public:
+    MappedFile() = default;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    [[nodiscard]] bool open(const std::string &path);
+    void close();
+
+    bool is_open() const
+    {
+        return m_data != nullptr;
+    }
+
+    std::span<const std::byte> get_data() const
+    {
+        return {m_data, m_size};
+    }
+};
@@ -0,0 +1,616 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#include <glm/geometric.hpp>
+
+namespace
+{
+
+// Constants and scoring from the original article, tuned for an LRU cache of 32 entries.
+constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+float get_vertex_score(int32_t cache_position, uint32_t remaining_triangles)
+{
+    if (remaining_triangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cache_position >= 0)
+    {
+        if (cache_position < 3)
+        {
+            // The vertices of the last triangle get a fixed score so the next triangle does not
+            // just reuse the same edge, which would produce long thin strips.
+            score = LAST_TRIANGLE_SCORE;
+        }
+        else
+        {
+            float scale = 1.0f / static_cast<float>(FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(
+                1.0f - static_cast<float>(cache_position - 3) * scale,
+                CACHE_DECAY_POWER
+            );
+        }
+    }
+
+    // Vertices with few remaining triangles are finished off first to avoid isolated triangles.
+    score += VALENCE_BOOST_SCALE *
+             std::pow(static_cast<float>(remaining_triangles), -VALENCE_BOOST_POWER);
+    return score;
+}
+
+// Sum of weighted squared distances to a set of planes, as a symmetric 4x4 matrix. Stored in
+// double precision as scene coordinates can be large.
+struct Quadric
+{
+    double a2{0.0}, b2{0.0}, c2{0.0}, d2{0.0};
+    double ab{0.0}, ac{0.0}, ad{0.0};
+    double bc{0.0}, bd{0.0};
+    double cd{0.0};
+    double weight{0.0};
+
+    void add_plane(const glm::vec3 &normal, float distance, float plane_weight)
+    {
+        double a = normal.x, b = normal.y, c = normal.z, d = distance, w = plane_weight;
+        a2 += w * a * a;
+        b2 += w * b * b;
+        c2 += w * c * c;
+        d2 += w * d * d;
+        ab += w * a * b;
+        ac += w * a * c;
+        ad += w * a * d;
+        bc += w * b * c;
+        bd += w * b * d;
+        cd += w * c * d;
+        weight += w;
+    }
+
+    Quadric &operator+=(const Quadric &other)
+    {
+        a2 += other.a2;
+        b2 += other.b2;
+        c2 += other.c2;
+        d2 += other.d2;
+        ab += other.ab;
+        ac += other.ac;
+        ad += other.ad;
+        bc += other.bc;
+        bd += other.bd;
+        cd += other.cd;
+        weight += other.weight;
+        return *this;
+    }
+
+    // Weighted mean of the squared distances of `point` to the planes.
+    double evaluate(const glm::vec3 &point) const
+    {
+        if (weight <= 0.0)
+        {
+            return 0.0;
+        }
+
+        double x = point.x, y = point.y, z = point.z;
+        double error = a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+                       2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z);
+        return std::max(error, 0.0) / weight;
+    }
+};
+
+// Collapse of the edge from `from` to `to`, moving `from` onto `to`.
+struct EdgeCollapse
+{
+    uint32_t from;
+    uint32_t to;
+    double error;
+};
+
+glm::vec3 get_triangle_normal(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+    return glm::cross(b - a, c - a);
+}
+
+} // namespace
+
+VertexCacheStats
+analyze_vertex_cache(std::span<const uint32_t> indices, size_t vertex_count, uint32_t cache_size)
+{
+    VertexCacheStats stats;
+    stats.triangle_count = indices.size() / 3;
+
+    // Timestamp based FIFO: a vertex is in the cache if it was inserted fewer than `cache_size`
+    // insertions ago.
+    std::vector<uint64_t> insertion_time(vertex_count, 0);
+    uint64_t time = cache_size + 1;
+    for (uint32_t index : indices)
+    {
+        if (insertion_time[index] == 0)
+        {
+            ++stats.vertex_count;
+        }
+        if (time - insertion_time[index] > cache_size)
+        {
+            insertion_time[index] = time++;
+            ++stats.transformed_count;
+        }
+    }
+
+    return stats;
+}
+
+void optimize_vertex_cache(std::span<uint32_t> indices, size_t vertex_count)
+{
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+    {
+        return;
+    }
+
+    // Triangles adjacent to each vertex, as ranges into one array.
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+    for (uint32_t index : indices)
+    {
+        ++adjacency_offsets[index + 1];
+    }
+    std::partial_sum(adjacency_offsets.begin(), adjacency_offsets.end(), adjacency_offsets.begin());
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill_offsets(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        adjacency[fill_offsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<uint32_t> remaining_triangles(vertex_count);
+    std::vector<float> vertex_scores(vertex_count);
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex)
+    {
+        remaining_triangles[vertex] = adjacency_offsets[vertex + 1] - adjacency_offsets[vertex];
+        vertex_scores[vertex] = get_vertex_score(-1, remaining_triangles[vertex]);
+    }
+
+    std::vector<float> triangle_scores(triangle_count);
+    for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+    {
+        triangle_scores[triangle] = vertex_scores[indices[3 * triangle + 0]] +
+                                    vertex_scores[indices[3 * triangle + 1]] +
+                                    vertex_scores[indices[3 * triangle + 2]];
+    }
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    // The cache holds the vertices of the last `FORSYTH_CACHE_SIZE` emitted vertices in LRU
+    // order, with room for the three that are pushed in before the oldest ones fall out.
+    std::array<uint32_t, FORSYTH_CACHE_SIZE + 3> cache;
+    std::array<uint32_t, FORSYTH_CACHE_SIZE + 3> new_cache;
+    size_t cache_size = 0;
+
+    size_t input_cursor = 0;
+    uint32_t best_triangle = std::numeric_limits<uint32_t>::max();
+    for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count)
+    {
+        // Dead end: no triangle touching the cache is left, continue with the next one in input
+        // order.
+        if (best_triangle == std::numeric_limits<uint32_t>::max())
+        {
+            while (emitted[input_cursor])
+            {
+                ++input_cursor;
+            }
+            best_triangle = static_cast<uint32_t>(input_cursor);
+        }
+
+        emitted[best_triangle] = true;
+        std::array<uint32_t, 3> triangle_vertices = {
+            indices[3 * best_triangle + 0],
+            indices[3 * best_triangle + 1],
+            indices[3 * best_triangle + 2],
+        };
+        output.insert(output.end(), triangle_vertices.begin(), triangle_vertices.end());
+
+        // Remove the triangle from the adjacency of its vertices.
+        for (uint32_t vertex : triangle_vertices)
+        {
+            uint32_t *begin = adjacency.data() + adjacency_offsets[vertex];
+            uint32_t *end = begin + remaining_triangles[vertex];
+            *std::find(begin, end, best_triangle) = *(end - 1);
+            --remaining_triangles[vertex];
+        }
+
+        // Move the triangle's vertices to the front of the cache.
+        size_t new_cache_size = 0;
+        for (uint32_t vertex : triangle_vertices)
+        {
+            // Degenerate triangles reference a vertex more than once.
+            if (std::find(new_cache.begin(), new_cache.begin() + new_cache_size, vertex) ==
+                new_cache.begin() + new_cache_size)
+            {
+                new_cache[new_cache_size++] = vertex;
+            }
+        }
+        for (size_t i = 0; i < cache_size; ++i)
+        {
+            uint32_t vertex = cache[i];
+            if (vertex != triangle_vertices[0] && vertex != triangle_vertices[1] &&
+                vertex != triangle_vertices[2])
+            {
+                new_cache[new_cache_size++] = vertex;
+            }
+        }
+
+        // Rescore every vertex that is or was in the cache and the triangles around them.
+        for (size_t i = 0; i < new_cache_size; ++i)
+        {
+            uint32_t vertex = new_cache[i];
+            int32_t position = i < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+
+            float new_score = get_vertex_score(position, remaining_triangles[vertex]);
+            float score_delta = new_score - vertex_scores[vertex];
+            vertex_scores[vertex] = new_score;
+
+            uint32_t begin = adjacency_offsets[vertex];
+            for (uint32_t j = begin; j < begin + remaining_triangles[vertex]; ++j)
+            {
+                triangle_scores[adjacency[j]] += score_delta;
+            }
+        }
+
+        // The next triangle is the best one touching the cache.
+        best_triangle = std::numeric_limits<uint32_t>::max();
+        float best_score = -1.0f;
+        for (size_t i = 0; i < std::min<size_t>(new_cache_size, FORSYTH_CACHE_SIZE); ++i)
+        {
+            uint32_t vertex = new_cache[i];
+            uint32_t begin = adjacency_offsets[vertex];
+            for (uint32_t j = begin; j < begin + remaining_triangles[vertex]; ++j)
+            {
+                uint32_t triangle = adjacency[j];
+                if (triangle_scores[triangle] > best_score)
+                {
+                    best_score = triangle_scores[triangle];
+                    best_triangle = triangle;
+                }
+            }
+        }
+
+        cache_size = std::min<size_t>(new_cache_size, FORSYTH_CACHE_SIZE);
+        std::copy_n(new_cache.begin(), cache_size, cache.begin());
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void optimize_overdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices)
+{
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+    {
+        return;
+    }
+
+    // A cluster ends before a triangle whose three vertices all miss the cache, reordering at
+    // those points costs (almost) no cache efficiency.
+    std::vector<size_t> cluster_starts;
+    std::vector<uint64_t> insertion_time(vertices.size(), 0);
+    uint64_t time = ANALYSIS_CACHE_SIZE + 1;
+    for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+    {
+        uint32_t misses = 0;
+        for (size_t corner = 0; corner < 3; ++corner)
+        {
+            uint32_t index = indices[3 * triangle + corner];
+            if (time - insertion_time[index] > ANALYSIS_CACHE_SIZE)
+            {
+                insertion_time[index] = time++;
+                ++misses;
+            }
+        }
+        if (misses == 3 || triangle == 0)
+        {
+            cluster_starts.emplace_back(triangle);
+        }
+    }
+    cluster_starts.emplace_back(triangle_count);
+
+    glm::vec3 mesh_center(0.0f);
+    for (const Vertex &vertex : vertices)
+    {
+        mesh_center = mesh_center + vertex.position;
+    }
+    mesh_center = mesh_center * (1.0f / static_cast<float>(vertices.size()));
+
+    // Clusters facing away from the center of the mesh are likely to occlude the others.
+    size_t cluster_count = cluster_starts.size() - 1;
+    std::vector<float> sort_keys(cluster_count);
+    for (size_t cluster = 0; cluster < cluster_count; ++cluster)
+    {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t triangle = cluster_starts[cluster]; triangle < cluster_starts[cluster + 1];
+             ++triangle)
+        {
+            const glm::vec3 &a = vertices[indices[3 * triangle + 0]].position;
+            const glm::vec3 &b = vertices[indices[3 * triangle + 1]].position;
+            const glm::vec3 &c = vertices[indices[3 * triangle + 2]].position;
+            glm::vec3 weighted_normal = glm::cross(b - a, c - a);
+            float triangle_area = glm::length(weighted_normal);
+
+            centroid = centroid + (a + b + c) * (triangle_area / 3.0f);
+            normal = normal + weighted_normal;
+            area += triangle_area;
+        }
+
+        float normal_length = glm::length(normal);
+        if (area > 0.0f && normal_length > 0.0f)
+        {
+            centroid = centroid * (1.0f / area);
+            normal = normal * (1.0f / normal_length);
+            sort_keys[cluster] = glm::dot(centroid - mesh_center, normal);
+        }
+        else
+        {
+            sort_keys[cluster] = 0.0f;
+        }
+    }
+
+    std::vector<size_t> cluster_order(cluster_count);
+    std::iota(cluster_order.begin(), cluster_order.end(), 0);
+    std::stable_sort(cluster_order.begin(), cluster_order.end(), [&](size_t a, size_t b) {
+        return sort_keys[a] > sort_keys[b];
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (size_t cluster : cluster_order)
+    {
+        output.insert(
+            output.end(),
+            indices.begin() + 3 * cluster_starts[cluster],
+            indices.begin() + 3 * cluster_starts[cluster + 1]
+        );
+    }
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void optimize_vertex_fetch(std::vector<Vertex> &vertices, std::span<uint32_t> indices)
+{
+    constexpr uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t> remap(vertices.size(), UNUSED);
+    std::vector<Vertex> output;
+    output.reserve(vertices.size());
+    for (uint32_t &index : indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = static_cast<uint32_t>(output.size());
+            output.emplace_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(output);
+}
+
+float simplify_mesh(
+    std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+    size_t target_index_count, std::vector<uint32_t> &out_indices
+)
+{
+    out_indices.assign(indices.begin(), indices.end());
+    size_t vertex_count = vertices.size();
+
+    // A directed edge without its reverse belongs to only one triangle.
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (size_t corner = 0; corner < 3; ++corner)
+        {
+            uint64_t a = indices[i + corner];
+            uint64_t b = indices[i + (corner + 1) % 3];
+            edges.emplace_back(a << 32 | b);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    std::vector<bool> locked(vertex_count, false);
+    for (uint64_t edge : edges)
+    {
+        uint64_t reverse = edge << 32 | edge >> 32;
+        if (!std::binary_search(edges.begin(), edges.end(), reverse))
+        {
+            locked[edge >> 32] = true;
+            locked[edge & 0xffffffff] = true;
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertex_count);
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const glm::vec3 &a = vertices[indices[i + 0]].position;
+        const glm::vec3 &b = vertices[indices[i + 1]].position;
+        const glm::vec3 &c = vertices[indices[i + 2]].position;
+        glm::vec3 normal = get_triangle_normal(a, b, c);
+        float length = glm::length(normal);
+        if (length <= 0.0f)
+        {
+            continue;
+        }
+
+        // Weighted by area so the error is the mean distance over the surface.
+        normal = normal * (1.0f / length);
+        float distance = -glm::dot(normal, a);
+        for (size_t corner = 0; corner < 3; ++corner)
+        {
+            quadrics[indices[i + corner]].add_plane(normal, distance, 0.5f * length);
+        }
+    }
+
+    // Collapses are done in passes. Each pass collapses the cheapest edges whose surroundings are
+    // not touched by another collapse of the same pass, so the flip test of every collapse sees
+    // the final positions of its neighbors.
+    std::vector<uint32_t> adjacency_offsets;
+    std::vector<uint32_t> adjacency;
+    std::vector<EdgeCollapse> collapses;
+    std::vector<bool> pass_locked;
+    std::vector<uint32_t> remap(vertex_count);
+    double max_error = 0.0;
+    while (out_indices.size() > target_index_count)
+    {
+        adjacency_offsets.assign(vertex_count + 1, 0);
+        for (uint32_t index : out_indices)
+        {
+            ++adjacency_offsets[index + 1];
+        }
+        std::partial_sum(
+            adjacency_offsets.begin(),
+            adjacency_offsets.end(),
+            adjacency_offsets.begin()
+        );
+        adjacency.resize(out_indices.size());
+        std::vector<uint32_t> fill_offsets(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t i = 0; i < out_indices.size(); ++i)
+        {
+            adjacency[fill_offsets[out_indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < out_indices.size(); i += 3)
+        {
+            for (size_t corner = 0; corner < 3; ++corner)
+            {
+                uint32_t a = out_indices[i + corner];
+                uint32_t b = out_indices[i + (corner + 1) % 3];
+                if (a == b)
+                {
+                    continue;
+                }
+
+                Quadric combined = quadrics[a];
+                combined += quadrics[b];
+                if (!locked[a])
+                {
+                    collapses.emplace_back(EdgeCollapse{
+                        .from = a,
+                        .to = b,
+                        .error = combined.evaluate(vertices[b].position),
+                    });
+                }
+                if (!locked[b])
+                {
+                    collapses.emplace_back(EdgeCollapse{
+                        .from = b,
+                        .to = a,
+                        .error = combined.evaluate(vertices[a].position),
+                    });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const auto &a, const auto &b) {
+            return a.error < b.error;
+        });
+
+        // Every collapse removes the two triangles around an interior edge.
+        size_t target_collapses = (out_indices.size() - target_index_count + 5) / 6;
+        size_t collapse_count = 0;
+        pass_locked.assign(vertex_count, false);
+        std::iota(remap.begin(), remap.end(), 0);
+        for (const EdgeCollapse &collapse : collapses)
+        {
+            if (collapse_count >= target_collapses)
+            {
+                break;
+            }
+            if (pass_locked[collapse.from] || pass_locked[collapse.to])
+            {
+                continue;
+            }
+
+            // Reject collapses that would turn a remaining triangle around or nearly so, small
+            // rotations add up over the passes.
+            const glm::vec3 &target = vertices[collapse.to].position;
+            bool flips = false;
+            uint32_t begin = adjacency_offsets[collapse.from];
+            uint32_t end = adjacency_offsets[collapse.from + 1];
+            for (uint32_t j = begin; j < end && !flips; ++j)
+            {
+                const uint32_t *triangle = &out_indices[3 * adjacency[j]];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to ||
+                    triangle[2] == collapse.to)
+                {
+                    continue;
+                }
+
+                std::array<glm::vec3, 3> positions;
+                for (size_t corner = 0; corner < 3; ++corner)
+                {
+                    positions[corner] = vertices[triangle[corner]].position;
+                }
+                glm::vec3 before = get_triangle_normal(positions[0], positions[1], positions[2]);
+                for (size_t corner = 0; corner < 3; ++corner)
+                {
+                    if (triangle[corner] == collapse.from)
+                    {
+                        positions[corner] = target;
+                    }
+                }
+                glm::vec3 after = get_triangle_normal(positions[0], positions[1], positions[2]);
+                flips = glm::dot(before, after) <=
+                        0.25f * glm::length(before) * glm::length(after);
+            }
+            if (flips)
+            {
+                continue;
+            }
+
+            for (uint32_t j = begin; j < end; ++j)
+            {
+                const uint32_t *triangle = &out_indices[3 * adjacency[j]];
+                pass_locked[triangle[0]] = true;
+                pass_locked[triangle[1]] = true;
+                pass_locked[triangle[2]] = true;
+            }
+            pass_locked[collapse.to] = true;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            max_error = std::max(max_error, collapse.error);
+            ++collapse_count;
+        }
+
+        if (collapse_count == 0)
+        {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < out_indices.size(); i += 3)
+        {
+            uint32_t a = remap[out_indices[i + 0]];
+            uint32_t b = remap[out_indices[i + 1]];
+            uint32_t c = remap[out_indices[i + 2]];
+            if (a != b && b != c && a != c)
+            {
+                out_indices[write++] = a;
+                out_indices[write++] = b;
+                out_indices[write++] = c;
+            }
+        }
+        out_indices.resize(write);
+    }
+
+    return static_cast<float>(std::sqrt(max_error));
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "vertex.hpp"
+
+// Result of simulating a FIFO post-transform vertex cache over a triangle list.
+struct VertexCacheStats
+{
+    uint64_t triangle_count{0};
+    uint64_t vertex_count{0};
+    uint64_t transformed_count{0};
+
+    // Average cache miss ratio, transformed vertices per triangle. 0.5 is optimal for large
+    // regular meshes and 3 the worst case.
+    double get_acmr() const
+    {
+        return triangle_count > 0 ? static_cast<double>(transformed_count) / triangle_count : 0.0;
+    }
+
+    // Average transform to vertex ratio, transformed vertices per referenced vertex. 1 is
+    // optimal.
+    double get_atvr() const
+    {
+        return vertex_count > 0 ? static_cast<double>(transformed_count) / vertex_count : 0.0;
+    }
+
+    VertexCacheStats &operator+=(const VertexCacheStats &other)
+    {
+        triangle_count += other.triangle_count;
+        vertex_count += other.vertex_count;
+        transformed_count += other.transformed_count;
+        return *this;
+    }
+};
+
+constexpr uint32_t ANALYSIS_CACHE_SIZE = 16;
+
+VertexCacheStats analyze_vertex_cache(
+    std::span<const uint32_t> indices, size_t vertex_count,
+    uint32_t cache_size = ANALYSIS_CACHE_SIZE
+);
+
+// Reorders the triangles of `indices` for post-transform vertex cache locality using Tom
+// Forsyth's "Linear-Speed Vertex Cache Optimisation".
+void optimize_vertex_cache(std::span<uint32_t> indices, size_t vertex_count);
+
+// Splits the triangles of `indices`, which should already be optimized for the vertex cache,
+// into clusters at the points where the cache would be flushed anyway and sorts the clusters so
+// outward facing ones are drawn first. This reduces overdraw from any direction while keeping
+// most of the cache efficiency.
+void optimize_overdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices);
+
+// Reorders `vertices` in order of first use by `indices` and rewrites `indices` accordingly so
+// vertex fetches are close to sequential. Vertices not referenced by any index are removed.
+void optimize_vertex_fetch(std::vector<Vertex> &vertices, std::span<uint32_t> indices);
+
+// Simplifies the triangles of `indices` by collapsing edges in order of their quadric error
+// until at most `target_index_count` indices remain or no edge can be collapsed, and writes the
+// result to `out_indices`. Edges are only collapsed onto one of their vertices, so the result
+// indexes `vertices` just like the input. Vertices on open edges, i.e. on the border of the mesh
+// or on a seam of its attributes, are never moved so the outline stays intact.
+//
+// Returns an estimate of the largest distance between the simplified and the original surface.
+float simplify_mesh(
+    std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+    size_t target_index_count, std::vector<uint32_t> &out_indices
+);
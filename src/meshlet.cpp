@@ -0,0 +1,136 @@
+#include "meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/geometric.hpp>
+
+namespace
+{
+
+Meshlet make_meshlet(
+    std::span<const uint32_t> indices, std::span<const Vertex> vertices, size_t first_triangle,
+    size_t triangle_count
+)
+{
+    std::span<const uint32_t> meshlet_indices =
+        indices.subspan(3 * first_triangle, 3 * triangle_count);
+
+    BoundingBox box{
+        .min = glm::vec3(std::numeric_limits<float>::max()),
+        .max = glm::vec3(std::numeric_limits<float>::lowest()),
+    };
+    for (uint32_t index : meshlet_indices)
+    {
+        box.min = glm::min(box.min, vertices[index].position);
+        box.max = glm::max(box.max, vertices[index].position);
+    }
+
+    // The axis is the average of the unit normals, the cone has to reach the normal furthest
+    // away from it. Degenerate triangles have no normal and can not face the camera either.
+    std::vector<glm::vec3> normals;
+    normals.reserve(triangle_count);
+    glm::vec3 normal_sum(0.0f);
+    for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+    {
+        const glm::vec3 &a = vertices[meshlet_indices[3 * triangle + 0]].position;
+        const glm::vec3 &b = vertices[meshlet_indices[3 * triangle + 1]].position;
+        const glm::vec3 &c = vertices[meshlet_indices[3 * triangle + 2]].position;
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float length = glm::length(normal);
+        if (length > 0.0f)
+        {
+            normals.emplace_back(normal * (1.0f / length));
+            normal_sum = normal_sum + normals.back();
+        }
+    }
+
+    glm::vec3 cone_axis(0.0f, 0.0f, 1.0f);
+    float cone_cutoff = 1.0f;
+    float axis_length = glm::length(normal_sum);
+    if (axis_length > 0.0f)
+    {
+        cone_axis = normal_sum * (1.0f / axis_length);
+
+        float min_dot = 1.0f;
+        for (const glm::vec3 &normal : normals)
+        {
+            min_dot = std::min(min_dot, glm::dot(normal, cone_axis));
+        }
+
+        // The cone test compares against the sine of the cone's half angle.
+        if (min_dot > 0.0f)
+        {
+            cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+        }
+    }
+
+    return Meshlet{
+        .index_offset = static_cast<uint32_t>(3 * first_triangle),
+        .index_count = static_cast<uint32_t>(3 * triangle_count),
+        .bounding_sphere = compute_bounding_sphere(box),
+        .cone_axis = cone_axis,
+        .cone_cutoff = cone_cutoff,
+    };
+}
+
+} // namespace
+
+void build_meshlets(
+    std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+    std::vector<Meshlet> &out_meshlets
+)
+{
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+    {
+        return;
+    }
+
+    // Meshlet in which each vertex was last seen, plus one so zero means never.
+    std::vector<uint32_t> vertex_meshlet(vertices.size(), 0);
+    uint32_t meshlet_id = 1;
+
+    size_t first_triangle = 0;
+    uint32_t vertex_count = 0;
+    for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+    {
+        uint32_t new_vertices = 0;
+        for (size_t corner = 0; corner < 3; ++corner)
+        {
+            uint32_t index = indices[3 * triangle + corner];
+            bool repeated = (corner > 0 && index == indices[3 * triangle]) ||
+                            (corner > 1 && index == indices[3 * triangle + 1]);
+            if (vertex_meshlet[index] != meshlet_id && !repeated)
+            {
+                ++new_vertices;
+            }
+        }
+
+        if (vertex_count + new_vertices > MESHLET_MAX_VERTICES ||
+            triangle - first_triangle == MESHLET_MAX_TRIANGLES)
+        {
+            out_meshlets.emplace_back(
+                make_meshlet(indices, vertices, first_triangle, triangle - first_triangle)
+            );
+            first_triangle = triangle;
+            vertex_count = 0;
+            ++meshlet_id;
+        }
+
+        for (size_t corner = 0; corner < 3; ++corner)
+        {
+            uint32_t index = indices[3 * triangle + corner];
+            if (vertex_meshlet[index] != meshlet_id)
+            {
+                vertex_meshlet[index] = meshlet_id;
+                ++vertex_count;
+            }
+        }
+    }
+
+    out_meshlets.emplace_back(
+        make_meshlet(indices, vertices, first_triangle, triangle_count - first_triangle)
+    );
+}
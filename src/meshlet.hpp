@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "culling.hpp"
+#include "vertex.hpp"
+
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// Contiguous range of a mesh's triangles together with the bounds used to cull it.
+//
+// The normal cone encloses the normals of all triangles of the meshlet. Seen from `eye`, every
+// triangle of the meshlet faces away if
+// `dot(center - eye, cone_axis) >= cone_cutoff * length(center - eye) + radius`. A cutoff of 1
+// disables the test for meshlets whose normals spread over more than a hemisphere.
+struct Meshlet
+{
+    // Relative to the first index of the mesh.
+    uint32_t index_offset;
+    uint32_t index_count;
+    BoundingSphere bounding_sphere;
+    glm::vec3 cone_axis;
+    float cone_cutoff;
+};
+static_assert(sizeof(Meshlet) == 40);
+
+// Splits the triangles of `indices` in order into meshlets of at most `MESHLET_MAX_VERTICES`
+// unique vertices and `MESHLET_MAX_TRIANGLES` triangles and appends them to `out_meshlets`. The
+// triangles should already be optimized for the vertex cache so consecutive ones are close.
+void build_meshlets(
+    std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+    std::vector<Meshlet> &out_meshlets
+);
@@ -0,0 +1,137 @@
+#include "mipmap.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+
+#include "cpu_profiler.hpp"
+
+namespace
+{
+
+constexpr size_t LINEAR_TO_SRGB_STEPS = 4096;
+
+struct SRGBTables
+{
+    std::array<float, 256> to_linear;
+    std::array<uint8_t, LINEAR_TO_SRGB_STEPS + 1> to_srgb;
+
+    SRGBTables()
+    {
+        for (size_t i = 0; i < to_linear.size(); ++i)
+        {
+            float c = static_cast<float>(i) / 255.0f;
+            to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (size_t i = 0; i < to_srgb.size(); ++i)
+        {
+            float l = static_cast<float>(i) / static_cast<float>(LINEAR_TO_SRGB_STEPS);
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            to_srgb[i] = static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+    }
+};
+
+const SRGBTables &get_srgb_tables()
+{
+    static const SRGBTables tables;
+    return tables;
+}
+
+void downsample(
+    const SRGBTables *tables, const uint8_t *src, VkExtent3D src_extent, uint8_t *dst,
+    VkExtent3D dst_extent
+)
+{
+    for (uint32_t y = 0; y < dst_extent.height; ++y)
+    {
+        uint32_t y0 = std::min(y * 2, src_extent.height - 1);
+        uint32_t y1 = std::min(y * 2 + 1, src_extent.height - 1);
+        for (uint32_t x = 0; x < dst_extent.width; ++x)
+        {
+            uint32_t x0 = std::min(x * 2, src_extent.width - 1);
+            uint32_t x1 = std::min(x * 2 + 1, src_extent.width - 1);
+
+            const std::array<const uint8_t *, 4> texels{
+                src + (static_cast<size_t>(y0) * src_extent.width + x0) * 4,
+                src + (static_cast<size_t>(y0) * src_extent.width + x1) * 4,
+                src + (static_cast<size_t>(y1) * src_extent.width + x0) * 4,
+                src + (static_cast<size_t>(y1) * src_extent.width + x1) * 4,
+            };
+
+            uint8_t *out = dst + (static_cast<size_t>(y) * dst_extent.width + x) * 4;
+            for (size_t c = 0; c < 4; ++c)
+            {
+                if (tables != nullptr && c < 3)
+                {
+                    float sum = 0.0f;
+                    for (const uint8_t *texel : texels)
+                    {
+                        sum += tables->to_linear[texel[c]];
+                    }
+                    size_t idx = static_cast<size_t>(sum * 0.25f * LINEAR_TO_SRGB_STEPS + 0.5f);
+                    out[c] = tables->to_srgb[std::min(idx, LINEAR_TO_SRGB_STEPS)];
+                }
+                else
+                {
+                    uint32_t sum = 0;
+                    for (const uint8_t *texel : texels)
+                    {
+                        sum += texel[c];
+                    }
+                    out[c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+uint32_t get_mip_level_count(VkExtent3D extent)
+{
+    return static_cast<uint32_t>(std::bit_width(std::max(extent.width, extent.height)));
+}
+
+VkExtent3D get_mip_extent(VkExtent3D extent, uint32_t level)
+{
+    return VkExtent3D{
+        .width = std::max(extent.width >> level, 1u),
+        .height = std::max(extent.height >> level, 1u),
+        .depth = 1,
+    };
+}
+
+void generate_mip_chain(
+    VkExtent3D extent, bool srgb, std::vector<std::byte> &data,
+    std::vector<VkDeviceSize> &out_mip_offsets
+)
+{
+    CPU_ZONE("generate_mip_chain");
+
+    uint32_t level_count = get_mip_level_count(extent);
+
+    out_mip_offsets.resize(level_count);
+    size_t total_size = 0;
+    for (uint32_t level = 0; level < level_count; ++level)
+    {
+        VkExtent3D level_extent = get_mip_extent(extent, level);
+        out_mip_offsets[level] = total_size;
+        total_size += static_cast<size_t>(level_extent.width) * level_extent.height * 4;
+    }
+    data.resize(total_size);
+
+    const SRGBTables *tables = srgb ? &get_srgb_tables() : nullptr;
+    auto *texels = reinterpret_cast<uint8_t *>(data.data());
+    for (uint32_t level = 1; level < level_count; ++level)
+    {
+        downsample(
+            tables,
+            texels + out_mip_offsets[level - 1],
+            get_mip_extent(extent, level - 1),
+            texels + out_mip_offsets[level],
+            get_mip_extent(extent, level)
+        );
+    }
+}
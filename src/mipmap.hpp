@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+uint32_t get_mip_level_count(VkExtent3D extent);
+
+VkExtent3D get_mip_extent(VkExtent3D extent, uint32_t level);
+
+// Appends every mip level below the first one to `data`, which must start with the first level
+// as tightly packed RGBA8 texels. If `srgb` is set, color channels are averaged in linear space,
+// alpha is always averaged as is. The offset of each level in `data` is written to
+// `out_mip_offsets`.
+void generate_mip_chain(
+    VkExtent3D extent, bool srgb, std::vector<std::byte> &data,
+    std::vector<VkDeviceSize> &out_mip_offsets
+);
@@ -0,0 +1,548 @@
+#include "occlusion_buffer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec2.hpp>
+
+#include "cpu_profiler.hpp"
+
+static_assert(OcclusionBuffer::WIDTH % 8 == 0, "rows are processed 8 pixels at a time");
+static_assert(OcclusionBuffer::HEIGHT % OcclusionBuffer::BIN_HEIGHT == 0);
+
+// Triangles are clipped to this multiple of the screen in x and y besides the near plane, which
+// keeps edge functions precise without clipping against the screen edges.
+static constexpr float GUARD_BAND = 2.0f;
+
+// Clip space planes a point `p` is inside of if `dot(plane, p) >= 0`, near plane first.
+static constexpr std::array<glm::vec4, 5> CLIP_PLANES = {
+    glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+    glm::vec4(1.0f, 0.0f, 0.0f, GUARD_BAND),
+    glm::vec4(-1.0f, 0.0f, 0.0f, GUARD_BAND),
+    glm::vec4(0.0f, 1.0f, 0.0f, GUARD_BAND),
+    glm::vec4(0.0f, -1.0f, 0.0f, GUARD_BAND),
+};
+
+// Screen space position of a clip space point, with the reciprocal w as its depth. The first row
+// of the buffer is the top of the screen.
+static glm::vec3 to_screen(const glm::vec4 &clip)
+{
+    float inv_w = 1.0f / clip.w;
+    return glm::vec3(
+        (clip.x * inv_w * 0.5f + 0.5f) * static_cast<float>(OcclusionBuffer::WIDTH),
+        (0.5f - clip.y * inv_w * 0.5f) * static_cast<float>(OcclusionBuffer::HEIGHT),
+        inv_w
+    );
+}
+
+// Edge function of the edge from `a` to `b`, positive on the left of it.
+static glm::vec3 make_edge(const glm::vec3 &a, const glm::vec3 &b)
+{
+    return glm::vec3(a.y - b.y, b.x - a.x, a.x * b.y - a.y * b.x);
+}
+
+static void add_triangle(
+    const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2,
+    std::vector<OcclusionBuffer::Triangle> &out_triangles
+)
+{
+    // Occluders are rasterized from both sides, so only the winding is normalized.
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (std::abs(area) < 1e-4f)
+    {
+        return;
+    }
+    float sign = area > 0.0f ? 1.0f : -1.0f;
+
+    std::array<glm::vec3, 3> edges = {
+        make_edge(v1, v2) * sign,
+        make_edge(v2, v0) * sign,
+        make_edge(v0, v1) * sign,
+    };
+    // The edge functions divided by the area are the barycentric coordinates.
+    glm::vec3 depth_plane = (edges[0] * v0.z + edges[1] * v1.z + edges[2] * v2.z) / (area * sign);
+
+    // Pixels are covered if their center is inside the triangle.
+    glm::vec3 min = glm::min(glm::min(v0, v1), v2);
+    glm::vec3 max = glm::max(glm::max(v0, v1), v2);
+    OcclusionBuffer::Triangle triangle{
+        .edges = edges,
+        .depth_plane = depth_plane,
+        .min_x = std::max(static_cast<int32_t>(std::ceil(min.x - 0.5f)), 0),
+        .min_y = std::max(static_cast<int32_t>(std::ceil(min.y - 0.5f)), 0),
+        .max_x = std::min(
+            static_cast<int32_t>(std::floor(max.x - 0.5f)),
+            static_cast<int32_t>(OcclusionBuffer::WIDTH) - 1
+        ),
+        .max_y = std::min(
+            static_cast<int32_t>(std::floor(max.y - 0.5f)),
+            static_cast<int32_t>(OcclusionBuffer::HEIGHT) - 1
+        ),
+    };
+    if (triangle.min_x <= triangle.max_x && triangle.min_y <= triangle.max_y)
+    {
+        out_triangles.emplace_back(triangle);
+    }
+}
+
+#if defined(__AVX__)
+
+static constexpr int32_t LANE_COUNT = 8;
+
+// Rasterizes the pixels `first_x` to `last_x` of the row at `y`, `first_x` must be a multiple of
+// `LANE_COUNT`.
+static void rasterize_span(
+    const OcclusionBuffer::Triangle &triangle, float *row, int32_t first_x, int32_t last_x,
+    float y
+)
+{
+    const std::array<glm::vec3, 3> &edges = triangle.edges;
+    const glm::vec3 &plane = triangle.depth_plane;
+    __m256 e0_x = _mm256_set1_ps(edges[0].x);
+    __m256 e1_x = _mm256_set1_ps(edges[1].x);
+    __m256 e2_x = _mm256_set1_ps(edges[2].x);
+    __m256 e0_c = _mm256_set1_ps(edges[0].y * y + edges[0].z);
+    __m256 e1_c = _mm256_set1_ps(edges[1].y * y + edges[1].z);
+    __m256 e2_c = _mm256_set1_ps(edges[2].y * y + edges[2].z);
+    __m256 depth_x = _mm256_set1_ps(plane.x);
+    __m256 depth_c = _mm256_set1_ps(plane.y * y + plane.z);
+    __m256 zero = _mm256_setzero_ps();
+
+    __m256 x = _mm256_add_ps(
+        _mm256_set1_ps(static_cast<float>(first_x)),
+        _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f)
+    );
+    __m256 step = _mm256_set1_ps(static_cast<float>(LANE_COUNT));
+    for (int32_t px = first_x; px <= last_x; px += LANE_COUNT)
+    {
+        __m256 inside = _mm256_and_ps(
+            _mm256_and_ps(
+                _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(e0_x, x), e0_c), zero, _CMP_GE_OQ),
+                _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(e1_x, x), e1_c), zero, _CMP_GE_OQ)
+            ),
+            _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(e2_x, x), e2_c), zero, _CMP_GE_OQ)
+        );
+        // Pixels outside the triangle keep their depth since it is never below zero.
+        __m256 depth = _mm256_and_ps(inside, _mm256_add_ps(_mm256_mul_ps(depth_x, x), depth_c));
+        _mm256_storeu_ps(row + px, _mm256_max_ps(_mm256_loadu_ps(row + px), depth));
+        x = _mm256_add_ps(x, step);
+    }
+}
+
+// Whether any pixel from `first_x` to `last_x` of `row` is not closer than `depth`.
+static bool is_span_visible(const float *row, int32_t first_x, int32_t last_x, float depth)
+{
+    __m256 first = _mm256_set1_ps(static_cast<float>(first_x));
+    __m256 last = _mm256_set1_ps(static_cast<float>(last_x));
+    __m256 object_depth = _mm256_set1_ps(depth);
+    __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    for (int32_t px = first_x & ~(LANE_COUNT - 1); px <= last_x; px += LANE_COUNT)
+    {
+        __m256 x = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(px)), lanes);
+        __m256 in_span =
+            _mm256_and_ps(_mm256_cmp_ps(x, first, _CMP_GE_OQ), _mm256_cmp_ps(x, last, _CMP_LE_OQ));
+        __m256 visible = _mm256_cmp_ps(_mm256_loadu_ps(row + px), object_depth, _CMP_LE_OQ);
+        if (_mm256_movemask_ps(_mm256_and_ps(in_span, visible)) != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+#elif defined(__SSE__) || defined(_M_X64)
+
+static constexpr int32_t LANE_COUNT = 4;
+
+// Rasterizes the pixels `first_x` to `last_x` of the row at `y`, `first_x` must be a multiple of
+// `LANE_COUNT`.
+static void rasterize_span(
+    const OcclusionBuffer::Triangle &triangle, float *row, int32_t first_x, int32_t last_x,
+    float y
+)
+{
+    const std::array<glm::vec3, 3> &edges = triangle.edges;
+    const glm::vec3 &plane = triangle.depth_plane;
+    __m128 e0_x = _mm_set1_ps(edges[0].x);
+    __m128 e1_x = _mm_set1_ps(edges[1].x);
+    __m128 e2_x = _mm_set1_ps(edges[2].x);
+    __m128 e0_c = _mm_set1_ps(edges[0].y * y + edges[0].z);
+    __m128 e1_c = _mm_set1_ps(edges[1].y * y + edges[1].z);
+    __m128 e2_c = _mm_set1_ps(edges[2].y * y + edges[2].z);
+    __m128 depth_x = _mm_set1_ps(plane.x);
+    __m128 depth_c = _mm_set1_ps(plane.y * y + plane.z);
+    __m128 zero = _mm_setzero_ps();
+
+    __m128 x = _mm_add_ps(
+        _mm_set1_ps(static_cast<float>(first_x)),
+        _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f)
+    );
+    __m128 step = _mm_set1_ps(static_cast<float>(LANE_COUNT));
+    for (int32_t px = first_x; px <= last_x; px += LANE_COUNT)
+    {
+        __m128 inside = _mm_and_ps(
+            _mm_and_ps(
+                _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e0_x, x), e0_c), zero),
+                _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e1_x, x), e1_c), zero)
+            ),
+            _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e2_x, x), e2_c), zero)
+        );
+        // Pixels outside the triangle keep their depth since it is never below zero.
+        __m128 depth = _mm_and_ps(inside, _mm_add_ps(_mm_mul_ps(depth_x, x), depth_c));
+        _mm_storeu_ps(row + px, _mm_max_ps(_mm_loadu_ps(row + px), depth));
+        x = _mm_add_ps(x, step);
+    }
+}
+
+// Whether any pixel from `first_x` to `last_x` of `row` is not closer than `depth`.
+static bool is_span_visible(const float *row, int32_t first_x, int32_t last_x, float depth)
+{
+    __m128 first = _mm_set1_ps(static_cast<float>(first_x));
+    __m128 last = _mm_set1_ps(static_cast<float>(last_x));
+    __m128 object_depth = _mm_set1_ps(depth);
+    __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    for (int32_t px = first_x & ~(LANE_COUNT - 1); px <= last_x; px += LANE_COUNT)
+    {
+        __m128 x = _mm_add_ps(_mm_set1_ps(static_cast<float>(px)), lanes);
+        __m128 in_span = _mm_and_ps(_mm_cmpge_ps(x, first), _mm_cmple_ps(x, last));
+        __m128 visible = _mm_cmple_ps(_mm_loadu_ps(row + px), object_depth);
+        if (_mm_movemask_ps(_mm_and_ps(in_span, visible)) != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+#else
+
+static constexpr int32_t LANE_COUNT = 1;
+
+// Rasterizes the pixels `first_x` to `last_x` of the row at `y`.
+static void rasterize_span(
+    const OcclusionBuffer::Triangle &triangle, float *row, int32_t first_x, int32_t last_x,
+    float y
+)
+{
+    const std::array<glm::vec3, 3> &edges = triangle.edges;
+    for (int32_t px = first_x; px <= last_x; ++px)
+    {
+        glm::vec3 pixel(static_cast<float>(px) + 0.5f, y, 1.0f);
+        if (glm::dot(edges[0], pixel) >= 0.0f && glm::dot(edges[1], pixel) >= 0.0f &&
+            glm::dot(edges[2], pixel) >= 0.0f)
+        {
+            row[px] = std::max(row[px], glm::dot(triangle.depth_plane, pixel));
+        }
+    }
+}
+
+// Whether any pixel from `first_x` to `last_x` of `row` is not closer than `depth`.
+static bool is_span_visible(const float *row, int32_t first_x, int32_t last_x, float depth)
+{
+    return std::any_of(row + first_x, row + last_x + 1, [&](float d) { return d <= depth; });
+}
+
+#endif
+
+void OcclusionBuffer::cull(
+    ThreadPool &thread_pool, const Scene &scene, std::vector<uint32_t> &visible_objects
+)
+{
+    CPU_ZONE("OcclusionBuffer::cull");
+    auto start = std::chrono::steady_clock::now();
+
+    m_view_proj = scene.camera.get_matrix();
+    m_stats = OcclusionStats{};
+    m_stats.tested_count = static_cast<uint32_t>(visible_objects.size());
+
+    select_occluders(scene, visible_objects);
+    m_stats.occluder_count = static_cast<uint32_t>(m_occluders.size());
+    if (m_occluders.empty())
+    {
+        auto end = std::chrono::steady_clock::now();
+        m_stats.time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+        return;
+    }
+
+    // Occluders are distributed round-robin since the largest come first.
+    size_t setup_task_count =
+        std::min(m_occluders.size(), std::max<size_t>(thread_pool.get_thread_count(), 1));
+    m_triangles.resize(setup_task_count);
+    thread_pool.run(setup_task_count, [&](size_t task) {
+        CPU_ZONE("set up occluders");
+        std::vector<Triangle> &triangles = m_triangles[task];
+        triangles.clear();
+        std::vector<glm::vec4> clip_positions;
+        for (size_t i = task; i < m_occluders.size(); i += setup_task_count)
+        {
+            size_t mesh_idx = scene.objects[m_occluders[i]].mesh_idx;
+            setup_triangles(scene.occluders[mesh_idx], clip_positions, triangles);
+        }
+    });
+    for (const std::vector<Triangle> &triangles : m_triangles)
+    {
+        m_stats.triangle_count += static_cast<uint32_t>(triangles.size());
+    }
+
+    thread_pool.run(HEIGHT / BIN_HEIGHT, [&](size_t bin) {
+        CPU_ZONE("rasterize occluders");
+        rasterize_bin(static_cast<uint32_t>(bin));
+    });
+
+    m_visible.resize(visible_objects.size());
+    size_t test_task_count = (visible_objects.size() + OBJECTS_PER_TASK - 1) / OBJECTS_PER_TASK;
+    thread_pool.run(test_task_count, [&](size_t task) {
+        CPU_ZONE("test occludees");
+        size_t first = task * OBJECTS_PER_TASK;
+        size_t last = std::min(first + OBJECTS_PER_TASK, visible_objects.size());
+        for (size_t i = first; i < last; ++i)
+        {
+            const Mesh &mesh = scene.meshes[scene.objects[visible_objects[i]].mesh_idx];
+            m_visible[i] = is_box_visible(mesh.bounding_box) ? 1 : 0;
+        }
+    });
+
+    size_t visible_count = 0;
+    for (size_t i = 0; i < visible_objects.size(); ++i)
+    {
+        if (m_visible[i] != 0)
+        {
+            visible_objects[visible_count++] = visible_objects[i];
+        }
+    }
+    m_stats.occluded_count = static_cast<uint32_t>(visible_objects.size() - visible_count);
+    visible_objects.resize(visible_count);
+
+    auto end = std::chrono::steady_clock::now();
+    m_stats.time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void OcclusionBuffer::select_occluders(
+    const Scene &scene, std::span<const uint32_t> visible_objects
+)
+{
+    // Objects are ranked by the angular size of their bounding sphere, those around the eye
+    // cover the whole screen.
+    m_candidates.clear();
+    glm::vec3 eye = scene.camera.eye;
+    for (uint32_t object_idx : visible_objects)
+    {
+        size_t mesh_idx = scene.objects[object_idx].mesh_idx;
+        if (scene.occluders[mesh_idx].empty())
+        {
+            continue;
+        }
+
+        const BoundingSphere &sphere = scene.meshes[mesh_idx].bounding_sphere;
+        float distance = glm::length(sphere.center - eye);
+        float size = distance > sphere.radius ? sphere.radius / distance
+                                              : std::numeric_limits<float>::max();
+        m_candidates.emplace_back(size, object_idx);
+    }
+
+    size_t count = std::min<size_t>(m_candidates.size(), MAX_OCCLUDERS);
+    std::partial_sort(
+        m_candidates.begin(),
+        m_candidates.begin() + count,
+        m_candidates.end(),
+        std::greater<>()
+    );
+
+    m_occluders.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        m_occluders.emplace_back(m_candidates[i].second);
+    }
+}
+
+void OcclusionBuffer::setup_triangles(
+    const OccluderMesh &mesh, std::vector<glm::vec4> &clip_positions,
+    std::vector<Triangle> &out_triangles
+) const
+{
+    clip_positions.resize(mesh.positions.size());
+    for (size_t i = 0; i < mesh.positions.size(); ++i)
+    {
+        clip_positions[i] = m_view_proj * glm::vec4(mesh.positions[i], 1.0f);
+    }
+
+    // Clipping a triangle against each plane adds at most one vertex.
+    std::array<glm::vec4, 3 + CLIP_PLANES.size()> polygon;
+    std::array<glm::vec4, 3 + CLIP_PLANES.size()> clipped;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        polygon[0] = clip_positions[mesh.indices[i]];
+        polygon[1] = clip_positions[mesh.indices[i + 1]];
+        polygon[2] = clip_positions[mesh.indices[i + 2]];
+        size_t vertex_count = 3;
+
+        // Sutherland-Hodgman, skipped for planes the triangle is completely inside of.
+        for (const glm::vec4 &plane : CLIP_PLANES)
+        {
+            bool inside = true;
+            for (size_t j = 0; j < vertex_count; ++j)
+            {
+                inside = inside && glm::dot(plane, polygon[j]) >= 0.0f;
+            }
+            if (inside)
+            {
+                continue;
+            }
+
+            size_t clipped_count = 0;
+            for (size_t j = 0; j < vertex_count; ++j)
+            {
+                const glm::vec4 &a = polygon[j];
+                const glm::vec4 &b = polygon[(j + 1) % vertex_count];
+                float da = glm::dot(plane, a);
+                float db = glm::dot(plane, b);
+                if (da >= 0.0f)
+                {
+                    clipped[clipped_count++] = a;
+                }
+                if ((da >= 0.0f) != (db >= 0.0f))
+                {
+                    clipped[clipped_count++] = a + (b - a) * (da / (da - db));
+                }
+            }
+            polygon = clipped;
+            vertex_count = clipped_count;
+            if (vertex_count < 3)
+            {
+                break;
+            }
+        }
+        if (vertex_count < 3)
+        {
+            continue;
+        }
+
+        glm::vec3 first = to_screen(polygon[0]);
+        glm::vec3 previous = to_screen(polygon[1]);
+        for (size_t j = 2; j < vertex_count; ++j)
+        {
+            glm::vec3 current = to_screen(polygon[j]);
+            add_triangle(first, previous, current, out_triangles);
+            previous = current;
+        }
+    }
+}
+
+void OcclusionBuffer::rasterize_bin(uint32_t bin)
+{
+    int32_t first_row = static_cast<int32_t>(bin * BIN_HEIGHT);
+    int32_t last_row = first_row + static_cast<int32_t>(BIN_HEIGHT) - 1;
+    std::fill(
+        m_depth.begin() + first_row * WIDTH,
+        m_depth.begin() + (last_row + 1) * WIDTH,
+        0.0f
+    );
+
+    for (const std::vector<Triangle> &triangles : m_triangles)
+    {
+        for (const Triangle &triangle : triangles)
+        {
+            int32_t min_y = std::max(triangle.min_y, first_row);
+            int32_t max_y = std::min(triangle.max_y, last_row);
+            int32_t min_x = triangle.min_x & ~(LANE_COUNT - 1);
+            for (int32_t y = min_y; y <= max_y; ++y)
+            {
+                float *row = &m_depth[y * WIDTH];
+                rasterize_span(triangle, row, min_x, triangle.max_x, static_cast<float>(y) + 0.5f);
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::is_box_visible(const BoundingBox &box) const
+{
+    // The reciprocal w is largest at one of the corners, so the box is hidden if every pixel of
+    // its screen space bounds holds an occluder closer than that.
+    glm::vec2 min(std::numeric_limits<float>::max());
+    glm::vec2 max(std::numeric_limits<float>::lowest());
+    float closest = 0.0f;
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        glm::vec3 corner(
+            (i & 1) != 0 ? box.max.x : box.min.x,
+            (i & 2) != 0 ? box.max.y : box.min.y,
+            (i & 4) != 0 ? box.max.z : box.min.z
+        );
+        glm::vec4 clip = m_view_proj * glm::vec4(corner, 1.0f);
+        // Boxes reaching past the near plane are never hidden.
+        if (clip.z < -clip.w)
+        {
+            return true;
+        }
+
+        glm::vec3 screen = to_screen(clip);
+        min = glm::min(min, glm::vec2(screen));
+        max = glm::max(max, glm::vec2(screen));
+        closest = std::max(closest, screen.z);
+    }
+
+    // Frustum culling keeps boxes that only touch the screen through imprecision.
+    if (max.x < 0.0f || max.y < 0.0f || min.x >= static_cast<float>(WIDTH) ||
+        min.y >= static_cast<float>(HEIGHT))
+    {
+        return true;
+    }
+    int32_t first_x = static_cast<int32_t>(std::max(min.x, 0.0f));
+    int32_t first_y = static_cast<int32_t>(std::max(min.y, 0.0f));
+    int32_t last_x = static_cast<int32_t>(std::min(max.x, static_cast<float>(WIDTH - 1)));
+    int32_t last_y = static_cast<int32_t>(std::min(max.y, static_cast<float>(HEIGHT - 1)));
+
+    for (int32_t y = first_y; y <= last_y; ++y)
+    {
+        if (is_span_visible(&m_depth[y * WIDTH], first_x, last_x, closest))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+OccluderMesh build_occluder_mesh(
+    std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+    std::span<const MeshLod> lods, const BoundingSphere &sphere
+)
+{
+    OccluderMesh occluder;
+    for (const MeshLod &lod : lods)
+    {
+        if (lod.error > OcclusionBuffer::MAX_OCCLUDER_ERROR * sphere.radius)
+        {
+            break;
+        }
+        if (lod.index_count / 3 > OcclusionBuffer::MAX_OCCLUDER_TRIANGLES)
+        {
+            continue;
+        }
+
+        std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+        occluder.indices.reserve(lod.index_count);
+        for (uint32_t index : indices.subspan(lod.index_offset, lod.index_count))
+        {
+            uint32_t &mapped = remap[index];
+            if (mapped == UINT32_MAX)
+            {
+                mapped = static_cast<uint32_t>(occluder.positions.size());
+                occluder.positions.emplace_back(vertices[index].position);
+            }
+            occluder.indices.emplace_back(mapped);
+        }
+        break;
+    }
+    return occluder;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "culling.hpp"
+#include "scene.hpp"
+#include "thread_pool.hpp"
+#include "vertex.hpp"
+
+// Result of the last `OcclusionBuffer::cull`.
+struct OcclusionStats
+{
+    uint32_t occluder_count{0};
+    // Triangles left to rasterize after clipping.
+    uint32_t triangle_count{0};
+    uint32_t tested_count{0};
+    uint32_t occluded_count{0};
+    double time_ms{0.0};
+
+    // Fraction of the tested objects that were rejected.
+    double get_rejection_rate() const
+    {
+        return tested_count > 0 ? static_cast<double>(occluded_count) / tested_count : 0.0;
+    }
+};
+
+// Software occlusion culling on the CPU. The largest objects on screen that have an occluder
+// mesh are rasterized into a low resolution depth buffer, then the bounding box of every other
+// object is tested against it. Rows of the buffer are split into bins rasterized on separate
+// workers, and rows are rasterized 8 pixels at a time with AVX or 4 with SSE when compiled for
+// them.
+//
+// The buffer holds the reciprocal clip space w of the closest occluder, which is linear in
+// screen space. Zero means no occluder covers the pixel.
+class OcclusionBuffer
+{
+  public:
+    static constexpr uint32_t WIDTH = 320;
+    static constexpr uint32_t HEIGHT = 192;
+    static constexpr uint32_t BIN_HEIGHT = 16;
+    static constexpr uint32_t MAX_OCCLUDERS = 64;
+    // Occluder meshes are built from the finest level of detail with at most this many
+    // triangles.
+    static constexpr uint32_t MAX_OCCLUDER_TRIANGLES = 1024;
+    // Largest error of that level relative to the mesh's bounding radius. Coarser levels may
+    // bulge out of the mesh and hide objects that are actually visible.
+    static constexpr float MAX_OCCLUDER_ERROR = 0.01f;
+    static constexpr uint32_t OBJECTS_PER_TASK = 256;
+
+    // Triangle set up for rasterization with edge functions `dot(edge, (x, y, 1))` that are
+    // non-negative inside the triangle and the reciprocal w likewise as a plane over the screen.
+    struct Triangle
+    {
+        std::array<glm::vec3, 3> edges;
+        glm::vec3 depth_plane;
+        // Inclusive pixel bounds, clamped to the buffer.
+        int32_t min_x;
+        int32_t min_y;
+        int32_t max_x;
+        int32_t max_y;
+    };
+
+  private:
+    std::vector<float> m_depth;
+    glm::mat4 m_view_proj{1.0f};
+
+    std::vector<std::pair<float, uint32_t>> m_candidates;
+    std::vector<uint32_t> m_occluders;
+    // Set up triangles of each setup task, read by every bin.
+    std::vector<std::vector<Triangle>> m_triangles;
+    std::vector<uint8_t> m_visible;
+
+    OcclusionStats m_stats;
+
+  public:
+    OcclusionBuffer() : m_depth(WIDTH * HEIGHT, 0.0f)
+    {
+    }
+
+    const OcclusionStats &get_stats() const
+    {
+        return m_stats;
+    }
+
+    // Removes every object that is hidden behind the scene's occluders from `visible_objects`,
+    // which should already be frustum culled, keeping the order of the rest. Must not be called
+    // from a worker of `thread_pool`.
+    void cull(ThreadPool &thread_pool, const Scene &scene, std::vector<uint32_t> &visible_objects);
+
+  private:
+    void select_occluders(const Scene &scene, std::span<const uint32_t> visible_objects);
+    void setup_triangles(
+        const OccluderMesh &mesh, std::vector<glm::vec4> &clip_positions,
+        std::vector<Triangle> &out_triangles
+    ) const;
+    void rasterize_bin(uint32_t bin);
+    bool is_box_visible(const BoundingBox &box) const;
+};
+
+// Builds the occluder of a mesh from the finest of its `lods` within the limits of
+// `OcclusionBuffer`, keeping only the vertices that level uses. Returns an empty occluder if no
+// level qualifies.
+OccluderMesh build_occluder_mesh(
+    std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+    std::span<const MeshLod> lods, const BoundingSphere &sphere
+);
@@ -0,0 +1,156 @@
+#include "options.hpp"
+
+#include <charconv>
+#include <cstdio>
+#include <string_view>
+
+#include <spdlog/spdlog.h>
+
+static bool parse_uint(std::string_view str, uint32_t &out_value)
+{
+    auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), out_value);
+    return ec == std::errc() && ptr == str.data() + str.size();
+}
+
+[[nodiscard]] bool parse_options(int argc, char **argv, Options &out_options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg(argv[i]);
+
+        if (arg == "--help" || arg == "-h")
+        {
+            out_options.show_help = true;
+            continue;
+        }
+
+        if (arg == "--headless")
+        {
+            out_options.headless = true;
+            continue;
+        }
+
+        if (arg == "--gpu-culling")
+        {
+            out_options.gpu_culling = true;
+            continue;
+        }
+
+        if (arg == "--occlusion-culling")
+        {
+            out_options.occlusion_culling = true;
+            continue;
+        }
+
+        if (arg == "--software-occlusion")
+        {
+            out_options.software_occlusion = true;
+            continue;
+        }
+
+        if (arg == "--depth-prepass")
+        {
+            out_options.depth_prepass = true;
+            continue;
+        }
+
+        if (arg == "--serial-recording")
+        {
+            out_options.parallel_recording = false;
+            continue;
+        }
+
+        if (arg == "--full-precision-vertices")
+        {
+            out_options.quantize_vertices = false;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            spdlog::error("parse_options: unknown or incomplete option `{}`", arg);
+            return false;
+        }
+        std::string_view value(argv[++i]);
+
+        bool valid = true;
+        if (arg == "--scene")
+        {
+            out_options.scene_path = value;
+        }
+        else if (arg == "--archive")
+        {
+            out_options.archive_path = value;
+        }
+        else if (arg == "--width")
+        {
+            valid = parse_uint(value, out_options.width) && out_options.width > 0;
+        }
+        else if (arg == "--height")
+        {
+            valid = parse_uint(value, out_options.height) && out_options.height > 0;
+        }
+        else if (arg == "--frames")
+        {
+            valid = parse_uint(value, out_options.frame_count) && out_options.frame_count > 0;
+        }
+        else if (arg == "--warmup")
+        {
+            valid = parse_uint(value, out_options.warmup_frame_count);
+        }
+        else if (arg == "--report")
+        {
+            out_options.report_path = value;
+        }
+        else if (arg == "--trace")
+        {
+            out_options.trace_path = value;
+        }
+        else
+        {
+            spdlog::error("parse_options: unknown option `{}`", arg);
+            return false;
+        }
+
+        if (!valid)
+        {
+            spdlog::error("parse_options: invalid value `{}` for option `{}`", value, arg);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void print_usage(const char *program)
+{
+    std::printf(
+        "usage: %s [options]\n"
+        "\n"
+        "options:\n"
+        "  --help            show this message\n"
+        "  --scene <path>    scene file to load (default: ../assets/sponza/sponza.gltf)\n"
+        "  --archive <path>  asset archive to load from if present (default: ../aurora.pack)\n"
+        "  --headless        render offscreen without a window and run the benchmark\n"
+        "  --width <px>      headless render width (default: 1280)\n"
+        "  --height <px>     headless render height (default: 720)\n"
+        "  --gpu-culling     cull meshlets in a compute pass instead of objects on the cpu\n"
+        "  --occlusion-culling\n"
+        "                    with --gpu-culling, also cull meshlets hidden behind the depth\n"
+        "                    of what was visible in the last frame\n"
+        "  --software-occlusion\n"
+        "                    without --gpu-culling, also cull objects hidden behind the largest\n"
+        "                    objects on screen, rasterized on the cpu\n"
+        "  --depth-prepass   render depth before shading so each pixel is shaded once\n"
+        "  --serial-recording\n"
+        "                    record all draws on the main thread instead of splitting them\n"
+        "                    across the worker threads\n"
+        "  --full-precision-vertices\n"
+        "                    store vertices as 32-bit floats instead of quantizing them\n"
+        "  --frames <n>      number of measured benchmark frames (default: 1000)\n"
+        "  --warmup <n>      number of unmeasured warm-up frames (default: 100)\n"
+        "  --report <path>   benchmark report output file (default: benchmark.json)\n"
+        "  --trace <path>    write a chrome trace of cpu zones to this file on exit\n",
+        program
+    );
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct Options
+{
+    bool show_help{false};
+
+    std::string scene_path{"../assets/sponza/sponza.gltf"};
+    std::string archive_path{"../aurora.pack"};
+
+    bool headless{false};
+    uint32_t width{1280};
+    uint32_t height{720};
+
+    bool gpu_culling{false};
+    // Only takes effect together with `gpu_culling`.
+    bool occlusion_culling{false};
+    // Only takes effect without `gpu_culling`.
+    bool software_occlusion{false};
+    bool depth_prepass{false};
+    // Only takes effect without `gpu_culling`.
+    bool parallel_recording{true};
+    bool quantize_vertices{true};
+
+    uint32_t frame_count{1000};
+    uint32_t warmup_frame_count{100};
+    std::string report_path{"benchmark.json"};
+
+    std::string trace_path;
+};
+
+[[nodiscard]] bool parse_options(int argc, char **argv, Options &out_options);
+
+void print_usage(const char *program);
@@ -0,0 +1,72 @@
+#include "range_allocator.hpp"
+
+#include <cassert>
+#include <iterator>
+
+void RangeAllocator::init(uint64_t capacity)
+{
+    m_free_ranges.clear();
+    if (capacity > 0)
+    {
+        m_free_ranges.emplace(0, capacity);
+    }
+    m_capacity = capacity;
+    m_used = 0;
+}
+
+[[nodiscard]] bool RangeAllocator::allocate(uint64_t size, uint64_t &out_offset)
+{
+    if (size == 0)
+    {
+        out_offset = 0;
+        return true;
+    }
+
+    for (auto it = m_free_ranges.begin(); it != m_free_ranges.end(); ++it)
+    {
+        auto [offset, free_size] = *it;
+        if (free_size < size)
+        {
+            continue;
+        }
+
+        m_free_ranges.erase(it);
+        if (free_size > size)
+        {
+            m_free_ranges.emplace(offset + size, free_size - size);
+        }
+        m_used += size;
+        out_offset = offset;
+        return true;
+    }
+
+    return false;
+}
+
+void RangeAllocator::free(uint64_t offset, uint64_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    assert(offset + size <= m_capacity);
+    m_used -= size;
+
+    auto next = m_free_ranges.lower_bound(offset);
+    if (next != m_free_ranges.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset)
+        {
+            offset = prev->first;
+            size += prev->second;
+            m_free_ranges.erase(prev);
+        }
+    }
+    if (next != m_free_ranges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        m_free_ranges.erase(next);
+    }
+    m_free_ranges.emplace(offset, size);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// First-fit allocator of ranges within `[0, capacity)`. Freed ranges are merged with adjacent
+// free ranges, so fragmentation only persists while neighbouring ranges are alive.
+class RangeAllocator
+{
+    // Offset to size of every free range.
+    std::map<uint64_t, uint64_t> m_free_ranges;
+    uint64_t m_capacity{0};
+    uint64_t m_used{0};
+
+  public:
+    void init(uint64_t capacity);
+
+    [[nodiscard]] bool allocate(uint64_t size, uint64_t &out_offset);
+    void free(uint64_t offset, uint64_t size);
+
+    uint64_t get_capacity() const
+    {
+        return m_capacity;
+    }
+
+    uint64_t get_used() const
+    {
+        return m_used;
+    }
+};
@@ -1,6 +0,0 @@
-#pragma once
-
-#include <string>
-#include <vector>
-
-std::vector<uint8_t> read_file(const std::string &path);
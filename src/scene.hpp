@@ -1,35 +1,80 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstdint>
 #include <vector>
 
 #include <vulkan/vulkan_core.h>
 
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
+#include <glm/geometric.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/trigonometric.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 
+#include "asset_cache.hpp"
+#include "bvh.hpp"
+#include "culling.hpp"
+#include "geometry_buffer.hpp"
 #include "gpu.hpp"
+#include "meshlet.hpp"
+#include "vertex.hpp"
 
-struct Vertex
+constexpr uint32_t MAX_MESH_LODS = 5;
+
+// One level of detail of a mesh. All levels share the mesh's vertices, the index and meshlet
+// ranges are relative to the first index and meshlet of the mesh.
+struct MeshLod
 {
-    glm::vec3 position;
-    float tex_coord_x;
-    glm::vec3 normal;
-    float tex_coord_y;
+    uint32_t index_offset;
+    uint32_t index_count;
+    uint32_t meshlet_offset;
+    uint32_t meshlet_count;
+    // Upper bound of the distance between this level's surface and the full detail one.
+    float error;
 };
+static_assert(sizeof(MeshLod) == 20);
 
 struct Mesh
 {
-    uint32_t index_count;
-    GPUBuffer vertex_buffer;
-    GPUBuffer index_buffer;
-    VkDeviceAddress vertex_buffer_address;
+    GeometryRange vertices;
+    // Indices of all levels of detail.
+    GeometryRange indices;
+    VkIndexType index_type;
+    BoundingBox bounding_box;
+    BoundingSphere bounding_sphere;
+
+    // Range of the scene's meshlets belonging to the mesh, of all levels of detail.
+    uint32_t meshlet_offset;
+    uint32_t meshlet_count;
+
+    // Levels of detail from full to lowest, with increasing errors.
+    std::array<MeshLod, MAX_MESH_LODS> lods;
+    uint32_t lod_count;
 
     size_t material_idx;
+
+    // Upload timeline value after which the geometry may be used for rendering.
+    uint64_t ready_value;
+
+    // Selects the lowest level of detail whose error, projected at the distance between `eye`
+    // and the bounding sphere, stays within the threshold baked into `lod_scale`. Must match
+    // the selection in cull.comp.
+    [[nodiscard]] uint32_t select_lod(const glm::vec3 &eye, float lod_scale) const
+    {
+        float distance =
+            std::max(glm::length(bounding_sphere.center - eye) - bounding_sphere.radius, 0.0f);
+        uint32_t lod = 0;
+        while (lod + 1 < lod_count && lods[lod + 1].error * lod_scale <= distance)
+        {
+            ++lod;
+        }
+        return lod;
+    }
 };
 
 struct Object
@@ -39,9 +84,61 @@ struct Object
 
 struct Material
 {
-    VkDescriptorSet diffuse_set;
-    GPUImage diffuse;
+    TextureHandle diffuse{INVALID_TEXTURE};
+
+    // Upload timeline value after which the material's entry and images may be used.
+    uint64_t ready_value;
+};
+
+// Entry of a scene's material buffer, laid out as `Material` in forward.frag (std430).
+struct GPUMaterial
+{
+    uint32_t diffuse_texture;
+};
+
+// Entry of a scene's object buffer, laid out as `Object` in cull.comp and forward.vert (std430).
+struct GPUObject
+{
+    uint32_t first_index;
+    uint32_t index_count;
+    int32_t vertex_offset;
+    uint32_t material_index;
+    glm::vec4 bounding_sphere;
+    // Dequantization transform of the mesh's positions, unused for full precision vertices.
+    glm::vec3 position_offset;
+    // 1 if the mesh has 32-bit indices, 0 if it has 16-bit indices.
+    uint32_t wide_indices;
+    glm::vec3 position_scale;
+    uint32_t padding;
+};
+
+// Entry of a scene's meshlet buffer, laid out as `Meshlet` in cull.comp (std430). There is one
+// for every meshlet of every level of detail of every object, holding everything needed to cull
+// it and write its draw.
+struct GPUMeshlet
+{
+    glm::vec4 bounding_sphere;
+    // Normal cone axis and cutoff, see `Meshlet`.
+    glm::vec4 cone;
+    // Bounding sphere of the object, the level of detail is selected for all of its meshlets
+    // together.
+    glm::vec4 lod_sphere;
+    // Relative to the start of the index buffer, like `GPUObject::first_index`.
+    uint32_t first_index;
+    uint32_t index_count;
+    int32_t vertex_offset;
+    uint32_t object_index;
+    uint32_t wide_indices;
+    // Errors of the meshlet's level of detail and of the next lower one, or the largest float
+    // for the lowest level.
+    float lod_error;
+    float coarser_lod_error;
+    uint32_t padding;
 };
+static_assert(sizeof(GPUMeshlet) == 80);
+
+// The draw counts of a scene's draw buffer are stored in front of the draws.
+constexpr VkDeviceSize DRAW_COUNTS_SIZE = 2 * sizeof(uint32_t);
 
 struct Camera
 {
@@ -53,17 +150,36 @@ struct Camera
     float z_near;
     float z_far;
 
-    [[nodiscard]] glm::mat4 get_matrix() const
+    [[nodiscard]] glm::vec3 get_forward() const
     {
-        glm::vec3 forward(
+        return glm::vec3(
             std::cos(glm::radians(this->rotation.x)) * std::cos(glm::radians(this->rotation.y)),
             std::sin(glm::radians(this->rotation.x)),
             std::cos(glm::radians(this->rotation.x)) * std::sin(glm::radians(this->rotation.y))
         );
+    }
 
-        glm::mat4 view = glm::lookAtRH(this->eye, this->eye + forward, this->up);
-        glm::mat4 proj = glm::perspectiveRH(this->fov_y, this->aspect, this->z_near, this->z_far);
-        return proj * view;
+    // Factor such that `error * lod_scale / distance` is the projected size of a world space
+    // `error` at `distance` from the eye in multiples of `max_pixel_error`, on a render target
+    // `viewport_height` pixels high.
+    [[nodiscard]] float get_lod_scale(float viewport_height, float max_pixel_error) const
+    {
+        return 0.5f * viewport_height / (std::tan(0.5f * this->fov_y) * max_pixel_error);
+    }
+
+    [[nodiscard]] glm::mat4 get_view_matrix() const
+    {
+        return glm::lookAtRH(this->eye, this->eye + get_forward(), this->up);
+    }
+
+    [[nodiscard]] glm::mat4 get_projection_matrix() const
+    {
+        return glm::perspectiveRH(this->fov_y, this->aspect, this->z_near, this->z_far);
+    }
+
+    [[nodiscard]] glm::mat4 get_matrix() const
+    {
+        return get_projection_matrix() * get_view_matrix();
     }
 };
 
@@ -73,6 +189,40 @@ struct Scene
     Camera camera;
 
     std::vector<Mesh> meshes;
+    std::vector<Meshlet> meshlets;
     std::vector<Material> materials;
     std::vector<Object> objects;
+
+    // Bounds of every entry of `objects`, culled on the CPU every frame.
+    ObjectBounds object_bounds;
+    BVH bvh;
+    // Occluder geometry of every entry of `meshes`, empty for meshes that are no good occluders.
+    std::vector<OccluderMesh> occluders;
+
+    // `GPUMaterial` for every entry of `materials`.
+    GPUBuffer material_buffer;
+    VkDeviceAddress material_buffer_address{0};
+
+    // `GPUObject` for every entry of `objects`.
+    GPUBuffer object_buffer;
+    VkDeviceAddress object_buffer_address{0};
+
+    // `GPUMeshlet` for every meshlet of every object, culled into `draw_buffer` every frame.
+    GPUBuffer meshlet_buffer;
+    VkDeviceAddress meshlet_buffer_address{0};
+    uint32_t gpu_meshlet_count{0};
+
+    // The number of visible meshlets with 16-bit and with 32-bit indices, followed by a
+    // `VkDrawIndexedIndirectCommand` for every visible meshlet. Draws of meshlets with 16-bit
+    // indices come first, followed by `gpu_meshlet_count` entries for 32-bit ones.
+    GPUBuffer draw_buffer;
+    VkDeviceAddress draw_buffer_address{0};
+
+    // Whether every entry of `meshlet_buffer` was visible in the last frame, followed by flags
+    // for every entry of `objects`, see cull.comp. Only used by occlusion culling.
+    GPUBuffer visibility_buffer;
+    VkDeviceAddress visibility_buffer_address{0};
+
+    // Upload timeline value after which all of the scene's buffers may be used for rendering.
+    uint64_t ready_value{0};
 };
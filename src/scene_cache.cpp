@@ -0,0 +1,471 @@
+#include "scene_cache.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+#include <spdlog/spdlog.h>
+
+#include <assimp/version.h>
+
+#include "cpu_profiler.hpp"
+#include "scene_import.hpp"
+
+namespace
+{
+
+constexpr std::array<char, 8> SCENE_CACHE_MAGIC = {'A', 'U', 'R', 'S', 'C', 'E', 'N', 'E'};
+
+// Must be bumped whenever the file layout, the vertex format or the import settings change.
+constexpr uint32_t SCENE_CACHE_VERSION = 4;
+
+constexpr uint64_t STREAM_ALIGNMENT = 16;
+
+struct SceneCacheHeader
+{
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t vertex_size;
+    std::array<uint32_t, 4> importer_version;
+    uint32_t dependency_count;
+    uint32_t mesh_count;
+    uint32_t material_count;
+    uint32_t object_count;
+    uint32_t meshlet_count;
+    uint32_t lod_count;
+    uint64_t vertex_count;
+    uint64_t index_count;
+    uint64_t vertex_offset;
+    uint64_t index_offset;
+};
+static_assert(sizeof(SceneCacheHeader) == 88);
+static_assert(std::is_trivially_copyable_v<Vertex>);
+static_assert(std::is_trivially_copyable_v<Meshlet>);
+static_assert(std::is_trivially_copyable_v<MeshLod>);
+
+std::array<uint32_t, 4> get_importer_version()
+{
+    return {aiGetVersionMajor(), aiGetVersionMinor(), aiGetVersionPatch(), aiGetVersionRevision()};
+}
+
+uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+class ByteWriter
+{
+    std::vector<std::byte> &m_out;
+
+  public:
+    explicit ByteWriter(std::vector<std::byte> &out) : m_out(out)
+    {
+    }
+
+    template <typename T> void write(const T &value)
+    {
+        const auto *bytes = reinterpret_cast<const std::byte *>(&value);
+        m_out.insert(m_out.end(), bytes, bytes + sizeof(T));
+    }
+
+    void write_string(const std::string &value)
+    {
+        write(static_cast<uint32_t>(value.size()));
+        const auto *bytes = reinterpret_cast<const std::byte *>(value.data());
+        m_out.insert(m_out.end(), bytes, bytes + value.size());
+    }
+};
+
+class ByteReader
+{
+    std::span<const std::byte> m_data;
+    size_t m_offset;
+
+  public:
+    ByteReader(std::span<const std::byte> data, size_t offset) : m_data(data), m_offset(offset)
+    {
+    }
+
+    template <typename T> [[nodiscard]] bool read(T &out_value)
+    {
+        if (m_data.size() - m_offset < sizeof(T))
+        {
+            return false;
+        }
+        std::memcpy(&out_value, m_data.data() + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+    }
+
+    [[nodiscard]] bool read_string(std::string &out_value)
+    {
+        uint32_t size;
+        if (!read(size) || m_data.size() - m_offset < size)
+        {
+            return false;
+        }
+        out_value.assign(reinterpret_cast<const char *>(m_data.data() + m_offset), size);
+        m_offset += size;
+        return true;
+    }
+
+    size_t get_offset() const
+    {
+        return m_offset;
+    }
+
+    // Whether `count` entries of at least `entry_size` bytes each fit into the rest of the data,
+    // so counts read from it can be checked before anything is allocated for them.
+    bool can_hold(uint64_t count, size_t entry_size) const
+    {
+        return count <= (m_data.size() - m_offset) / entry_size;
+    }
+};
+
+} // namespace
+
+std::string get_scene_cache_path(const std::string &source_path)
+{
+    return std::filesystem::path(source_path).replace_extension(".scenecache").string();
+}
+
+[[nodiscard]] bool read_scene_cache(const std::string &path, SceneData &out_scene)
+{
+    CPU_ZONE("read_scene_cache");
+
+    if constexpr (std::endian::native != std::endian::little)
+    {
+        return false;
+    }
+
+    if (!std::filesystem::exists(path))
+    {
+        spdlog::info("read_scene_cache: no scene cache at {}", path);
+        return false;
+    }
+
+    MappedFile file;
+    if (!file.open(path))
+    {
+        spdlog::warn("read_scene_cache: failed to map scene cache {}", path);
+        return false;
+    }
+    std::span<const std::byte> data = file.get_data();
+
+    SceneCacheHeader header;
+    ByteReader reader(data, 0);
+    if (!reader.read(header) || header.magic != SCENE_CACHE_MAGIC)
+    {
+        spdlog::warn("read_scene_cache: {} is not a scene cache", path);
+        return false;
+    }
+    if (header.version != SCENE_CACHE_VERSION || header.vertex_size != sizeof(Vertex) ||
+        header.importer_version != get_importer_version())
+    {
+        spdlog::info("read_scene_cache: {} was written by a different version", path);
+        return false;
+    }
+
+    // A dependency is at least its path's length followed by its size and modification time.
+    if (!reader.can_hold(
+            header.dependency_count,
+            sizeof(uint32_t) + sizeof(uint64_t) + sizeof(int64_t)
+        ))
+    {
+        spdlog::warn("read_scene_cache: {} is truncated", path);
+        return false;
+    }
+    std::vector<SceneDependency> dependencies(header.dependency_count);
+    for (SceneDependency &dependency : dependencies)
+    {
+        if (!reader.read_string(dependency.path) || !reader.read(dependency.size) ||
+            !reader.read(dependency.modification_time))
+        {
+            spdlog::warn("read_scene_cache: {} is truncated", path);
+            return false;
+        }
+
+        SceneDependency current;
+        if (!get_scene_dependency(dependency.path, current) || current.size != dependency.size ||
+            current.modification_time != dependency.modification_time)
+        {
+            spdlog::info("read_scene_cache: {} is out of date with {}", path, dependency.path);
+            return false;
+        }
+    }
+
+    if (!reader.can_hold(header.mesh_count, sizeof(SceneMesh)))
+    {
+        spdlog::warn("read_scene_cache: {} is truncated", path);
+        return false;
+    }
+    std::vector<SceneMesh> meshes(header.mesh_count);
+    for (SceneMesh &mesh : meshes)
+    {
+        if (!reader.read(mesh.vertex_offset) || !reader.read(mesh.vertex_count) ||
+            !reader.read(mesh.index_offset) || !reader.read(mesh.index_count) ||
+            !reader.read(mesh.meshlet_offset) || !reader.read(mesh.meshlet_count) ||
+            !reader.read(mesh.lod_offset) || !reader.read(mesh.lod_count) ||
+            !reader.read(mesh.material_idx))
+        {
+            spdlog::warn("read_scene_cache: {} is truncated", path);
+            return false;
+        }
+
+        if (mesh.vertex_count > header.vertex_count ||
+            mesh.vertex_offset > header.vertex_count - mesh.vertex_count ||
+            mesh.index_count > header.index_count ||
+            mesh.index_offset > header.index_count - mesh.index_count ||
+            mesh.meshlet_count > header.meshlet_count ||
+            mesh.meshlet_offset > header.meshlet_count - mesh.meshlet_count ||
+            mesh.lod_count == 0 || mesh.lod_count > MAX_MESH_LODS ||
+            mesh.lod_count > header.lod_count ||
+            mesh.lod_offset > header.lod_count - mesh.lod_count ||
+            mesh.material_idx >= header.material_count)
+        {
+            spdlog::warn("read_scene_cache: {} has an invalid mesh", path);
+            return false;
+        }
+    }
+
+    if (!reader.can_hold(header.meshlet_count, sizeof(Meshlet)))
+    {
+        spdlog::warn("read_scene_cache: {} is truncated", path);
+        return false;
+    }
+    std::vector<Meshlet> meshlets(header.meshlet_count);
+    for (Meshlet &meshlet : meshlets)
+    {
+        if (!reader.read(meshlet))
+        {
+            spdlog::warn("read_scene_cache: {} is truncated", path);
+            return false;
+        }
+    }
+    if (!reader.can_hold(header.lod_count, sizeof(MeshLod)))
+    {
+        spdlog::warn("read_scene_cache: {} is truncated", path);
+        return false;
+    }
+    std::vector<MeshLod> lods(header.lod_count);
+    for (MeshLod &lod : lods)
+    {
+        if (!reader.read(lod))
+        {
+            spdlog::warn("read_scene_cache: {} is truncated", path);
+            return false;
+        }
+    }
+    for (const SceneMesh &mesh : meshes)
+    {
+        for (uint32_t i = mesh.meshlet_offset; i < mesh.meshlet_offset + mesh.meshlet_count; ++i)
+        {
+            if (meshlets[i].index_count > mesh.index_count ||
+                meshlets[i].index_offset > mesh.index_count - meshlets[i].index_count)
+            {
+                spdlog::warn("read_scene_cache: {} has an invalid meshlet", path);
+                return false;
+            }
+        }
+        for (uint32_t i = mesh.lod_offset; i < mesh.lod_offset + mesh.lod_count; ++i)
+        {
+            if (lods[i].index_count > mesh.index_count ||
+                lods[i].index_offset > mesh.index_count - lods[i].index_count ||
+                lods[i].meshlet_count > mesh.meshlet_count ||
+                lods[i].meshlet_offset > mesh.meshlet_count - lods[i].meshlet_count)
+            {
+                spdlog::warn("read_scene_cache: {} has an invalid level of detail", path);
+                return false;
+            }
+        }
+    }
+
+    if (!reader.can_hold(header.material_count, sizeof(uint32_t)))
+    {
+        spdlog::warn("read_scene_cache: {} is truncated", path);
+        return false;
+    }
+    std::vector<std::string> material_textures(header.material_count);
+    for (std::string &texture : material_textures)
+    {
+        if (!reader.read_string(texture))
+        {
+            spdlog::warn("read_scene_cache: {} is truncated", path);
+            return false;
+        }
+    }
+
+    if (!reader.can_hold(header.object_count, sizeof(uint32_t)))
+    {
+        spdlog::warn("read_scene_cache: {} is truncated", path);
+        return false;
+    }
+    std::vector<uint32_t> object_meshes(header.object_count);
+    for (uint32_t &mesh_idx : object_meshes)
+    {
+        if (!reader.read(mesh_idx) || mesh_idx >= header.mesh_count)
+        {
+            spdlog::warn("read_scene_cache: {} has an invalid object", path);
+            return false;
+        }
+    }
+
+    // The counts are compared against the bytes left so that they cannot overflow.
+    if (header.vertex_offset % STREAM_ALIGNMENT != 0 ||
+        header.index_offset % STREAM_ALIGNMENT != 0 || header.vertex_offset < reader.get_offset() ||
+        header.vertex_offset > data.size() ||
+        header.vertex_count > (data.size() - header.vertex_offset) / sizeof(Vertex) ||
+        header.index_offset > data.size() ||
+        header.index_count > (data.size() - header.index_offset) / sizeof(uint32_t))
+    {
+        spdlog::warn("read_scene_cache: {} has invalid streams", path);
+        return false;
+    }
+
+    // The mapping is page aligned and the streams are aligned within the file, so they can be
+    // viewed in place and copied into staging memory without an intermediate buffer.
+    out_scene.vertices = std::span(
+        reinterpret_cast<const Vertex *>(data.data() + header.vertex_offset),
+        header.vertex_count
+    );
+    out_scene.indices = std::span(
+        reinterpret_cast<const uint32_t *>(data.data() + header.index_offset),
+        header.index_count
+    );
+    out_scene.meshes = std::move(meshes);
+    out_scene.meshlets = std::move(meshlets);
+    out_scene.lods = std::move(lods);
+    out_scene.material_textures = std::move(material_textures);
+    out_scene.object_meshes = std::move(object_meshes);
+    out_scene.dependencies = std::move(dependencies);
+    out_scene.vertex_storage.clear();
+    out_scene.index_storage.clear();
+    out_scene.mapped_file = std::move(file);
+
+    return true;
+}
+
+[[nodiscard]] bool write_scene_cache(const std::string &path, const SceneData &scene)
+{
+    CPU_ZONE("write_scene_cache");
+
+    if constexpr (std::endian::native != std::endian::little)
+    {
+        spdlog::warn("write_scene_cache: scene caches are only supported on little-endian hosts");
+        return false;
+    }
+
+    std::vector<std::byte> tables;
+    ByteWriter writer(tables);
+    for (const SceneDependency &dependency : scene.dependencies)
+    {
+        writer.write_string(dependency.path);
+        writer.write(dependency.size);
+        writer.write(dependency.modification_time);
+    }
+    for (const SceneMesh &mesh : scene.meshes)
+    {
+        writer.write(mesh.vertex_offset);
+        writer.write(mesh.vertex_count);
+        writer.write(mesh.index_offset);
+        writer.write(mesh.index_count);
+        writer.write(mesh.meshlet_offset);
+        writer.write(mesh.meshlet_count);
+        writer.write(mesh.lod_offset);
+        writer.write(mesh.lod_count);
+        writer.write(mesh.material_idx);
+    }
+    for (const Meshlet &meshlet : scene.meshlets)
+    {
+        writer.write(meshlet);
+    }
+    for (const MeshLod &lod : scene.lods)
+    {
+        writer.write(lod);
+    }
+    for (const std::string &texture : scene.material_textures)
+    {
+        writer.write_string(texture);
+    }
+    for (uint32_t mesh_idx : scene.object_meshes)
+    {
+        writer.write(mesh_idx);
+    }
+
+    SceneCacheHeader header{
+        .magic = SCENE_CACHE_MAGIC,
+        .version = SCENE_CACHE_VERSION,
+        .vertex_size = sizeof(Vertex),
+        .importer_version = get_importer_version(),
+        .dependency_count = static_cast<uint32_t>(scene.dependencies.size()),
+        .mesh_count = static_cast<uint32_t>(scene.meshes.size()),
+        .material_count = static_cast<uint32_t>(scene.material_textures.size()),
+        .object_count = static_cast<uint32_t>(scene.object_meshes.size()),
+        .meshlet_count = static_cast<uint32_t>(scene.meshlets.size()),
+        .lod_count = static_cast<uint32_t>(scene.lods.size()),
+        .vertex_count = scene.vertices.size(),
+        .index_count = scene.indices.size(),
+        .vertex_offset = 0,
+        .index_offset = 0,
+    };
+    header.vertex_offset = align_up(sizeof(header) + tables.size(), STREAM_ALIGNMENT);
+    header.index_offset =
+        align_up(header.vertex_offset + scene.vertices.size_bytes(), STREAM_ALIGNMENT);
+
+    // Written to a temporary file first so a partially written cache is never picked up.
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            spdlog::error("write_scene_cache: failed to open file {}", temp_path);
+            return false;
+        }
+
+        constexpr std::array<char, STREAM_ALIGNMENT> padding{};
+        auto write_bytes = [&](std::span<const std::byte> bytes) {
+            out.write(
+                reinterpret_cast<const char *>(bytes.data()),
+                static_cast<std::streamsize>(bytes.size())
+            );
+        };
+        auto pad_to = [&](uint64_t offset) {
+            uint64_t position = static_cast<uint64_t>(out.tellp());
+            out.write(padding.data(), static_cast<std::streamsize>(offset - position));
+        };
+
+        write_bytes(std::as_bytes(std::span(&header, 1)));
+        write_bytes(tables);
+        pad_to(header.vertex_offset);
+        write_bytes(std::as_bytes(scene.vertices));
+        pad_to(header.index_offset);
+        write_bytes(std::as_bytes(scene.indices));
+
+        if (!out.good())
+        {
+            spdlog::error("write_scene_cache: failed to write file {}", temp_path);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temp_path, ec);
+        spdlog::error("write_scene_cache: failed to move cache into place at {}", path);
+        return false;
+    }
+
+    spdlog::info(
+        "write_scene_cache: wrote {} meshes, {} vertices and {} indices to {}",
+        scene.meshes.size(),
+        scene.vertices.size(),
+        scene.indices.size(),
+        path
+    );
+    return true;
+}
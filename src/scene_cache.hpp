@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+#include "scene_data.hpp"
+
+// Baked scenes are stored in a versioned little-endian binary file next to the source scene,
+// holding the vertex and index streams in GPU layout followed by the material and object
+// tables. A cache is only used if it was written by the same format version and importer
+// version and none of the files it was imported from have changed since.
+
+// Path of the scene cache for a source scene: the same path with a `.scenecache` extension.
+std::string get_scene_cache_path(const std::string &source_path);
+
+// Maps a scene cache and points the vertex and index streams of `out_scene` into the mapping.
+// Returns false without modifying `out_scene` if the cache is missing, stale or invalid.
+[[nodiscard]] bool read_scene_cache(const std::string &path, SceneData &out_scene);
+
+[[nodiscard]] bool write_scene_cache(const std::string &path, const SceneData &scene);
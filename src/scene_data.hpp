@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "meshlet.hpp"
+#include "scene.hpp"
+
+// Range of the shared vertex, index, meshlet and level of detail streams belonging to one mesh.
+// Indices are relative to the first vertex of the mesh.
+struct SceneMesh
+{
+    uint32_t vertex_offset;
+    uint32_t vertex_count;
+    uint32_t index_offset;
+    uint32_t index_count;
+    uint32_t meshlet_offset;
+    uint32_t meshlet_count;
+    uint32_t lod_offset;
+    uint32_t lod_count;
+    uint32_t material_idx;
+};
+
+// Source file of an imported scene together with the size and modification time it had when
+// it was read.
+struct SceneDependency
+{
+    std::string path;
+    uint64_t size;
+    int64_t modification_time;
+};
+
+// CPU-side scene geometry and layout in GPU vertex format, either freshly imported or viewed
+// straight out of a mapped scene cache.
+struct SceneData
+{
+    std::span<const Vertex> vertices;
+    std::span<const uint32_t> indices;
+    std::vector<SceneMesh> meshes;
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshLod> lods;
+
+    // Diffuse texture path of every material relative to the scene file, empty if it has none.
+    std::vector<std::string> material_textures;
+
+    // Mesh index of every object.
+    std::vector<uint32_t> object_meshes;
+
+    // Every file read while importing the scene.
+    std::vector<SceneDependency> dependencies;
+
+    // Storage backing `vertices` and `indices`.
+    std::vector<Vertex> vertex_storage;
+    std::vector<uint32_t> index_storage;
+    MappedFile mapped_file;
+};
@@ -0,0 +1,318 @@
+#include "scene_import.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+#include <spdlog/spdlog.h>
+
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include "cpu_profiler.hpp"
+#include "mesh_optimizer.hpp"
+#include "meshlet.hpp"
+
+namespace
+{
+
+// Keeps track of every file Assimp opens, e.g. the buffers referenced by a glTF file.
+class RecordingIOSystem : public Assimp::DefaultIOSystem
+{
+  public:
+    std::vector<std::string> opened_paths;
+
+    Assimp::IOStream *Open(const char *file, const char *mode) override
+    {
+        Assimp::IOStream *stream = DefaultIOSystem::Open(file, mode);
+        if (stream != nullptr && std::ranges::find(opened_paths, file) == opened_paths.end())
+        {
+            opened_paths.emplace_back(file);
+        }
+        return stream;
+    }
+};
+
+} // namespace
+
+[[nodiscard]] bool get_scene_dependency(const std::string &path, SceneDependency &out_dependency)
+{
+    std::error_code ec;
+    std::filesystem::path absolute_path = std::filesystem::absolute(path, ec);
+    if (ec)
+    {
+        return false;
+    }
+
+    uint64_t size = std::filesystem::file_size(absolute_path, ec);
+    if (ec)
+    {
+        return false;
+    }
+
+    auto modification_time = std::filesystem::last_write_time(absolute_path, ec);
+    if (ec)
+    {
+        return false;
+    }
+
+    out_dependency = SceneDependency{
+        .path = absolute_path.lexically_normal().string(),
+        .size = size,
+        .modification_time = modification_time.time_since_epoch().count(),
+    };
+    return true;
+}
+
+[[nodiscard]] bool import_scene(const std::string &path, SceneData &out_scene)
+{
+    CPU_ZONE("import_scene");
+
+    Assimp::Importer importer;
+
+    // The importer takes ownership of the IO system.
+    auto *io_system = new RecordingIOSystem();
+    importer.SetIOHandler(io_system);
+
+    const aiScene *scene;
+    {
+        CPU_ZONE("Assimp::Importer::ReadFile");
+        scene = importer.ReadFile(
+            path.c_str(),
+            aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_FlipUVs
+        );
+    }
+    if (scene == nullptr)
+    {
+        spdlog::error("import_scene: failed to load file: {}", importer.GetErrorString());
+        return false;
+    }
+
+    if (scene->mRootNode == nullptr)
+    {
+        spdlog::error("import_scene: file has no root node");
+        return false;
+    }
+
+    out_scene.dependencies.clear();
+    for (const std::string &opened_path : io_system->opened_paths)
+    {
+        SceneDependency dependency;
+        if (!get_scene_dependency(opened_path, dependency))
+        {
+            spdlog::error("import_scene: failed to stat file {}", opened_path);
+            return false;
+        }
+        out_scene.dependencies.emplace_back(std::move(dependency));
+    }
+
+    out_scene.material_textures.clear();
+    for (size_t mat_idx = 0; mat_idx < scene->mNumMaterials; ++mat_idx)
+    {
+        const aiMaterial *ai_material = scene->mMaterials[mat_idx];
+        if (ai_material->GetTextureCount(aiTextureType_DIFFUSE) == 0)
+        {
+            spdlog::warn(
+                "import_scene: no diffuse texture for material #{} (`{}`)",
+                mat_idx,
+                ai_material->GetName().C_Str()
+            );
+            out_scene.material_textures.emplace_back();
+            continue;
+        }
+
+        aiString diffuse_name;
+        ai_material->GetTexture(aiTextureType_DIFFUSE, 0, &diffuse_name);
+        out_scene.material_textures.emplace_back(diffuse_name.C_Str());
+    }
+
+    out_scene.vertex_storage.clear();
+    out_scene.index_storage.clear();
+    out_scene.meshes.clear();
+    out_scene.meshlets.clear();
+    out_scene.lods.clear();
+    VertexCacheStats stats_before, stats_after;
+    for (size_t mesh_idx = 0; mesh_idx < scene->mNumMeshes; ++mesh_idx)
+    {
+        const aiMesh *ai_mesh = scene->mMeshes[mesh_idx];
+
+        std::vector<Vertex> vertices;
+        vertices.reserve(ai_mesh->mNumVertices);
+        for (size_t vertex_idx = 0; vertex_idx < ai_mesh->mNumVertices; ++vertex_idx)
+        {
+            Vertex vertex{
+                .position =
+                    {
+                        ai_mesh->mVertices[vertex_idx].x,
+                        ai_mesh->mVertices[vertex_idx].y,
+                        ai_mesh->mVertices[vertex_idx].z,
+                    },
+                .tex_coord_x = ai_mesh->mTextureCoords[0][vertex_idx].x,
+                .normal =
+                    {
+                        ai_mesh->mNormals[vertex_idx].x,
+                        ai_mesh->mNormals[vertex_idx].y,
+                        ai_mesh->mNormals[vertex_idx].z,
+                    },
+                .tex_coord_y = ai_mesh->mTextureCoords[0][vertex_idx].y,
+            };
+            vertices.emplace_back(vertex);
+        }
+
+        std::vector<uint32_t> indices;
+        for (size_t face_idx = 0; face_idx < ai_mesh->mNumFaces; ++face_idx)
+        {
+            const aiFace *face = &ai_mesh->mFaces[face_idx];
+            for (size_t index_idx = 0; index_idx < face->mNumIndices; ++index_idx)
+            {
+                indices.emplace_back(static_cast<uint32_t>(face->mIndices[index_idx]));
+            }
+        }
+
+        // Points and lines can not be reordered as triangles.
+        if (ai_mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+        {
+            CPU_ZONE("optimize mesh");
+            stats_before += analyze_vertex_cache(indices, vertices.size());
+            optimize_vertex_cache(indices, vertices.size());
+            optimize_overdraw(indices, vertices);
+            optimize_vertex_fetch(vertices, indices);
+            stats_after += analyze_vertex_cache(indices, vertices.size());
+        }
+
+        // Lower levels of detail are appended to the full detail indices. Meshes that are not made
+        // of triangles only have the full detail level and a single meshlet that is never
+        // backface culled.
+        size_t meshlet_offset = out_scene.meshlets.size();
+        size_t lod_offset = out_scene.lods.size();
+        if (ai_mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+        {
+            CPU_ZONE("build lods");
+
+            // Every level is simplified from the previous one, so their error bounds add up.
+            size_t lod_index_offset = 0;
+            float lod_error = 0.0f;
+            std::vector<uint32_t> lod_indices;
+            for (uint32_t lod = 0; lod < MAX_MESH_LODS; ++lod)
+            {
+                std::span<const uint32_t> lod_span = std::span(indices).subspan(lod_index_offset);
+                size_t first_meshlet = out_scene.meshlets.size();
+                build_meshlets(lod_span, vertices, out_scene.meshlets);
+                for (size_t i = first_meshlet; i < out_scene.meshlets.size(); ++i)
+                {
+                    out_scene.meshlets[i].index_offset += static_cast<uint32_t>(lod_index_offset);
+                }
+                out_scene.lods.emplace_back(MeshLod{
+                    .index_offset = static_cast<uint32_t>(lod_index_offset),
+                    .index_count = static_cast<uint32_t>(lod_span.size()),
+                    .meshlet_offset = static_cast<uint32_t>(first_meshlet - meshlet_offset),
+                    .meshlet_count =
+                        static_cast<uint32_t>(out_scene.meshlets.size() - first_meshlet),
+                    .error = lod_error,
+                });
+
+                if (lod + 1 == MAX_MESH_LODS)
+                {
+                    break;
+                }
+
+                // Stop once simplification stalls, e.g. on meshes made up mostly of seams.
+                float error =
+                    simplify_mesh(lod_span, vertices, lod_span.size() / 6 * 3, lod_indices);
+                if (lod_indices.empty() || lod_indices.size() > lod_span.size() * 3 / 4)
+                {
+                    break;
+                }
+                optimize_vertex_cache(lod_indices, vertices.size());
+
+                lod_error += error;
+                lod_index_offset = indices.size();
+                indices.insert(indices.end(), lod_indices.begin(), lod_indices.end());
+            }
+        }
+        else
+        {
+            if (!indices.empty())
+            {
+                out_scene.meshlets.emplace_back(Meshlet{
+                    .index_offset = 0,
+                    .index_count = static_cast<uint32_t>(indices.size()),
+                    .bounding_sphere = compute_bounding_sphere(compute_bounding_box(vertices)),
+                    .cone_axis = glm::vec3(0.0f, 0.0f, 1.0f),
+                    .cone_cutoff = 1.0f,
+                });
+            }
+            out_scene.lods.emplace_back(MeshLod{
+                .index_offset = 0,
+                .index_count = static_cast<uint32_t>(indices.size()),
+                .meshlet_offset = 0,
+                .meshlet_count = static_cast<uint32_t>(out_scene.meshlets.size() - meshlet_offset),
+                .error = 0.0f,
+            });
+        }
+
+        SceneMesh mesh{
+            .vertex_offset = static_cast<uint32_t>(out_scene.vertex_storage.size()),
+            .vertex_count = static_cast<uint32_t>(vertices.size()),
+            .index_offset = static_cast<uint32_t>(out_scene.index_storage.size()),
+            .index_count = static_cast<uint32_t>(indices.size()),
+            .meshlet_offset = static_cast<uint32_t>(meshlet_offset),
+            .meshlet_count = static_cast<uint32_t>(out_scene.meshlets.size() - meshlet_offset),
+            .lod_offset = static_cast<uint32_t>(lod_offset),
+            .lod_count = static_cast<uint32_t>(out_scene.lods.size() - lod_offset),
+            .material_idx = ai_mesh->mMaterialIndex,
+        };
+        out_scene.vertex_storage.insert(
+            out_scene.vertex_storage.end(),
+            vertices.begin(),
+            vertices.end()
+        );
+        out_scene.index_storage.insert(
+            out_scene.index_storage.end(),
+            indices.begin(),
+            indices.end()
+        );
+
+        out_scene.meshes.emplace_back(mesh);
+    }
+
+    spdlog::info(
+        "import_scene: optimized {} triangles, acmr {:.3f} -> {:.3f}, atvr {:.3f} -> {:.3f}",
+        stats_after.triangle_count,
+        stats_before.get_acmr(),
+        stats_after.get_acmr(),
+        stats_before.get_atvr(),
+        stats_after.get_atvr()
+    );
+    spdlog::info(
+        "import_scene: split {} meshes into {} levels of detail and {} meshlets",
+        out_scene.meshes.size(),
+        out_scene.lods.size(),
+        out_scene.meshlets.size()
+    );
+
+    out_scene.object_meshes.clear();
+    std::vector nodes_to_process{scene->mRootNode};
+    while (!nodes_to_process.empty())
+    {
+        const aiNode *node = nodes_to_process.back();
+        nodes_to_process.pop_back();
+
+        for (size_t i = 0; i < node->mNumChildren; ++i)
+        {
+            nodes_to_process.emplace_back(node->mChildren[i]);
+        }
+
+        for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+        {
+            out_scene.object_meshes.emplace_back(node->mMeshes[i]);
+        }
+    }
+
+    out_scene.mapped_file.close();
+    out_scene.vertices = out_scene.vertex_storage;
+    out_scene.indices = out_scene.index_storage;
+
+    return true;
+}
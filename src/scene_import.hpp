@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+#include "scene_data.hpp"
+
+// Imports a scene file through Assimp and converts it into the engine's vertex format.
+[[nodiscard]] bool import_scene(const std::string &path, SceneData &out_scene);
+
+// Records the current size and modification time of a scene source file.
+[[nodiscard]] bool get_scene_dependency(const std::string &path, SceneDependency &out_dependency);
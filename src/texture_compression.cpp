@@ -0,0 +1,553 @@
+#include "texture_compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include "cpu_profiler.hpp"
+#include "mipmap.hpp"
+
+namespace
+{
+
+constexpr size_t BLOCK_TEXELS = 16;
+
+template <size_t N>
+using Texels = std::array<std::array<float, N>, BLOCK_TEXELS>;
+
+template <size_t N>
+Texels<N> load_texels(const uint8_t *rgba)
+{
+    Texels<N> texels;
+    for (size_t i = 0; i < BLOCK_TEXELS; ++i)
+    {
+        for (size_t c = 0; c < N; ++c)
+        {
+            texels[i][c] = static_cast<float>(rgba[i * 4 + c]);
+        }
+    }
+    return texels;
+}
+
+// Finds the line through the texels with the least squared distance to them, returned as the
+// two texels on the line at the ends of their projections.
+template <size_t N>
+std::pair<std::array<float, N>, std::array<float, N>> fit_line(const Texels<N> &texels)
+{
+    std::array<float, N> mean{};
+    for (const auto &texel : texels)
+    {
+        for (size_t c = 0; c < N; ++c)
+        {
+            mean[c] += texel[c] / static_cast<float>(BLOCK_TEXELS);
+        }
+    }
+
+    std::array<std::array<float, N>, N> covariance{};
+    for (const auto &texel : texels)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            for (size_t j = 0; j < N; ++j)
+            {
+                covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+            }
+        }
+    }
+
+    // Power iteration for the principal eigenvector.
+    std::array<float, N> axis;
+    axis.fill(1.0f);
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        std::array<float, N> next{};
+        for (size_t i = 0; i < N; ++i)
+        {
+            for (size_t j = 0; j < N; ++j)
+            {
+                next[i] += covariance[i][j] * axis[j];
+            }
+        }
+
+        float length = 0.0f;
+        for (float v : next)
+        {
+            length = std::max(length, std::abs(v));
+        }
+        if (length < 1e-6f)
+        {
+            break;
+        }
+        for (size_t i = 0; i < N; ++i)
+        {
+            axis[i] = next[i] / length;
+        }
+    }
+
+    float length_sq = 0.0f;
+    for (float v : axis)
+    {
+        length_sq += v * v;
+    }
+    for (float &v : axis)
+    {
+        v /= std::sqrt(length_sq);
+    }
+
+    float t_min = std::numeric_limits<float>::max();
+    float t_max = std::numeric_limits<float>::lowest();
+    for (const auto &texel : texels)
+    {
+        float t = 0.0f;
+        for (size_t c = 0; c < N; ++c)
+        {
+            t += (texel[c] - mean[c]) * axis[c];
+        }
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+    }
+
+    std::array<float, N> low, high;
+    for (size_t c = 0; c < N; ++c)
+    {
+        low[c] = std::clamp(mean[c] + axis[c] * t_min, 0.0f, 255.0f);
+        high[c] = std::clamp(mean[c] + axis[c] * t_max, 0.0f, 255.0f);
+    }
+    return {low, high};
+}
+
+uint16_t pack_565(const std::array<float, 3> &color)
+{
+    auto r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+    auto g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+    auto b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+std::array<float, 3> unpack_565(uint16_t color)
+{
+    uint32_t r = (color >> 11) & 31;
+    uint32_t g = (color >> 5) & 63;
+    uint32_t b = color & 31;
+    return {
+        static_cast<float>((r << 3) | (r >> 2)),
+        static_cast<float>((g << 2) | (g >> 4)),
+        static_cast<float>((b << 3) | (b >> 2)),
+    };
+}
+
+template <size_t N>
+float distance_sq(const std::array<float, N> &a, const std::array<float, N> &b)
+{
+    float sum = 0.0f;
+    for (size_t c = 0; c < N; ++c)
+    {
+        sum += (a[c] - b[c]) * (a[c] - b[c]);
+    }
+    return sum;
+}
+
+struct BitWriter
+{
+    uint8_t *out;
+    uint32_t position{0};
+
+    void write(uint32_t value, uint32_t bit_count)
+    {
+        for (uint32_t bit = 0; bit < bit_count; ++bit, ++position)
+        {
+            out[position / 8] |= static_cast<uint8_t>(((value >> bit) & 1) << (position % 8));
+        }
+    }
+};
+
+constexpr std::array<uint32_t, 16> BC7_WEIGHTS_4{
+    0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64,
+};
+
+struct BC7Mode6Block
+{
+    std::array<std::array<uint32_t, 4>, 2> endpoints;
+    std::array<uint32_t, 2> p_bits;
+    std::array<uint32_t, BLOCK_TEXELS> indices;
+    float error;
+};
+
+// Quantizes both endpoints for every combination of p-bits and keeps the one with the lowest
+// error after assigning each texel its closest palette entry.
+BC7Mode6Block encode_bc7_mode6(
+    const Texels<4> &texels, const std::array<float, 4> &low, const std::array<float, 4> &high
+)
+{
+    BC7Mode6Block best{};
+    best.error = std::numeric_limits<float>::max();
+
+    for (uint32_t p_combination = 0; p_combination < 4; ++p_combination)
+    {
+        BC7Mode6Block block{};
+        block.p_bits = {p_combination & 1, p_combination >> 1};
+
+        std::array<std::array<uint32_t, 4>, 2> expanded;
+        for (size_t e = 0; e < 2; ++e)
+        {
+            const std::array<float, 4> &color = e == 0 ? low : high;
+            for (size_t c = 0; c < 4; ++c)
+            {
+                float q = std::round((color[c] - static_cast<float>(block.p_bits[e])) / 2.0f);
+                block.endpoints[e][c] = static_cast<uint32_t>(std::clamp(q, 0.0f, 127.0f));
+                expanded[e][c] = (block.endpoints[e][c] << 1) | block.p_bits[e];
+            }
+        }
+
+        std::array<std::array<float, 4>, 16> palette;
+        for (size_t i = 0; i < palette.size(); ++i)
+        {
+            for (size_t c = 0; c < 4; ++c)
+            {
+                uint32_t w = BC7_WEIGHTS_4[i];
+                palette[i][c] = static_cast<float>(
+                    ((64 - w) * expanded[0][c] + w * expanded[1][c] + 32) >> 6
+                );
+            }
+        }
+
+        for (size_t t = 0; t < BLOCK_TEXELS; ++t)
+        {
+            float best_distance = std::numeric_limits<float>::max();
+            for (uint32_t i = 0; i < palette.size(); ++i)
+            {
+                float distance = distance_sq(texels[t], palette[i]);
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    block.indices[t] = i;
+                }
+            }
+            block.error += best_distance;
+        }
+
+        if (block.error < best.error)
+        {
+            best = block;
+        }
+    }
+
+    return best;
+}
+
+// Solves for the endpoints that minimize the squared error of the texels given fixed indices.
+bool refine_bc7_endpoints(
+    const Texels<4> &texels, const BC7Mode6Block &block, std::array<float, 4> &out_low,
+    std::array<float, 4> &out_high
+)
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    std::array<float, 4> ax{}, bx{};
+    for (size_t t = 0; t < BLOCK_TEXELS; ++t)
+    {
+        float w = static_cast<float>(BC7_WEIGHTS_4[block.indices[t]]) / 64.0f;
+        aa += (1.0f - w) * (1.0f - w);
+        ab += (1.0f - w) * w;
+        bb += w * w;
+        for (size_t c = 0; c < 4; ++c)
+        {
+            ax[c] += (1.0f - w) * texels[t][c];
+            bx[c] += w * texels[t][c];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f)
+    {
+        return false;
+    }
+
+    for (size_t c = 0; c < 4; ++c)
+    {
+        out_low[c] = std::clamp((ax[c] * bb - ab * bx[c]) / det, 0.0f, 255.0f);
+        out_high[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+} // namespace
+
+VkFormat get_compressed_format(TextureUsage usage)
+{
+    switch (usage)
+    {
+        case TextureUsage::Albedo:
+            return VK_FORMAT_BC7_SRGB_BLOCK;
+        case TextureUsage::Normal:
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+        case TextureUsage::Mask:
+            return VK_FORMAT_BC4_UNORM_BLOCK;
+    }
+    return VK_FORMAT_UNDEFINED;
+}
+
+uint32_t get_block_byte_size(VkFormat format)
+{
+    switch (format)
+    {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            return 8;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+bool is_srgb_format(VkFormat format)
+{
+    return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK ||
+           format == VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+VkDeviceSize get_compressed_level_size(VkFormat format, VkExtent3D level_extent)
+{
+    VkDeviceSize blocks_x = (level_extent.width + 3) / 4;
+    VkDeviceSize blocks_y = (level_extent.height + 3) / 4;
+    return blocks_x * blocks_y * get_block_byte_size(format);
+}
+
+void encode_bc1_block(const uint8_t *rgba, uint8_t *out_block)
+{
+    Texels<3> texels = load_texels<3>(rgba);
+    auto [low, high] = fit_line(texels);
+
+    uint16_t color0 = pack_565(high);
+    uint16_t color1 = pack_565(low);
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        std::array<std::array<float, 3>, 4> palette;
+        palette[0] = unpack_565(color0);
+        palette[1] = unpack_565(color1);
+        for (size_t c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+
+        for (size_t t = 0; t < BLOCK_TEXELS; ++t)
+        {
+            uint32_t best_index = 0;
+            float best_distance = std::numeric_limits<float>::max();
+            for (uint32_t i = 0; i < palette.size(); ++i)
+            {
+                float distance = distance_sq(texels[t], palette[i]);
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best_index = i;
+                }
+            }
+            indices |= best_index << (t * 2);
+        }
+    }
+
+    out_block[0] = static_cast<uint8_t>(color0);
+    out_block[1] = static_cast<uint8_t>(color0 >> 8);
+    out_block[2] = static_cast<uint8_t>(color1);
+    out_block[3] = static_cast<uint8_t>(color1 >> 8);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        out_block[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+}
+
+void encode_bc4_block(const uint8_t *rgba, uint32_t channel, uint8_t *out_block)
+{
+    uint32_t min_value = 255, max_value = 0;
+    for (size_t t = 0; t < BLOCK_TEXELS; ++t)
+    {
+        min_value = std::min<uint32_t>(min_value, rgba[t * 4 + channel]);
+        max_value = std::max<uint32_t>(max_value, rgba[t * 4 + channel]);
+    }
+
+    // With the first endpoint greater than the second, the palette interpolates six values
+    // between them.
+    std::array<float, 8> palette;
+    palette[0] = static_cast<float>(max_value);
+    palette[1] = static_cast<float>(min_value);
+    for (size_t i = 2; i < palette.size(); ++i)
+    {
+        float w = static_cast<float>(i - 1) / 7.0f;
+        palette[i] = (1.0f - w) * palette[0] + w * palette[1];
+    }
+
+    uint64_t indices = 0;
+    if (max_value != min_value)
+    {
+        for (size_t t = 0; t < BLOCK_TEXELS; ++t)
+        {
+            float value = static_cast<float>(rgba[t * 4 + channel]);
+            uint64_t best_index = 0;
+            float best_distance = std::numeric_limits<float>::max();
+            for (uint64_t i = 0; i < palette.size(); ++i)
+            {
+                float distance = std::abs(value - palette[i]);
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best_index = i;
+                }
+            }
+            indices |= best_index << (t * 3);
+        }
+    }
+
+    out_block[0] = static_cast<uint8_t>(max_value);
+    out_block[1] = static_cast<uint8_t>(min_value);
+    for (size_t i = 0; i < 6; ++i)
+    {
+        out_block[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+}
+
+void encode_bc5_block(const uint8_t *rgba, uint8_t *out_block)
+{
+    encode_bc4_block(rgba, 0, out_block);
+    encode_bc4_block(rgba, 1, out_block + 8);
+}
+
+void encode_bc7_block(const uint8_t *rgba, uint8_t *out_block)
+{
+    // Every block is encoded in mode 6: a single subset with RGBA endpoints of seven bits plus
+    // a shared p-bit each and 4-bit indices.
+    Texels<4> texels = load_texels<4>(rgba);
+    auto [low, high] = fit_line(texels);
+
+    BC7Mode6Block block = encode_bc7_mode6(texels, low, high);
+    for (int iteration = 0; iteration < 2; ++iteration)
+    {
+        if (!refine_bc7_endpoints(texels, block, low, high))
+        {
+            break;
+        }
+        BC7Mode6Block refined = encode_bc7_mode6(texels, low, high);
+        if (refined.error >= block.error)
+        {
+            break;
+        }
+        block = refined;
+    }
+
+    // The most significant index bit of the first texel is implicitly zero.
+    if (block.indices[0] >= 8)
+    {
+        std::swap(block.endpoints[0], block.endpoints[1]);
+        std::swap(block.p_bits[0], block.p_bits[1]);
+        for (uint32_t &index : block.indices)
+        {
+            index = 15 - index;
+        }
+    }
+
+    std::fill(out_block, out_block + 16, uint8_t{0});
+    BitWriter writer{.out = out_block};
+    writer.write(1 << 6, 7);
+    for (size_t c = 0; c < 4; ++c)
+    {
+        writer.write(block.endpoints[0][c], 7);
+        writer.write(block.endpoints[1][c], 7);
+    }
+    writer.write(block.p_bits[0], 1);
+    writer.write(block.p_bits[1], 1);
+    writer.write(block.indices[0], 3);
+    for (size_t t = 1; t < BLOCK_TEXELS; ++t)
+    {
+        writer.write(block.indices[t], 4);
+    }
+}
+
+[[nodiscard]] bool
+compress_image(const DecodedImage &image, VkFormat format, DecodedImage &out_image)
+{
+    CPU_ZONE("compress_image");
+
+    if (image.format != VK_FORMAT_R8G8B8A8_UNORM && image.format != VK_FORMAT_R8G8B8A8_SRGB)
+    {
+        spdlog::error("compress_image: source image is not rgba8");
+        return false;
+    }
+
+    uint32_t block_size = get_block_byte_size(format);
+    if (block_size == 0)
+    {
+        spdlog::error("compress_image: unsupported format {}", static_cast<int>(format));
+        return false;
+    }
+
+    out_image.extent = image.extent;
+    out_image.format = format;
+    out_image.mip_offsets.clear();
+    out_image.data.clear();
+
+    for (uint32_t level = 0; level < image.mip_offsets.size(); ++level)
+    {
+        VkExtent3D extent = get_mip_extent(image.extent, level);
+        const auto *src = reinterpret_cast<const uint8_t *>(image.data.data()) +
+                          image.mip_offsets[level];
+
+        size_t level_offset = out_image.data.size();
+        out_image.mip_offsets.emplace_back(level_offset);
+        out_image.data.resize(level_offset + get_compressed_level_size(format, extent));
+        auto *dst = reinterpret_cast<uint8_t *>(out_image.data.data()) + level_offset;
+
+        for (uint32_t block_y = 0; block_y < extent.height; block_y += 4)
+        {
+            for (uint32_t block_x = 0; block_x < extent.width; block_x += 4)
+            {
+                // Blocks overhanging the edge of the level repeat its last row and column.
+                std::array<uint8_t, BLOCK_TEXELS * 4> block;
+                for (uint32_t y = 0; y < 4; ++y)
+                {
+                    uint32_t src_y = std::min(block_y + y, extent.height - 1);
+                    for (uint32_t x = 0; x < 4; ++x)
+                    {
+                        uint32_t src_x = std::min(block_x + x, extent.width - 1);
+                        const uint8_t *texel =
+                            src + (static_cast<size_t>(src_y) * extent.width + src_x) * 4;
+                        std::copy(texel, texel + 4, block.data() + (y * 4 + x) * 4);
+                    }
+                }
+
+                switch (format)
+                {
+                    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                        encode_bc1_block(block.data(), dst);
+                        break;
+                    case VK_FORMAT_BC4_UNORM_BLOCK:
+                        encode_bc4_block(block.data(), 0, dst);
+                        break;
+                    case VK_FORMAT_BC5_UNORM_BLOCK:
+                        encode_bc5_block(block.data(), dst);
+                        break;
+                    default:
+                        encode_bc7_block(block.data(), dst);
+                        break;
+                }
+                dst += block_size;
+            }
+        }
+    }
+
+    return true;
+}
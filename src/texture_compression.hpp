@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan_core.h>
+
+#include "image_data.hpp"
+
+enum class TextureUsage
+{
+    Albedo,
+    Normal,
+    Mask,
+};
+
+// BC7 for albedo, BC5 for the two channels of tangent space normals and BC4 for single channel
+// masks.
+VkFormat get_compressed_format(TextureUsage usage);
+
+// Bytes per 4x4 block of a supported block-compressed format, zero for any other format.
+uint32_t get_block_byte_size(VkFormat format);
+
+bool is_srgb_format(VkFormat format);
+
+VkDeviceSize get_compressed_level_size(VkFormat format, VkExtent3D level_extent);
+
+// Each encoder takes a 4x4 block of RGBA8 texels in row-major order.
+void encode_bc1_block(const uint8_t *rgba, uint8_t *out_block);
+void encode_bc4_block(const uint8_t *rgba, uint32_t channel, uint8_t *out_block);
+void encode_bc5_block(const uint8_t *rgba, uint8_t *out_block);
+void encode_bc7_block(const uint8_t *rgba, uint8_t *out_block);
+
+// Compresses every mip level of `image`, which must hold RGBA8 texels, into `format`.
+[[nodiscard]] bool
+compress_image(const DecodedImage &image, VkFormat format, DecodedImage &out_image);
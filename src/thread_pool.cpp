@@ -0,0 +1,102 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <latch>
+#include <string>
+#include <system_error>
+
+#include <spdlog/spdlog.h>
+
+#include "cpu_profiler.hpp"
+
+[[nodiscard]] bool ThreadPool::init(size_t thread_count)
+{
+    if (thread_count == 0)
+    {
+        size_t hardware_threads = std::thread::hardware_concurrency();
+        thread_count = std::max<size_t>(hardware_threads, 2) - 1;
+    }
+
+    try
+    {
+        for (size_t i = 0; i < thread_count; ++i)
+        {
+            m_workers.emplace_back([this, i] { worker_main(i); });
+        }
+    }
+    catch (const std::system_error &e)
+    {
+        spdlog::error("ThreadPool::init: failed to spawn worker thread: {}", e.what());
+        destroy();
+        return false;
+    }
+
+    spdlog::trace("ThreadPool::init: spawned {} worker threads", m_workers.size());
+
+    return true;
+}
+
+void ThreadPool::destroy()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_task_available.notify_all();
+
+    for (auto &worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+    m_stopping = false;
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    if (m_workers.empty())
+    {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_tasks.emplace_back(std::move(task));
+    }
+    m_task_available.notify_one();
+}
+
+void ThreadPool::run(size_t task_count, const std::function<void(size_t)> &task)
+{
+    std::latch done(static_cast<std::ptrdiff_t>(task_count));
+    for (size_t i = 0; i < task_count; ++i)
+    {
+        submit([&task, &done, i] {
+            task(i);
+            done.count_down();
+        });
+    }
+    done.wait();
+}
+
+void ThreadPool::worker_main(size_t worker_idx)
+{
+    CPUProfiler::set_thread_name("worker " + std::to_string(worker_idx));
+
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(m_mutex);
+            m_task_available.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty())
+            {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
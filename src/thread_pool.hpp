@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming a FIFO of tasks. Tasks must not throw and must not
+// outlive any state they reference; callers are responsible for waiting on their results.
+class ThreadPool
+{
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_task_available;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_stopping{false};
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ThreadPool(ThreadPool &&) = delete;
+    ThreadPool &operator=(ThreadPool &&) = delete;
+
+  public:
+    ThreadPool() = default;
+
+    // Spawns `thread_count` workers, or one less than the number of hardware threads when zero.
+    [[nodiscard]] bool init(size_t thread_count = 0);
+
+    // Finishes all queued tasks and joins the workers.
+    void destroy();
+
+    size_t get_thread_count() const
+    {
+        return m_workers.size();
+    }
+
+    void submit(std::function<void()> task);
+
+    // Runs `task` with every index below `task_count` on the workers and waits until all of them
+    // have returned. Must not be called from a worker, which could end up waiting for itself.
+    void run(size_t task_count, const std::function<void(size_t)> &task);
+
+  private:
+    void worker_main(size_t worker_idx);
+};
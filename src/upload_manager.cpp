@@ -0,0 +1,563 @@
+#include "upload_manager.hpp"
+
+#include <cstring>
+#include <limits>
+
+#include <spdlog/spdlog.h>
+
+#include "cpu_profiler.hpp"
+#include "engine.hpp"
+#include "mipmap.hpp"
+#include "vkerr.hpp"
+
+static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+[[nodiscard]] bool UploadManager::init()
+{
+    VkCommandPoolCreateInfo cmd_pool_info = {};
+    cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    cmd_pool_info.queueFamilyIndex = m_engine.get_transfer_queue_family();
+    VKERR(
+        vkCreateCommandPool(m_engine.get_device(), &cmd_pool_info, nullptr, &m_cmd_pool),
+        "UploadManager::init: failed to create command pool"
+    );
+    m_deletion_queue.add([this] {
+        vkDestroyCommandPool(m_engine.get_device(), m_cmd_pool, nullptr);
+    });
+
+    for (auto &batch : m_batches)
+    {
+        VkCommandBufferAllocateInfo cmd_buffer_info = {};
+        cmd_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmd_buffer_info.commandPool = m_cmd_pool;
+        cmd_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmd_buffer_info.commandBufferCount = 1;
+        VKERR(
+            vkAllocateCommandBuffers(m_engine.get_device(), &cmd_buffer_info, &batch.cmd_buffer),
+            "UploadManager::init: failed to allocate command buffer"
+        );
+    }
+
+    VkSemaphoreTypeCreateInfo semaphore_type_info = {};
+    semaphore_type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    semaphore_type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    semaphore_type_info.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphore_info = {};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = &semaphore_type_info;
+    VKERR(
+        vkCreateSemaphore(m_engine.get_device(), &semaphore_info, nullptr, &m_timeline),
+        "UploadManager::init: failed to create timeline semaphore"
+    );
+    m_deletion_queue.add([this] {
+        vkDestroySemaphore(m_engine.get_device(), m_timeline, nullptr);
+    });
+
+    if (!m_engine.create_buffer(
+            VMA_MEMORY_USAGE_CPU_TO_GPU,
+            STAGING_SIZE,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            m_staging_buffer
+        ))
+    {
+        spdlog::error("UploadManager::init: failed to allocate staging buffer");
+        return false;
+    }
+    m_deletion_queue.add([this] { m_engine.destroy_buffer(m_staging_buffer); });
+
+    spdlog::trace(
+        "UploadManager::init: created {} MiB staging ring",
+        STAGING_SIZE / (1024 * 1024)
+    );
+
+    return true;
+}
+
+void UploadManager::destroy()
+{
+    if (!finish())
+    {
+        spdlog::error("UploadManager::destroy: failed to finish outstanding uploads");
+    }
+    m_deletion_queue.delete_all();
+}
+
+[[nodiscard]] bool UploadManager::upload_buffer(
+    const GPUBuffer &dst, VkDeviceSize dst_offset, std::span<const std::byte> data
+)
+{
+    if (data.empty())
+    {
+        return true;
+    }
+
+    StagingAllocation staging;
+    if (!allocate_staging(data.size(), staging))
+    {
+        spdlog::error("UploadManager::upload_buffer: failed to allocate staging memory");
+        return false;
+    }
+    std::memcpy(staging.data, data.data(), data.size());
+
+    VkBufferCopy region{
+        .srcOffset = staging.offset,
+        .dstOffset = dst_offset,
+        .size = data.size(),
+    };
+    Batch &batch = m_batches[m_current];
+    vkCmdCopyBuffer(batch.cmd_buffer, staging.buffer, dst.buffer, 1, &region);
+
+    if (needs_ownership_transfer())
+    {
+        VkBufferMemoryBarrier2 release = {};
+        release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        release.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        release.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        release.srcQueueFamilyIndex = m_engine.get_transfer_queue_family();
+        release.dstQueueFamilyIndex = m_engine.get_queue_family();
+        release.buffer = dst.buffer;
+        release.offset = dst_offset;
+        release.size = data.size();
+
+        VkDependencyInfo dep_info = {};
+        dep_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dep_info.bufferMemoryBarrierCount = 1;
+        dep_info.pBufferMemoryBarriers = &release;
+        vkCmdPipelineBarrier2(batch.cmd_buffer, &dep_info);
+
+        VkBufferMemoryBarrier2 acquire = release;
+        acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+        acquire.srcAccessMask = VK_ACCESS_2_NONE;
+        acquire.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        acquire.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+        batch.buffer_acquires.emplace_back(acquire);
+    }
+
+    return finish_upload(data.size());
+}
+
+[[nodiscard]] bool UploadManager::upload_image(
+    const GPUImage &dst, std::span<const std::byte> data, std::span<const VkDeviceSize> mip_offsets
+)
+{
+    StagingAllocation staging;
+    if (!allocate_staging(data.size(), staging))
+    {
+        spdlog::error("UploadManager::upload_image: failed to allocate staging memory");
+        return false;
+    }
+    std::memcpy(staging.data, data.data(), data.size());
+
+    VkCommandBuffer cmd_buffer = m_batches[m_current].cmd_buffer;
+    transition_image(
+        cmd_buffer,
+        dst.image,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+    );
+    std::vector<VkBufferImageCopy> regions(mip_offsets.size());
+    for (uint32_t level = 0; level < mip_offsets.size(); ++level)
+    {
+        VkBufferImageCopy &region = regions[level];
+        region.bufferOffset = staging.offset + mip_offsets[level];
+        region.imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = level,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        };
+        region.imageExtent = get_mip_extent(dst.extent, level);
+    }
+    vkCmdCopyBufferToImage(
+        cmd_buffer,
+        staging.buffer,
+        dst.image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()),
+        regions.data()
+    );
+
+    if (!needs_ownership_transfer())
+    {
+        transition_image(
+            cmd_buffer,
+            dst.image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL
+        );
+        return finish_upload(data.size());
+    }
+
+    // The layout transition is performed once by the matching release/acquire pair.
+    VkImageMemoryBarrier2 release = {};
+    release.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    release.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    release.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    release.newLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+    release.srcQueueFamilyIndex = m_engine.get_transfer_queue_family();
+    release.dstQueueFamilyIndex = m_engine.get_queue_family();
+    release.image = dst.image;
+    release.subresourceRange = full_image_range(VK_IMAGE_ASPECT_COLOR_BIT);
+
+    VkDependencyInfo dep_info = {};
+    dep_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dep_info.imageMemoryBarrierCount = 1;
+    dep_info.pImageMemoryBarriers = &release;
+    vkCmdPipelineBarrier2(cmd_buffer, &dep_info);
+
+    VkImageMemoryBarrier2 acquire = release;
+    acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+    acquire.srcAccessMask = VK_ACCESS_2_NONE;
+    acquire.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    acquire.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+    m_batches[m_current].image_acquires.emplace_back(acquire);
+
+    return finish_upload(data.size());
+}
+
+[[nodiscard]] bool UploadManager::flush()
+{
+    Batch &batch = m_batches[m_current];
+    if (!batch.recording)
+    {
+        return true;
+    }
+
+    CPU_ZONE("UploadManager::flush");
+
+    VKERR(
+        vkEndCommandBuffer(batch.cmd_buffer),
+        "UploadManager::flush: failed to end command buffer"
+    );
+
+    VkCommandBufferSubmitInfo cmd_buffer_info = {};
+    cmd_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    cmd_buffer_info.commandBuffer = batch.cmd_buffer;
+
+    VkSemaphoreSubmitInfo signal_info = {};
+    signal_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    signal_info.semaphore = m_timeline;
+    signal_info.value = m_submitted_value + 1;
+    signal_info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    VkSubmitInfo2 submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    submit_info.commandBufferInfoCount = 1;
+    submit_info.pCommandBufferInfos = &cmd_buffer_info;
+    submit_info.signalSemaphoreInfoCount = 1;
+    submit_info.pSignalSemaphoreInfos = &signal_info;
+    VKERR(
+        vkQueueSubmit2(m_engine.get_transfer_queue(), 1, &submit_info, VK_NULL_HANDLE),
+        "UploadManager::flush: failed to submit command buffer"
+    );
+
+    m_submitted_value += 1;
+    batch.timeline_value = m_submitted_value;
+    batch.recording = false;
+    batch.in_flight = true;
+    m_current = (m_current + 1) % NUM_BATCHES;
+    m_submit_count += 1;
+
+    return true;
+}
+
+[[nodiscard]] bool UploadManager::finish()
+{
+    CPU_ZONE("UploadManager::finish");
+
+    if (!flush())
+    {
+        spdlog::error("UploadManager::finish: failed to flush current batch");
+        return false;
+    }
+
+    bool had_uploads = m_submit_count > 0;
+    for (auto &batch : m_batches)
+    {
+        if (!retire(batch))
+        {
+            spdlog::error("UploadManager::finish: failed to retire batch");
+            return false;
+        }
+    }
+
+    // Everything has completed, so the acquires can be recorded right away instead of leaving
+    // them to the next frame, which may no longer reference the uploaded resources.
+    if (!m_ready_buffer_acquires.empty() || !m_ready_image_acquires.empty())
+    {
+        bool recorded = m_engine.immediate_submit([this](VkCommandBuffer cmd_buffer) {
+            record_acquires(cmd_buffer);
+        });
+        if (!recorded)
+        {
+            spdlog::error("UploadManager::finish: failed to acquire uploaded resources");
+            return false;
+        }
+    }
+    m_available_value = m_completed_value;
+
+    if (had_uploads)
+    {
+        spdlog::debug(
+            "UploadManager::finish: uploaded {:.2f} MiB in {} submissions",
+            static_cast<double>(m_total_bytes) / (1024.0 * 1024.0),
+            m_submit_count
+        );
+    }
+    m_total_bytes = 0;
+    m_submit_count = 0;
+
+    return true;
+}
+
+[[nodiscard]] bool UploadManager::update()
+{
+    VKERR(
+        vkGetSemaphoreCounterValue(m_engine.get_device(), m_timeline, &m_completed_value),
+        "UploadManager::update: failed to query timeline semaphore"
+    );
+
+    for (size_t i = 0; i < NUM_BATCHES; ++i)
+    {
+        Batch &batch = m_batches[(m_current + i) % NUM_BATCHES];
+        if (!batch.in_flight)
+        {
+            continue;
+        }
+        if (batch.timeline_value > m_completed_value)
+        {
+            break;
+        }
+        if (!retire(batch))
+        {
+            spdlog::error("UploadManager::update: failed to retire batch");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint64_t UploadManager::record_acquires(VkCommandBuffer cmd_buffer)
+{
+    if (!m_ready_buffer_acquires.empty() || !m_ready_image_acquires.empty())
+    {
+        VkDependencyInfo dep_info = {};
+        dep_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dep_info.bufferMemoryBarrierCount =
+            static_cast<uint32_t>(m_ready_buffer_acquires.size());
+        dep_info.pBufferMemoryBarriers = m_ready_buffer_acquires.data();
+        dep_info.imageMemoryBarrierCount = static_cast<uint32_t>(m_ready_image_acquires.size());
+        dep_info.pImageMemoryBarriers = m_ready_image_acquires.data();
+        vkCmdPipelineBarrier2(cmd_buffer, &dep_info);
+
+        m_ready_buffer_acquires.clear();
+        m_ready_image_acquires.clear();
+    }
+
+    m_available_value = m_completed_value;
+    return m_available_value;
+}
+
+bool UploadManager::needs_ownership_transfer() const
+{
+    return m_engine.get_transfer_queue_family() != m_engine.get_queue_family();
+}
+
+[[nodiscard]] bool UploadManager::begin_batch()
+{
+    Batch &batch = m_batches[m_current];
+    if (batch.recording)
+    {
+        return true;
+    }
+
+    if (!retire(batch))
+    {
+        spdlog::error("UploadManager::begin_batch: failed to retire previous use of batch");
+        return false;
+    }
+
+    VKERR(
+        vkResetCommandBuffer(batch.cmd_buffer, 0),
+        "UploadManager::begin_batch: failed to reset command buffer"
+    );
+
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VKERR(
+        vkBeginCommandBuffer(batch.cmd_buffer, &begin_info),
+        "UploadManager::begin_batch: failed to begin command buffer"
+    );
+
+    batch.recording = true;
+    batch.upload_bytes = 0;
+
+    return true;
+}
+
+[[nodiscard]] bool UploadManager::retire(Batch &batch)
+{
+    if (!batch.in_flight)
+    {
+        return true;
+    }
+
+    CPU_ZONE("UploadManager::retire");
+
+    if (m_completed_value < batch.timeline_value)
+    {
+        VkSemaphoreWaitInfo wait_info = {};
+        wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores = &m_timeline;
+        wait_info.pValues = &batch.timeline_value;
+        VKERR(
+            vkWaitSemaphores(
+                m_engine.get_device(),
+                &wait_info,
+                std::numeric_limits<uint64_t>::max()
+            ),
+            "UploadManager::retire: failed to wait for timeline semaphore"
+        );
+        m_completed_value = batch.timeline_value;
+    }
+
+    m_used -= batch.staging_bytes;
+    batch.staging_bytes = 0;
+    batch.deletion_queue.delete_all();
+    batch.in_flight = false;
+
+    m_ready_buffer_acquires.insert(
+        m_ready_buffer_acquires.end(),
+        batch.buffer_acquires.begin(),
+        batch.buffer_acquires.end()
+    );
+    m_ready_image_acquires.insert(
+        m_ready_image_acquires.end(),
+        batch.image_acquires.begin(),
+        batch.image_acquires.end()
+    );
+    batch.buffer_acquires.clear();
+    batch.image_acquires.clear();
+
+    return true;
+}
+
+[[nodiscard]] bool UploadManager::make_room()
+{
+    // Batches are reused round-robin, so walking forward from the current one visits the
+    // in-flight batches from oldest to newest.
+    for (size_t i = 0; i < NUM_BATCHES; ++i)
+    {
+        Batch &batch = m_batches[(m_current + i) % NUM_BATCHES];
+        if (batch.in_flight)
+        {
+            return retire(batch);
+        }
+    }
+
+    if (m_batches[m_current].recording)
+    {
+        return flush();
+    }
+
+    spdlog::error("UploadManager::make_room: staging ring is full but no batch is pending");
+    return false;
+}
+
+[[nodiscard]] bool
+UploadManager::allocate_staging(VkDeviceSize size, StagingAllocation &out_allocation)
+{
+    if (size > STAGING_SIZE)
+    {
+        if (!begin_batch())
+        {
+            return false;
+        }
+
+        GPUBuffer buffer;
+        if (!m_engine.create_buffer(
+                VMA_MEMORY_USAGE_CPU_TO_GPU,
+                size,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                buffer
+            ))
+        {
+            spdlog::error("UploadManager::allocate_staging: failed to allocate dedicated buffer");
+            return false;
+        }
+        m_batches[m_current].deletion_queue.add([this, buffer]() mutable {
+            m_engine.destroy_buffer(buffer);
+        });
+
+        out_allocation = StagingAllocation{
+            .buffer = buffer.buffer,
+            .offset = 0,
+            .data = static_cast<uint8_t *>(buffer.allocation_info.pMappedData),
+        };
+        return true;
+    }
+
+    while (true)
+    {
+        if (m_used == 0)
+        {
+            m_head = 0;
+        }
+
+        VkDeviceSize offset = align_up(m_head, STAGING_ALIGNMENT);
+        if (offset + size > STAGING_SIZE)
+        {
+            offset = 0;
+        }
+        VkDeviceSize consumed = (offset >= m_head ? offset - m_head : STAGING_SIZE - m_head) + size;
+
+        if (m_used + consumed <= STAGING_SIZE)
+        {
+            if (!begin_batch())
+            {
+                return false;
+            }
+
+            m_head = offset + size;
+            m_used += consumed;
+            m_batches[m_current].staging_bytes += consumed;
+
+            out_allocation = StagingAllocation{
+                .buffer = m_staging_buffer.buffer,
+                .offset = offset,
+                .data = static_cast<uint8_t *>(m_staging_buffer.allocation_info.pMappedData) +
+                        offset,
+            };
+            return true;
+        }
+
+        if (!make_room())
+        {
+            return false;
+        }
+    }
+}
+
+[[nodiscard]] bool UploadManager::finish_upload(VkDeviceSize size)
+{
+    Batch &batch = m_batches[m_current];
+    batch.upload_bytes += size;
+    m_total_bytes += size;
+    m_last_upload_value = m_submitted_value + 1;
+
+    if (batch.upload_bytes >= FLUSH_THRESHOLD)
+    {
+        return flush();
+    }
+
+    return true;
+}
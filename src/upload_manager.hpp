@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "deletion_queue.hpp"
+#include "gpu.hpp"
+
+class Engine;
+
+// Batches buffer and image uploads through a persistently mapped staging ring on the engine's
+// transfer queue. Copies are recorded into a shared command buffer which is submitted once
+// enough data has accumulated. Every submission signals the next value of a timeline semaphore
+// and ring space is recycled as soon as that value has been reached.
+//
+// A resource uploaded by a batch may be used on the graphics queue once the value returned by
+// `get_last_upload_value()` after its upload is at most `get_available_value()`. The frame
+// command buffer acquires ownership of completed uploads in `record_acquires()` and its
+// submission waits for the returned timeline value, so rendering never blocks on uploads.
+class UploadManager
+{
+  public:
+    static constexpr VkDeviceSize STAGING_SIZE = 64 * 1024 * 1024;
+    static constexpr VkDeviceSize FLUSH_THRESHOLD = 16 * 1024 * 1024;
+    static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+    static constexpr size_t NUM_BATCHES = 4;
+
+  private:
+    struct Batch
+    {
+        VkCommandBuffer cmd_buffer{VK_NULL_HANDLE};
+        uint64_t timeline_value{0};
+        VkDeviceSize staging_bytes{0};
+        VkDeviceSize upload_bytes{0};
+        bool recording{false};
+        bool in_flight{false};
+
+        std::vector<VkBufferMemoryBarrier2> buffer_acquires;
+        std::vector<VkImageMemoryBarrier2> image_acquires;
+
+        DeletionQueue deletion_queue;
+    };
+
+    struct StagingAllocation
+    {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        uint8_t *data;
+    };
+
+    DeletionQueue m_deletion_queue;
+
+    Engine &m_engine;
+
+    VkCommandPool m_cmd_pool{VK_NULL_HANDLE};
+    GPUBuffer m_staging_buffer;
+    VkDeviceSize m_head{0};
+    VkDeviceSize m_used{0};
+
+    std::array<Batch, NUM_BATCHES> m_batches;
+    size_t m_current{0};
+
+    VkSemaphore m_timeline{VK_NULL_HANDLE};
+    uint64_t m_submitted_value{0};
+    uint64_t m_completed_value{0};
+    uint64_t m_available_value{0};
+    uint64_t m_last_upload_value{0};
+
+    std::vector<VkBufferMemoryBarrier2> m_ready_buffer_acquires;
+    std::vector<VkImageMemoryBarrier2> m_ready_image_acquires;
+
+    uint64_t m_total_bytes{0};
+    uint64_t m_submit_count{0};
+
+    UploadManager() = delete;
+    UploadManager(const UploadManager &) = delete;
+    UploadManager &operator=(const UploadManager &) = delete;
+    UploadManager(UploadManager &&) = delete;
+    UploadManager &operator=(UploadManager &&) = delete;
+
+  public:
+    explicit UploadManager(Engine &engine) : m_engine(engine)
+    {
+    }
+
+    [[nodiscard]] bool init();
+    void destroy();
+
+    VkSemaphore get_timeline_semaphore() const
+    {
+        return m_timeline;
+    }
+
+    uint64_t get_last_upload_value() const
+    {
+        return m_last_upload_value;
+    }
+
+    uint64_t get_available_value() const
+    {
+        return m_available_value;
+    }
+
+    [[nodiscard]] bool
+    upload_buffer(const GPUBuffer &dst, VkDeviceSize dst_offset, std::span<const std::byte> data);
+
+    // Uploads every mip level of `dst`, each starting at the matching entry of `mip_offsets`
+    // in `data`, and leaves the image in `VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL`.
+    [[nodiscard]] bool upload_image(
+        const GPUImage &dst, std::span<const std::byte> data,
+        std::span<const VkDeviceSize> mip_offsets
+    );
+
+    // Submits all recorded copies without waiting for them.
+    [[nodiscard]] bool flush();
+
+    // Submits all recorded copies, waits for every outstanding batch and makes all uploaded
+    // resources available to the graphics queue.
+    [[nodiscard]] bool finish();
+
+    // Retires batches that have completed on the GPU without blocking.
+    [[nodiscard]] bool update();
+
+    // Records queue family ownership acquires for all completed uploads into a graphics
+    // command buffer. The submission of `cmd_buffer` must wait for the returned timeline value.
+    uint64_t record_acquires(VkCommandBuffer cmd_buffer);
+
+  private:
+    bool needs_ownership_transfer() const;
+
+    [[nodiscard]] bool begin_batch();
+    [[nodiscard]] bool retire(Batch &batch);
+    [[nodiscard]] bool make_room();
+    [[nodiscard]] bool allocate_staging(VkDeviceSize size, StagingAllocation &out_allocation);
+    [[nodiscard]] bool finish_upload(VkDeviceSize size);
+};
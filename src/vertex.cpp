@@ -0,0 +1,66 @@
+#include "vertex.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/packing.hpp>
+#include <glm/vec2.hpp>
+
+size_t get_vertex_size(VertexFormat format)
+{
+    switch (format)
+    {
+        case VertexFormat::Full:
+            return sizeof(Vertex);
+        case VertexFormat::Quantized:
+            return sizeof(QuantizedVertex);
+    }
+    return 0;
+}
+
+// Projects a unit vector onto the octahedron |x| + |y| + |z| = 1 and unfolds the lower half
+// onto the outer triangles of the [-1, 1] square.
+static glm::vec2 encode_octahedral(const glm::vec3 &normal)
+{
+    float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (length == 0.0f)
+    {
+        return glm::vec2(0.0f);
+    }
+
+    glm::vec2 p(normal.x / length, normal.y / length);
+    if (normal.z < 0.0f)
+    {
+        p = glm::vec2(
+            (1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+            (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f)
+        );
+    }
+    return p;
+}
+
+void quantize_vertices(
+    std::span<const Vertex> vertices, const glm::vec3 &position_offset,
+    const glm::vec3 &position_scale, std::vector<QuantizedVertex> &out_vertices
+)
+{
+    // Flat meshes have a zero extent along one axis, every position maps to 0 there.
+    glm::vec3 inv_scale(
+        position_scale.x > 0.0f ? 1.0f / position_scale.x : 0.0f,
+        position_scale.y > 0.0f ? 1.0f / position_scale.y : 0.0f,
+        position_scale.z > 0.0f ? 1.0f / position_scale.z : 0.0f
+    );
+
+    out_vertices.clear();
+    out_vertices.reserve(vertices.size());
+    for (const Vertex &vertex : vertices)
+    {
+        glm::vec3 position = (vertex.position - position_offset) * inv_scale;
+        out_vertices.emplace_back(QuantizedVertex{
+            .position_xy = glm::packUnorm2x16(glm::vec2(position.x, position.y)),
+            .position_z = glm::packUnorm2x16(glm::vec2(position.z, 0.0f)),
+            .normal = glm::packSnorm2x16(encode_octahedral(vertex.normal)),
+            .tex_coords = glm::packHalf2x16(glm::vec2(vertex.tex_coord_x, vertex.tex_coord_y)),
+        });
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+struct Vertex
+{
+    glm::vec3 position;
+    float tex_coord_x;
+    glm::vec3 normal;
+    float tex_coord_y;
+};
+
+// Compact encoding of `Vertex`, laid out as `QuantizedVertex` in forward.vert (std430). The
+// position is stored as 16-bit normalized coordinates within the mesh's bounding box, the normal
+// as 16-bit octahedral coordinates and the texture coordinates as half floats.
+struct QuantizedVertex
+{
+    uint32_t position_xy;
+    // The upper 16 bits are unused.
+    uint32_t position_z;
+    uint32_t normal;
+    uint32_t tex_coords;
+};
+static_assert(sizeof(QuantizedVertex) == 16);
+
+enum class VertexFormat
+{
+    Full,
+    Quantized,
+};
+
+size_t get_vertex_size(VertexFormat format);
+
+// Encodes `vertices` whose positions lie within `[position_offset, position_offset +
+// position_scale]`. The shader reconstructs positions as `position_offset + position_scale * p`
+// with `p` in [0, 1].
+void quantize_vertices(
+    std::span<const Vertex> vertices, const glm::vec3 &position_offset,
+    const glm::vec3 &position_scale, std::vector<QuantizedVertex> &out_vertices
+);
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "asset_archive.hpp"
+#include "mapped_file.hpp"
+
+struct PackEntry
+{
+    std::string key;
+    std::string path;
+    uint64_t offset;
+    uint64_t size;
+};
+
+static void print_packer_usage(const char *program)
+{
+    std::printf(
+        "Usage: %s -o <archive> <file or directory...>\n"
+        "\n"
+        "Packs files into an asset archive. Directories are added recursively and every entry\n"
+        "is keyed by its path relative to the directory the archive is written to.\n",
+        program
+    );
+}
+
+static uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char **argv)
+{
+    std::string archive_path;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg(argv[i]);
+        if (arg == "--help" || arg == "-h")
+        {
+            print_packer_usage(argv[0]);
+            return 0;
+        }
+        else if (arg == "-o" && i + 1 < argc)
+        {
+            archive_path = argv[++i];
+        }
+        else if (arg.starts_with("-"))
+        {
+            spdlog::error("asset_packer: unknown or incomplete option `{}`", arg);
+            print_packer_usage(argv[0]);
+            return 1;
+        }
+        else
+        {
+            inputs.emplace_back(arg);
+        }
+    }
+    if (archive_path.empty() || inputs.empty())
+    {
+        print_packer_usage(argv[0]);
+        return 1;
+    }
+
+    std::error_code ec;
+    std::string root =
+        std::filesystem::absolute(archive_path, ec).parent_path().lexically_normal().string();
+
+    std::vector<PackEntry> entries;
+    auto add_file = [&](const std::filesystem::path &path) {
+        entries.emplace_back(PackEntry{
+            .key = AssetArchive::get_entry_key(root, path.string()),
+            .path = path.string(),
+            .offset = 0,
+            .size = std::filesystem::file_size(path),
+        });
+    };
+    for (const std::string &input : inputs)
+    {
+        if (std::filesystem::is_directory(input))
+        {
+            for (const auto &dir_entry : std::filesystem::recursive_directory_iterator(input))
+            {
+                if (dir_entry.is_regular_file())
+                {
+                    add_file(dir_entry.path());
+                }
+            }
+        }
+        else if (std::filesystem::is_regular_file(input))
+        {
+            add_file(input);
+        }
+        else
+        {
+            spdlog::error("asset_packer: no such file or directory {}", input);
+            return 1;
+        }
+    }
+
+    // Sorting keeps archives reproducible and stores files of the same directory, which tend
+    // to be loaded together, next to each other.
+    std::ranges::sort(entries, {}, &PackEntry::key);
+    auto duplicate = std::ranges::adjacent_find(entries, {}, &PackEntry::key);
+    if (duplicate != entries.end())
+    {
+        spdlog::error("asset_packer: {} was added more than once", duplicate->key);
+        return 1;
+    }
+    std::erase_if(entries, [&](const PackEntry &entry) {
+        return std::filesystem::absolute(entry.path, ec).lexically_normal() ==
+               std::filesystem::absolute(archive_path, ec).lexically_normal();
+    });
+
+    uint64_t index_size = 0;
+    for (const PackEntry &entry : entries)
+    {
+        index_size += 2 * sizeof(uint64_t) + sizeof(uint32_t) + entry.key.size();
+    }
+
+    uint64_t offset = sizeof(AssetArchive::Header) + index_size;
+    for (PackEntry &entry : entries)
+    {
+        entry.offset = align_up(offset, AssetArchive::ENTRY_ALIGNMENT);
+        offset = entry.offset + entry.size;
+    }
+
+    std::string temp_path = archive_path + ".tmp";
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        spdlog::error("asset_packer: failed to open file {}", temp_path);
+        return 1;
+    }
+
+    AssetArchive::Header header{
+        .magic = AssetArchive::MAGIC,
+        .version = AssetArchive::VERSION,
+        .entry_count = static_cast<uint32_t>(entries.size()),
+        .index_size = index_size,
+    };
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const PackEntry &entry : entries)
+    {
+        uint32_t key_size = static_cast<uint32_t>(entry.key.size());
+        out.write(reinterpret_cast<const char *>(&entry.offset), sizeof(entry.offset));
+        out.write(reinterpret_cast<const char *>(&entry.size), sizeof(entry.size));
+        out.write(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
+        out.write(entry.key.data(), static_cast<std::streamsize>(entry.key.size()));
+    }
+
+    constexpr std::array<char, AssetArchive::ENTRY_ALIGNMENT> padding{};
+    for (const PackEntry &entry : entries)
+    {
+        uint64_t position = static_cast<uint64_t>(out.tellp());
+        out.write(padding.data(), static_cast<std::streamsize>(entry.offset - position));
+
+        if (entry.size == 0)
+        {
+            continue;
+        }
+
+        MappedFile file;
+        if (!file.open(entry.path))
+        {
+            spdlog::error("asset_packer: failed to read {}", entry.path);
+            return 1;
+        }
+        std::span<const std::byte> data = file.get_data();
+        out.write(
+            reinterpret_cast<const char *>(data.data()),
+            static_cast<std::streamsize>(data.size())
+        );
+    }
+
+    out.close();
+    if (!out)
+    {
+        spdlog::error("asset_packer: failed to write file {}", temp_path);
+        return 1;
+    }
+
+    std::filesystem::rename(temp_path, archive_path, ec);
+    if (ec)
+    {
+        spdlog::error("asset_packer: failed to move archive into place at {}", archive_path);
+        return 1;
+    }
+
+    spdlog::info(
+        "asset_packer: packed {} files ({:.1f} MiB) into {}",
+        entries.size(),
+        static_cast<double>(offset) / (1024.0 * 1024.0),
+        archive_path
+    );
+    return 0;
+}
@@ -0,0 +1,345 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+
+#include <stb_image.h>
+
+#include "cpu_profiler.hpp"
+#include "ktx2.hpp"
+#include "mipmap.hpp"
+#include "texture_compression.hpp"
+#include "thread_pool.hpp"
+
+struct CookJob
+{
+    std::string source_path;
+    VkFormat format;
+};
+
+struct CookerOptions
+{
+    bool show_help{false};
+    bool force{false};
+    std::vector<std::string> scene_paths;
+    std::vector<std::string> image_paths;
+    TextureUsage usage{TextureUsage::Albedo};
+    VkFormat format_override{VK_FORMAT_UNDEFINED};
+};
+
+static void print_cooker_usage(const char *program)
+{
+    std::printf(
+        "Usage: %s [options] [image...]\n"
+        "\n"
+        "Encodes images into block-compressed KTX2 textures with full mip chains, written next\n"
+        "to the source image with a .ktx2 extension.\n"
+        "\n"
+        "Options:\n"
+        "  -h, --help              Show this help and exit\n"
+        "  --scene <path>          Cook every texture referenced by the scene's materials,\n"
+        "                          picking the format from how each texture is used\n"
+        "  --usage <usage>         Usage of the images given on the command line: albedo (BC7),\n"
+        "                          normal (BC5) or mask (BC4) (default: albedo)\n"
+        "  --format <format>       Override the format: bc1, bc4, bc5 or bc7\n"
+        "  --force                 Cook textures even if they are up to date\n",
+        program
+    );
+}
+
+[[nodiscard]] static bool parse_cooker_options(int argc, char **argv, CookerOptions &out_options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg(argv[i]);
+
+        if (arg == "--help" || arg == "-h")
+        {
+            out_options.show_help = true;
+            continue;
+        }
+
+        if (arg == "--force")
+        {
+            out_options.force = true;
+            continue;
+        }
+
+        if (!arg.starts_with("--"))
+        {
+            out_options.image_paths.emplace_back(arg);
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            spdlog::error("parse_cooker_options: unknown or incomplete option `{}`", arg);
+            return false;
+        }
+        std::string_view value(argv[++i]);
+
+        bool valid = true;
+        if (arg == "--scene")
+        {
+            out_options.scene_paths.emplace_back(value);
+        }
+        else if (arg == "--usage")
+        {
+            if (value == "albedo")
+            {
+                out_options.usage = TextureUsage::Albedo;
+            }
+            else if (value == "normal")
+            {
+                out_options.usage = TextureUsage::Normal;
+            }
+            else if (value == "mask")
+            {
+                out_options.usage = TextureUsage::Mask;
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else if (arg == "--format")
+        {
+            if (value == "bc1")
+            {
+                out_options.format_override = VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+            }
+            else if (value == "bc4")
+            {
+                out_options.format_override = VK_FORMAT_BC4_UNORM_BLOCK;
+            }
+            else if (value == "bc5")
+            {
+                out_options.format_override = VK_FORMAT_BC5_UNORM_BLOCK;
+            }
+            else if (value == "bc7")
+            {
+                out_options.format_override = VK_FORMAT_BC7_SRGB_BLOCK;
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else
+        {
+            spdlog::error("parse_cooker_options: unknown option `{}`", arg);
+            return false;
+        }
+
+        if (!valid)
+        {
+            spdlog::error("parse_cooker_options: invalid value `{}` for option `{}`", value, arg);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+[[nodiscard]] static bool collect_scene_jobs(
+    const std::string &scene_path, VkFormat format_override, std::vector<CookJob> &jobs
+)
+{
+    Assimp::Importer importer;
+    const aiScene *scene = importer.ReadFile(scene_path, 0);
+    if (scene == nullptr)
+    {
+        spdlog::error("collect_scene_jobs: failed to load scene {}", scene_path);
+        return false;
+    }
+
+    struct TextureSlot
+    {
+        aiTextureType type;
+        TextureUsage usage;
+    };
+    constexpr TextureSlot TEXTURE_SLOTS[] = {
+        {aiTextureType_DIFFUSE, TextureUsage::Albedo},
+        {aiTextureType_BASE_COLOR, TextureUsage::Albedo},
+        {aiTextureType_NORMALS, TextureUsage::Normal},
+        {aiTextureType_OPACITY, TextureUsage::Mask},
+        {aiTextureType_AMBIENT_OCCLUSION, TextureUsage::Mask},
+    };
+
+    std::filesystem::path scene_dir = std::filesystem::path(scene_path).parent_path();
+    for (size_t mat_idx = 0; mat_idx < scene->mNumMaterials; ++mat_idx)
+    {
+        const aiMaterial *material = scene->mMaterials[mat_idx];
+        for (const TextureSlot &slot : TEXTURE_SLOTS)
+        {
+            for (unsigned int i = 0; i < material->GetTextureCount(slot.type); ++i)
+            {
+                aiString name;
+                material->GetTexture(slot.type, i, &name);
+
+                std::string path = (scene_dir / name.C_Str()).lexically_normal().string();
+                bool known = std::ranges::any_of(jobs, [&](const CookJob &job) {
+                    return job.source_path == path;
+                });
+                if (!known)
+                {
+                    jobs.emplace_back(CookJob{
+                        .source_path = path,
+                        .format = format_override != VK_FORMAT_UNDEFINED
+                                      ? format_override
+                                      : get_compressed_format(slot.usage),
+                    });
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool is_up_to_date(const CookJob &job)
+{
+    std::error_code ec;
+    auto source_time = std::filesystem::last_write_time(job.source_path, ec);
+    if (ec)
+    {
+        return false;
+    }
+    std::string cooked_path = get_cooked_texture_path(job.source_path);
+    auto cooked_time = std::filesystem::last_write_time(cooked_path, ec);
+    return !ec && cooked_time >= source_time;
+}
+
+[[nodiscard]] static bool cook_texture(const CookJob &job)
+{
+    CPU_ZONE("cook_texture");
+
+    int width, height;
+    stbi_uc *texels = stbi_load(job.source_path.c_str(), &width, &height, nullptr, 4);
+    if (texels == nullptr)
+    {
+        spdlog::error(
+            "cook_texture: failed to decode {}: {}",
+            job.source_path,
+            stbi_failure_reason()
+        );
+        return false;
+    }
+
+    DecodedImage image;
+    image.extent = VkExtent3D{
+        .width = static_cast<uint32_t>(width),
+        .height = static_cast<uint32_t>(height),
+        .depth = 1,
+    };
+    image.format = is_srgb_format(job.format) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    const auto *begin = reinterpret_cast<const std::byte *>(texels);
+    image.data.assign(begin, begin + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(texels);
+
+    generate_mip_chain(image.extent, is_srgb_format(job.format), image.data, image.mip_offsets);
+
+    DecodedImage compressed;
+    if (!compress_image(image, job.format, compressed))
+    {
+        spdlog::error("cook_texture: failed to compress {}", job.source_path);
+        return false;
+    }
+
+    std::string cooked_path = get_cooked_texture_path(job.source_path);
+    if (!write_ktx2(cooked_path, compressed))
+    {
+        spdlog::error("cook_texture: failed to write {}", cooked_path);
+        return false;
+    }
+
+    spdlog::info(
+        "cook_texture: {} -> {} ({:.1f} KiB -> {:.1f} KiB)",
+        job.source_path,
+        cooked_path,
+        static_cast<double>(image.data.size()) / 1024.0,
+        static_cast<double>(compressed.data.size()) / 1024.0
+    );
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    CPUProfiler::set_thread_name("main");
+
+    CookerOptions options;
+    if (!parse_cooker_options(argc, argv, options))
+    {
+        print_cooker_usage(argv[0]);
+        return 1;
+    }
+    if (options.show_help || (options.scene_paths.empty() && options.image_paths.empty()))
+    {
+        print_cooker_usage(argv[0]);
+        return options.show_help ? 0 : 1;
+    }
+
+    std::vector<CookJob> jobs;
+    for (const std::string &scene_path : options.scene_paths)
+    {
+        if (!collect_scene_jobs(scene_path, options.format_override, jobs))
+        {
+            return 1;
+        }
+    }
+    for (const std::string &image_path : options.image_paths)
+    {
+        jobs.emplace_back(CookJob{
+            .source_path = image_path,
+            .format = options.format_override != VK_FORMAT_UNDEFINED
+                          ? options.format_override
+                          : get_compressed_format(options.usage),
+        });
+    }
+
+    std::erase_if(jobs, [&](const CookJob &job) { return !options.force && is_up_to_date(job); });
+    spdlog::info("texture_cooker: cooking {} textures", jobs.size());
+
+    ThreadPool thread_pool;
+    if (!thread_pool.init())
+    {
+        spdlog::error("texture_cooker: failed to start worker threads");
+        return 1;
+    }
+
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    size_t done_count = 0;
+    std::atomic<bool> success = true;
+    for (const CookJob &job : jobs)
+    {
+        thread_pool.submit([&] {
+            if (!cook_texture(job))
+            {
+                success = false;
+            }
+
+            std::lock_guard lock(mutex);
+            done_count += 1;
+            done_cv.notify_one();
+        });
+    }
+
+    {
+        std::unique_lock lock(mutex);
+        done_cv.wait(lock, [&] { return done_count == jobs.size(); });
+    }
+    thread_pool.destroy();
+
+    return success ? 0 : 1;
+}